@@ -31,6 +31,10 @@
  *
  * This file has been updated with some new features related to memory leak and corruption
  * detection. These changes are only enabled when compiling with SDK versions 1.3.3 and later.
+ *
+ * Both allocators also keep usage counters, which are always on: the bytes in use, the high-water
+ * mark and the number of failed allocations. These cost a few instructions per call and no memory
+ * per block, and can be used to size the heaps and the DMA buffer counts.
  */
 
 #include <cyu3os.h>
@@ -38,8 +42,10 @@
 #include <cyu3error.h>
 #include <cyfxversion.h>
 
-/* Memory error detection is supported in SDK 1.3.3 and later. */
-#if ((CYFX_VERSION_MINOR > 3) || ((CYFX_VERSION_MINOR == 3) && (CYFX_VERSION_PATCH >= 3)))
+/* Memory error detection is supported in SDK 1.3.3 and later. The latency and throughput build profiles
+   turn it off (CYFXTX_NO_ERRORDETECTION), as it adds checks to every buffer allocation and free. */
+#if (((CYFX_VERSION_MINOR > 3) || ((CYFX_VERSION_MINOR == 3) && (CYFX_VERSION_PATCH >= 3))) && \
+        (!defined (CYFXTX_NO_ERRORDETECTION)))
 #define CYFXTX_ERRORDETECTION   1
 #else
 #undef CYFXTX_ERRORDETECTION
@@ -121,6 +127,57 @@
 #define CY_U3P_BUFFER_ALLOC_TIMEOUT     (10)
 #define CY_U3P_MEM_ALLOC_TIMEOUT        (10)
 
+/*
+   Small allocations made through CyU3PMemAlloc are served from a set of fixed block size pools
+   placed at the start of the driver heap, and the rest of the heap is managed as a byte pool.
+   Allocating and freeing a block is a constant time operation which does not wait and is safe in
+   interrupt context, and the SDK objects that are created and deleted on every USB reset or
+   SET_CONFIGURATION do not fragment the byte pool. A request that does not fit a block, or whose
+   pool is empty, falls back to the byte pool. Define CYFXTX_DISABLE_MEM_POOLS to use the byte pool
+   for all allocations.
+ */
+#ifndef CYFXTX_DISABLE_MEM_POOLS
+#define CYFXTX_MEM_POOLS                (1)
+#endif
+
+#ifdef CYFXTX_MEM_POOLS
+
+#define CYFXTX_MEM_POOL_COUNT           (5)
+/* Each ThreadX block carries a one pointer header in front of the block. */
+#define CYFXTX_MEM_POOL_BLK_OVERHEAD    (4)
+#define CYFXTX_MEM_POOL_SIZE(sz, cnt)   ((cnt) * ((sz) + CYFXTX_MEM_POOL_BLK_OVERHEAD))
+
+/* Block size and number of blocks for each of the pools, in increasing order of size. */
+#define CYFXTX_MEM_POOL0_BLKSZ          (16)
+#define CYFXTX_MEM_POOL0_BLKCNT         (64)
+#define CYFXTX_MEM_POOL1_BLKSZ          (32)
+#define CYFXTX_MEM_POOL1_BLKCNT         (32)
+#define CYFXTX_MEM_POOL2_BLKSZ          (64)
+#define CYFXTX_MEM_POOL2_BLKCNT         (16)
+#define CYFXTX_MEM_POOL3_BLKSZ          (128)
+#define CYFXTX_MEM_POOL3_BLKCNT         (8)
+#define CYFXTX_MEM_POOL4_BLKSZ          (256)
+#define CYFXTX_MEM_POOL4_BLKCNT         (4)
+
+/* Total size of the pool area at the start of the driver heap. */
+#define CYFXTX_MEM_POOL_AREA_SIZE       (                                                        \
+        CYFXTX_MEM_POOL_SIZE (CYFXTX_MEM_POOL0_BLKSZ, CYFXTX_MEM_POOL0_BLKCNT) +                \
+        CYFXTX_MEM_POOL_SIZE (CYFXTX_MEM_POOL1_BLKSZ, CYFXTX_MEM_POOL1_BLKCNT) +                \
+        CYFXTX_MEM_POOL_SIZE (CYFXTX_MEM_POOL2_BLKSZ, CYFXTX_MEM_POOL2_BLKCNT) +                \
+        CYFXTX_MEM_POOL_SIZE (CYFXTX_MEM_POOL3_BLKSZ, CYFXTX_MEM_POOL3_BLKCNT) +                \
+        CYFXTX_MEM_POOL_SIZE (CYFXTX_MEM_POOL4_BLKSZ, CYFXTX_MEM_POOL4_BLKCNT))
+
+#else
+
+#define CYFXTX_MEM_POOL_AREA_SIZE       (0)
+
+#endif
+
+/* The SDK drivers need at least 20 KB of byte pool for thread stacks and other large objects. */
+#if ((CY_U3P_MEM_HEAP_SIZE - CYFXTX_MEM_POOL_AREA_SIZE) < 0x5000)
+#error "The memory pools leave less than 20 KB in the driver heap byte pool."
+#endif
+
 #define CY_U3P_MEM_START_SIG            (0x4658334D)
 #define CY_U3P_MEM_END_SIG              (0x454E444D)
 
@@ -135,6 +192,36 @@ static CyBool_t         glMemPoolInit   = CyFalse;              /* Whether the m
 static CyU3PBytePool    glMemBytePool;                          /* ThreadX Byte pool used in the CyU3PMem* functions. */
 static CyU3PDmaBufMgr_t glBufferManager = {{0}, 0, 0, 0, 0, 0}; /* Buffer manager used in the buffer alloc functions. */
 
+/* Usage counters of the CyU3PMem* functions, updated with interrupts disabled. The byte counts include
+   the block overhead of the pools. */
+static uint32_t         glMemCurBytes   = 0;                    /* Bytes currently allocated. */
+static uint32_t         glMemPeakBytes  = 0;                    /* Largest value of glMemCurBytes. */
+static uint32_t         glMemFailCnt    = 0;                    /* Allocations that returned NULL. */
+
+/* Usage counters of the buffer alloc functions, updated with the buffer manager lock held, in cache lines.
+   Each buffer takes up one cache line more than is marked in the status array. */
+static uint32_t         glBufCurLines   = 0;                    /* Cache lines currently allocated. */
+static uint32_t         glBufPeakLines  = 0;                    /* Largest value of glBufCurLines. */
+static uint32_t         glBufFailCnt    = 0;                    /* Allocations that found no free run. */
+
+#ifdef CYFXTX_MEM_POOLS
+
+static CyU3PBlockPool   glMemBlockPool[CYFXTX_MEM_POOL_COUNT];  /* ThreadX Block pools used for small allocations. */
+
+/* Block size of each of the pools. */
+static const uint16_t   glMemBlockSize[CYFXTX_MEM_POOL_COUNT] = {
+    CYFXTX_MEM_POOL0_BLKSZ, CYFXTX_MEM_POOL1_BLKSZ, CYFXTX_MEM_POOL2_BLKSZ,
+    CYFXTX_MEM_POOL3_BLKSZ, CYFXTX_MEM_POOL4_BLKSZ
+};
+
+/* Number of blocks in each of the pools. */
+static const uint16_t   glMemBlockCount[CYFXTX_MEM_POOL_COUNT] = {
+    CYFXTX_MEM_POOL0_BLKCNT, CYFXTX_MEM_POOL1_BLKCNT, CYFXTX_MEM_POOL2_BLKCNT,
+    CYFXTX_MEM_POOL3_BLKCNT, CYFXTX_MEM_POOL4_BLKCNT
+};
+
+#endif
+
 #ifdef CYFXTX_ERRORDETECTION
 
 /*
@@ -273,27 +360,64 @@ CyU3PMemEnableChecks (
  *               memory allocation.
  *               The function should not be explicitly invoked, and is called from the 
  *               API library. The minimum required size for the heap is 20 KB.
- *               The default implementation makes use of the Byte Pool services provided
- *               by ThreadX.
+ *               The default implementation makes use of the Block Pool and Byte Pool
+ *               services provided by ThreadX. The block pools are placed at the start
+ *               of the heap, and the remaining memory is used for the byte pool.
  * Parameters  : None
  */
 void
 CyU3PMemInit (
         void)
 {
-    /* If the heap is not initialized so far, create the byte pool. */
+#ifdef CYFXTX_MEM_POOLS
+    uint8_t  *pool_p = (uint8_t *)CY_U3P_MEM_HEAP_BASE;
+    uint32_t  poolSize;
+    uint32_t  i;
+#endif
+
+    /* If the heap is not initialized so far, create the block pools and the byte pool. */
     if (!glMemPoolInit)
     {
 	glMemPoolInit = CyTrue;
-	CyU3PBytePoolCreate (&glMemBytePool, (void *)CY_U3P_MEM_HEAP_BASE, CY_U3P_MEM_HEAP_SIZE);
+
+#ifdef CYFXTX_MEM_POOLS
+        for (i = 0; i < CYFXTX_MEM_POOL_COUNT; i++)
+        {
+            poolSize = CYFXTX_MEM_POOL_SIZE (glMemBlockSize[i], glMemBlockCount[i]);
+            CyU3PBlockPoolCreate (&glMemBlockPool[i], glMemBlockSize[i], (void *)pool_p, poolSize);
+            pool_p += poolSize;
+        }
+#endif
+
+	CyU3PBytePoolCreate (&glMemBytePool, (void *)(CY_U3P_MEM_HEAP_BASE + CYFXTX_MEM_POOL_AREA_SIZE),
+                CY_U3P_MEM_HEAP_SIZE - CYFXTX_MEM_POOL_AREA_SIZE);
     }
 }
 
+/* Function     : CyU3PMemByteBlockSize
+ * Description  : Get the size of a block allocated from the byte pool, including the block header and
+ *                any bytes the pool has added to the request. ThreadX keeps a pointer to the next
+ *                block in the first word of the 8 byte header in front of each block.
+ * Parameters   :
+ *                mem_p : Pointer returned by the byte pool.
+ * Return Value : Size of the block in bytes.
+ */
+static uint32_t
+CyU3PMemByteBlockSize (
+        void *mem_p)
+{
+    uint8_t *header_p = (uint8_t *)mem_p - 8;
+
+    return ((uint32_t)(*(uint8_t **)header_p) - (uint32_t)header_p);
+}
+
 /* Function     : CyU3PMemAlloc
  * Description  : This function allocates memory required for various OS objects in the
  *                firmware application. This function is used by the SDK internal drivers
  *                in addition to the application code itself.
- *                The default implementation makes use of the ThreadX byte pool services.
+ *                The default implementation takes the block from the smallest block pool
+ *                that fits the request, and makes use of the ThreadX byte pool services
+ *                for larger requests or when that pool is empty.
  *                If memory leak and corruption checking is enabled, the implementation
  *                adds a 20 byte header and a 4 byte footer around the memory block.
  * Parameters   :
@@ -305,8 +429,13 @@ CyU3PMemAlloc (
         uint32_t size)
 {
     void         *ret_p;
-    uint32_t      status;
+    uint32_t      status = CY_U3P_ERROR_MEMORY_ERROR;
 
+    uint32_t      used = 0;
+    uint32_t      intMask;
+#ifdef CYFXTX_MEM_POOLS
+    uint32_t      i;
+#endif
 #ifdef CYFXTX_ERRORDETECTION
     MemBlockInfo *block_p;
 #endif
@@ -320,31 +449,62 @@ CyU3PMemAlloc (
         size += sizeof (MemBlockInfo) + sizeof (uint32_t);
 #endif
 
-    /* Cannot wait in interrupt context */
-    if (CyU3PThreadIdentify ())
+#ifdef CYFXTX_MEM_POOLS
+    /* Try the smallest block pool that fits the request. The pools are never waited for, as the
+       byte pool can be used when the pool is empty. */
+    for (i = 0; i < CYFXTX_MEM_POOL_COUNT; i++)
     {
-        status = CyU3PByteAlloc (&glMemBytePool, (void **)&ret_p, size, CY_U3P_MEM_ALLOC_TIMEOUT);
+        if (size <= glMemBlockSize[i])
+        {
+            status = CyU3PBlockAlloc (&glMemBlockPool[i], (void **)&ret_p, CYU3P_NO_WAIT);
+            used   = glMemBlockSize[i] + CYFXTX_MEM_POOL_BLK_OVERHEAD;
+            break;
+        }
     }
-    else
+
+    if (status != CY_U3P_SUCCESS)
+#endif
     {
-        status = CyU3PByteAlloc (&glMemBytePool, (void **)&ret_p, size, CYU3P_NO_WAIT);
+        /* Cannot wait in interrupt context */
+        if (CyU3PThreadIdentify ())
+        {
+            status = CyU3PByteAlloc (&glMemBytePool, (void **)&ret_p, size, CY_U3P_MEM_ALLOC_TIMEOUT);
+        }
+        else
+        {
+            status = CyU3PByteAlloc (&glMemBytePool, (void **)&ret_p, size, CYU3P_NO_WAIT);
+        }
+        if (status == CY_U3P_SUCCESS)
+        {
+            used = CyU3PMemByteBlockSize (ret_p);
+        }
     }
 
     if (status == CY_U3P_SUCCESS)
     {
+        intMask = CyU3PVicDisableAllInterrupts ();
+        glMemCurBytes += used;
+        if (glMemCurBytes > glMemPeakBytes)
+            glMemPeakBytes = glMemCurBytes;
+        CyU3PVicEnableInterrupts (intMask);
+
 #ifdef CYFXTX_ERRORDETECTION
         if (glMemEnableChecks)
         {
-            /* Store the header information used for leak and corruption checks. */
+            /* Store the header information used for leak and corruption checks. The in-use list is
+               updated with interrupts disabled, as blocks can be allocated from interrupt context. */
             block_p = (MemBlockInfo *)ret_p;
-            block_p->alloc_id        = glMemAllocCnt++;
             block_p->alloc_size      = size;
-            block_p->prev_blk        = glMemInUseList;
             block_p->next_blk        = 0;
             block_p->start_sig       = CY_U3P_MEM_START_SIG;
+
+            intMask = CyU3PVicDisableAllInterrupts ();
+            block_p->alloc_id        = glMemAllocCnt++;
+            block_p->prev_blk        = glMemInUseList;
             if (glMemInUseList != 0)
                 glMemInUseList->next_blk = block_p;
             glMemInUseList           = block_p;
+            CyU3PVicEnableInterrupts (intMask);
 
             /* Add the end block signature as a footer. */
             ((uint32_t *)block_p)[BYTE_TO_DWORD (size) - 1] = CY_U3P_MEM_END_SIG;
@@ -357,6 +517,10 @@ CyU3PMemAlloc (
         return ret_p;
     }
 
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glMemFailCnt++;
+    CyU3PVicEnableInterrupts (intMask);
+
     return (NULL);
 }
 
@@ -369,6 +533,12 @@ void
 CyU3PMemFree (
         void *mem_p)
 {
+    uint32_t      used;
+    uint32_t      intMask;
+#ifdef CYFXTX_MEM_POOLS
+    uint32_t      poolEnd = CY_U3P_MEM_HEAP_BASE;
+    uint32_t      i;
+#endif
 #ifdef CYFXTX_ERRORDETECTION
     MemBlockInfo *block_p;
     uint32_t     *endsig_p;
@@ -393,6 +563,7 @@ CyU3PMemFree (
                 glMemBadCb (mem_p);
         }
 
+        intMask = CyU3PVicDisableAllInterrupts ();
         glMemFreeCnt++;
 
         /* Update the in-use linked list to drop the freed-up block. */
@@ -404,14 +575,84 @@ CyU3PMemFree (
         {
             glMemInUseList = block_p->prev_blk;
         }
+        CyU3PVicEnableInterrupts (intMask);
 
         mem_p = (void *)block_p;
     }
 #endif
 
+#ifdef CYFXTX_MEM_POOLS
+    /* Blocks in the pool area go back to their block pool, which ThreadX finds from the block header.
+       The pools are laid out one after the other, which gives the block size. */
+    if ((uint32_t)mem_p < (CY_U3P_MEM_HEAP_BASE + CYFXTX_MEM_POOL_AREA_SIZE))
+    {
+        used = 0;
+        for (i = 0; i < CYFXTX_MEM_POOL_COUNT; i++)
+        {
+            poolEnd += CYFXTX_MEM_POOL_SIZE (glMemBlockSize[i], glMemBlockCount[i]);
+            if ((uint32_t)mem_p < poolEnd)
+            {
+                used = glMemBlockSize[i] + CYFXTX_MEM_POOL_BLK_OVERHEAD;
+                break;
+            }
+        }
+
+        intMask = CyU3PVicDisableAllInterrupts ();
+        glMemCurBytes -= used;
+        CyU3PVicEnableInterrupts (intMask);
+
+        CyU3PBlockFree (mem_p);
+        return;
+    }
+#endif
+
+    used = CyU3PMemByteBlockSize (mem_p);
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glMemCurBytes -= used;
+    CyU3PVicEnableInterrupts (intMask);
+
     CyU3PByteFree (mem_p);
 }
 
+/* Function     : CyU3PMemGetUsage
+ * Description  : Get the usage counters of the CyU3PMem* functions.
+ * Parameters   :
+ *                curBytes_p  : Parameter to be filled with the number of bytes currently allocated.
+ *                peakBytes_p : Parameter to be filled with the largest number of bytes allocated.
+ *                failCnt_p   : Parameter to be filled with the number of failed allocations.
+ * Return Value : None
+ */
+void
+CyU3PMemGetUsage (
+        uint32_t *curBytes_p,
+        uint32_t *peakBytes_p,
+        uint32_t *failCnt_p)
+{
+    if (curBytes_p != 0)
+        *curBytes_p = glMemCurBytes;
+    if (peakBytes_p != 0)
+        *peakBytes_p = glMemPeakBytes;
+    if (failCnt_p != 0)
+        *failCnt_p = glMemFailCnt;
+}
+
+/* Function     : CyU3PMemResetUsage
+ * Description  : Restart the high-water mark from the current usage, and clear the failure count.
+ * Parameters   : None
+ * Return Value : None
+ */
+void
+CyU3PMemResetUsage (
+        void)
+{
+    uint32_t intMask;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glMemPeakBytes = glMemCurBytes;
+    glMemFailCnt   = 0;
+    CyU3PVicEnableInterrupts (intMask);
+}
+
 #ifdef CYFXTX_ERRORDETECTION
 
 /* Function     : CyU3PMemGetCounts
@@ -495,10 +736,18 @@ CyU3PMemCorruptionCheck (
 
 #endif
 
+/* Use the ARM multi-word load/store instructions (LDM/STM) for the aligned block transfers when
+   building with GCC. Other tool chains use plain word loops, which they unroll as they see fit. */
+#if defined (__GNUC__) && defined (__arm__)
+#define CYFXTX_USE_LDM_STM      1
+#endif
+
 /* Function     : CyU3PMemSet
  * Description  : memset equivalent function to initialize a memory block.
- *                This function assumes that the memory block may not be DWORD
- *                aligned; and performs a byte-by-byte memset.
+ *                Any bytes up to the first DWORD aligned address are set one at a time; the
+ *                aligned part of the block is then set 32 bytes at a time using multi-word
+ *                stores, and the remainder a DWORD at a time. The last 0 - 3 bytes are set
+ *                one at a time.
  *                No checks are performed on the parameters because even a NULL-pointer
  *                is valid on the FX3 device.
  * Parameters   :
@@ -513,20 +762,65 @@ CyU3PMemSet (
         uint8_t  data,
         uint32_t count)
 {
-    /* Loop unrolling for faster operation */
-    while (count >> 3)
+    uint32_t *wptr;
+    uint32_t  value;
+
+    /* Set bytes until the pointer is DWORD aligned. */
+    while ((count != 0) && (((uint32_t)ptr & 0x03) != 0))
     {
-        ptr[0] = data;
-        ptr[1] = data;
-        ptr[2] = data;
-        ptr[3] = data;
-        ptr[4] = data;
-        ptr[5] = data;
-        ptr[6] = data;
-        ptr[7] = data;
-
-        count -= 8;
-        ptr += 8;
+        *ptr++ = data;
+        count--;
+    }
+
+    if (count >= 4)
+    {
+        wptr  = (uint32_t *)ptr;
+        value = data * 0x01010101UL;
+
+#ifdef CYFXTX_USE_LDM_STM
+        if (count >= 32)
+        {
+            uint32_t blocks = count >> 5;
+
+            __asm__ __volatile__ (
+                    "mov    r4, %[val]              \n\t"
+                    "mov    r5, %[val]              \n\t"
+                    "mov    r6, %[val]              \n\t"
+                    "mov    r7, %[val]              \n\t"
+                    "1:                             \n\t"
+                    "stmia  %[dst]!, {r4-r7}        \n\t"
+                    "stmia  %[dst]!, {r4-r7}        \n\t"
+                    "subs   %[blk], %[blk], #1      \n\t"
+                    "bne    1b                      \n\t"
+                    : [dst] "+r" (wptr), [blk] "+r" (blocks)
+                    : [val] "r" (value)
+                    : "r4", "r5", "r6", "r7", "cc", "memory");
+            count &= 0x1F;
+        }
+#else
+        while (count >= 32)
+        {
+            wptr[0] = value;
+            wptr[1] = value;
+            wptr[2] = value;
+            wptr[3] = value;
+            wptr[4] = value;
+            wptr[5] = value;
+            wptr[6] = value;
+            wptr[7] = value;
+
+            wptr  += 8;
+            count -= 32;
+        }
+#endif
+
+        while (count >= 4)
+        {
+            *wptr++ = value;
+            count  -= 4;
+        }
+
+        ptr = (uint8_t *)wptr;
     }
 
     while (count--)
@@ -536,30 +830,27 @@ CyU3PMemSet (
     }
 }
 
-/* Function     : CyU3PMemCopy
- * Description  : memcpy equivalent function to copy one memory block to another.
- *                This function assumes that the memory block may not be DWORD
- *                aligned; and performs a byte-by-byte copy.
- *                No checks are performed on the parameters because even a NULL-pointer
- *                is valid on the FX3 device.
+/* Function     : CyU3PMemCopyBytes
+ * Description  : Byte-by-byte copy, unrolled by 8. Used when the source and destination
+ *                blocks do not have the same alignment, and for the unaligned head and
+ *                tail of a block. Copies from the end of the buffer back to the start if
+ *                backward is set, so that overlapping blocks are handled correctly.
  * Parameters   :
- *                dest  : Pointer to destination memory block.
- *                src   : Pointer to source memory block.
- *                count : Size of memory block.
+ *                dest     : Pointer to destination memory block (end of the block if backward).
+ *                src      : Pointer to source memory block (end of the block if backward).
+ *                count    : Size of memory block.
+ *                backward : Whether to copy from the end of the block.
  * Return Value : None
  */
-void
-CyU3PMemCopy (
-        uint8_t  *dest, 
+static void
+CyU3PMemCopyBytes (
+        uint8_t  *dest,
         uint8_t  *src,
-        uint32_t  count)
+        uint32_t  count,
+        CyBool_t  backward)
 {
-    if (dest > src)
+    if (backward)
     {
-        /* Destination buffer is above source buffer. Copy from end of the buffer back to the start. */
-        dest += count;
-        src  += count;
-
         /* Loop unrolling for faster operation */
         while (count >= 8)
         {
@@ -588,8 +879,6 @@ CyU3PMemCopy (
     }
     else
     {
-        /* Destination buffer is below source buffer. Copy from start to end of the buffer. */
-
         /* Loop unrolling for faster operation */
         while (count >= 8)
         {
@@ -618,6 +907,150 @@ CyU3PMemCopy (
     }
 }
 
+/* Function     : CyU3PMemCopy
+ * Description  : memcpy equivalent function to copy one memory block to another.
+ *                Overlapping blocks are handled like memmove: the copy is done from the end
+ *                of the block back to the start if the destination is above the source.
+ *                If the source and destination have the same alignment, the bytes up to the
+ *                first DWORD aligned address are copied one at a time, the aligned part 16
+ *                bytes at a time using multi-word loads and stores, and the rest a DWORD at a
+ *                time. Otherwise a byte-by-byte copy is performed.
+ *                No checks are performed on the parameters because even a NULL-pointer
+ *                is valid on the FX3 device.
+ * Parameters   :
+ *                dest  : Pointer to destination memory block.
+ *                src   : Pointer to source memory block.
+ *                count : Size of memory block.
+ * Return Value : None
+ */
+void
+CyU3PMemCopy (
+        uint8_t  *dest, 
+        uint8_t  *src,
+        uint32_t  count)
+{
+    uint32_t *wdest, *wsrc;
+    uint32_t  head;
+
+    if (dest > src)
+    {
+        /* Destination buffer is above source buffer. Copy from end of the buffer back to the start. */
+        dest += count;
+        src  += count;
+
+        if ((((uint32_t)dest ^ (uint32_t)src) & 0x03) != 0)
+        {
+            CyU3PMemCopyBytes (dest, src, count, CyTrue);
+            return;
+        }
+
+        /* Copy the bytes above the last DWORD aligned address. */
+        head = CY_U3P_MIN (((uint32_t)dest & 0x03), count);
+        CyU3PMemCopyBytes (dest, src, head, CyTrue);
+        dest  -= head;
+        src   -= head;
+        count -= head;
+
+        wdest = (uint32_t *)dest;
+        wsrc  = (uint32_t *)src;
+
+#ifdef CYFXTX_USE_LDM_STM
+        if (count >= 16)
+        {
+            uint32_t blocks = count >> 4;
+
+            __asm__ __volatile__ (
+                    "1:                             \n\t"
+                    "ldmdb  %[src]!, {r4-r7}        \n\t"
+                    "stmdb  %[dst]!, {r4-r7}        \n\t"
+                    "subs   %[blk], %[blk], #1      \n\t"
+                    "bne    1b                      \n\t"
+                    : [dst] "+r" (wdest), [src] "+r" (wsrc), [blk] "+r" (blocks)
+                    :
+                    : "r4", "r5", "r6", "r7", "cc", "memory");
+            count &= 0x0F;
+        }
+#else
+        while (count >= 16)
+        {
+            wdest -= 4;
+            wsrc  -= 4;
+            count -= 16;
+
+            wdest[3] = wsrc[3];
+            wdest[2] = wsrc[2];
+            wdest[1] = wsrc[1];
+            wdest[0] = wsrc[0];
+        }
+#endif
+
+        while (count >= 4)
+        {
+            *(--wdest) = *(--wsrc);
+            count -= 4;
+        }
+
+        CyU3PMemCopyBytes ((uint8_t *)wdest, (uint8_t *)wsrc, count, CyTrue);
+    }
+    else
+    {
+        /* Destination buffer is below source buffer. Copy from start to end of the buffer. */
+        if ((((uint32_t)dest ^ (uint32_t)src) & 0x03) != 0)
+        {
+            CyU3PMemCopyBytes (dest, src, count, CyFalse);
+            return;
+        }
+
+        /* Copy the bytes below the first DWORD aligned address. */
+        head = CY_U3P_MIN (((4 - ((uint32_t)dest & 0x03)) & 0x03), count);
+        CyU3PMemCopyBytes (dest, src, head, CyFalse);
+        dest  += head;
+        src   += head;
+        count -= head;
+
+        wdest = (uint32_t *)dest;
+        wsrc  = (uint32_t *)src;
+
+#ifdef CYFXTX_USE_LDM_STM
+        if (count >= 16)
+        {
+            uint32_t blocks = count >> 4;
+
+            __asm__ __volatile__ (
+                    "1:                             \n\t"
+                    "ldmia  %[src]!, {r4-r7}        \n\t"
+                    "stmia  %[dst]!, {r4-r7}        \n\t"
+                    "subs   %[blk], %[blk], #1      \n\t"
+                    "bne    1b                      \n\t"
+                    : [dst] "+r" (wdest), [src] "+r" (wsrc), [blk] "+r" (blocks)
+                    :
+                    : "r4", "r5", "r6", "r7", "cc", "memory");
+            count &= 0x0F;
+        }
+#else
+        while (count >= 16)
+        {
+            wdest[0] = wsrc[0];
+            wdest[1] = wsrc[1];
+            wdest[2] = wsrc[2];
+            wdest[3] = wsrc[3];
+
+            wdest += 4;
+            wsrc  += 4;
+            count -= 16;
+        }
+#endif
+
+        while (count >= 4)
+        {
+            *wdest++ = *wsrc++;
+            count -= 4;
+        }
+
+        CyU3PMemCopyBytes ((uint8_t *)wdest, (uint8_t *)wsrc, count, CyFalse);
+    }
+}
+
 /* Function     : CyU3PMemCmp
  * Description  : Compare the contents of two memory blocks.
  *                This function assumes that the memory block may not be DWORD
@@ -777,6 +1210,8 @@ CyU3PDmaBufferDeInit (
     glBufferManager.startAddr  = 0;
     glBufferManager.regionSize = 0;
     glBufferManager.statusSize = 0;
+    glBufCurLines              = 0;
+    glBufPeakLines             = 0;
 
 #ifdef CYFXTX_ERRORDETECTION
     /* Clear status tracking variables. */
@@ -839,10 +1274,69 @@ CyU3PDmaBufMgrSetStatus (
     }
 }
 
+/* Function    : CyU3PDmaBufMgrClz
+ * Description : Helper function for the DMA buffer manager. Returns the number of
+ *               leading zero bits in a non-zero word. GCC implements this using the
+ *               single cycle CLZ instruction of the ARM926 core.
+ */
+static uint32_t
+CyU3PDmaBufMgrClz (
+        uint32_t value)
+{
+#ifdef __GNUC__
+    return (uint32_t)__builtin_clz (value);
+#else
+    uint32_t count = 0;
+
+    /* Find the position of the highest set bit by binary search. */
+    if ((value & 0xFFFF0000U) == 0)
+    {
+        count += 16;
+        value <<= 16;
+    }
+    if ((value & 0xFF000000U) == 0)
+    {
+        count += 8;
+        value <<= 8;
+    }
+    if ((value & 0xF0000000U) == 0)
+    {
+        count += 4;
+        value <<= 4;
+    }
+    if ((value & 0xC0000000U) == 0)
+    {
+        count += 2;
+        value <<= 2;
+    }
+    if ((value & 0x80000000U) == 0)
+    {
+        count += 1;
+    }
+    return count;
+#endif
+}
+
+/* Function    : CyU3PDmaBufMgrCtz
+ * Description : Helper function for the DMA buffer manager. Returns the number of
+ *               trailing zero bits in a non-zero word, by isolating the lowest set bit.
+ */
+static uint32_t
+CyU3PDmaBufMgrCtz (
+        uint32_t value)
+{
+    return (31 - CyU3PDmaBufMgrClz (value & (0 - value)));
+}
+
 /* Function     : CyU3PDmaBufferAlloc
  * Description  : This function allocates memory required for DMA buffers required by the
  *                firmware application. This function is used by the SDK internal drivers
  *                in addition to the application code itself.
+ *                The status array is searched one word at a time. Fully used and fully
+ *                free words are handled in a single step. For other words, the run carried
+ *                over from the previous word, a run that fits within the word and the run
+ *                carried into the next word are each found with a few shift/mask and
+ *                count leading zero operations, without walking through the bits.
  *                If memory leak and corruption checking is enabled, the implementation
  *                adds a 20 byte header and a 4 byte footer around each memory block.
  * Parameters   :
@@ -858,9 +1352,11 @@ CyU3PDmaBufferAlloc (
 #endif
 
     uint32_t tmp;
-    uint32_t wordnum, bitnum;
+    uint32_t wordnum;
     uint32_t count, start = 0;
+    uint32_t freebits, run, len, need;
     uint32_t blk_size = (uint32_t)size;
+    CyBool_t found = CyFalse;
     void *ptr = 0;
 
     /* Get the lock for the buffer manager. */
@@ -897,58 +1393,99 @@ CyU3PDmaBufferAlloc (
     /* Find the number of cache lines required. The minimum size that can be handled is 2 cache lines. */
     size = (blk_size <= FX3_CACHE_LINE_SZ) ? 2 : ((blk_size + FX3_CACHE_LINE_SZ - 1) / FX3_CACHE_LINE_SZ);
 
-    /* Search through the status array to find the first block that fits the need. */
+    /* Search through the status array to find the first block that fits the need.
+       The last bit corresponding to the allocated memory is left as zero. This allows us to identify the
+       end of the allocated block while freeing the memory. We need to search for one additional zero while
+       allocating to account for this hack; and the block starts after the first zero found. */
+    need    = (uint32_t)size + 1;
     wordnum = glBufferManager.searchPos;
-    bitnum  = 0;
     count   = 0;
     tmp     = 0;
 
     /* Stop searching once we have checked all of the words. */
     while (tmp < glBufferManager.statusSize)
     {
-        if ((glBufferManager.usedStatus[wordnum] & (1 << bitnum)) == 0)
+        /* Work on the inverted status word, so that the free cache lines are the ones. */
+        freebits = ~glBufferManager.usedStatus[wordnum];
+
+        if (freebits == 0)
         {
+            /* All cache lines in this word are in use. */
+            count = 0;
+        }
+        else if (freebits == 0xFFFFFFFFU)
+        {
+            /* All cache lines in this word are free. */
             if (count == 0)
             {
-                start = (wordnum << 5) + bitnum + 1;
+                start = (wordnum << 5) + 1;
             }
-            count++;
-            if (count == (uint16_t)(size + 1))
+            count += 32;
+            found  = (CyBool_t)(count >= need);
+        }
+        else
+        {
+            /* A run carried over from the previous word continues with the low free bits of this word. */
+            if (count != 0)
             {
-                /* The last bit corresponding to the allocated memory is left as zero.
-                   This allows us to identify the end of the allocated block while freeing
-                   the memory. We need to search for one additional zero while allocating
-                   to account for this hack. */
-                glBufferManager.searchPos = wordnum;
-                break;
+                count += CyU3PDmaBufMgrCtz (~freebits);
+                found  = (CyBool_t)(count >= need);
+            }
+
+            /* Look for the first long enough run within the word. After this, bit n of run is set if bits
+               n to (n + need - 1) of freebits are all set. The bits shifted in from the top are zero. */
+            if ((!found) && (need <= 32))
+            {
+                run = freebits;
+                len = 1;
+                while ((len << 1) <= need)
+                {
+                    run &= (run >> len);
+                    len <<= 1;
+                }
+                run &= (run >> (need - len));
+
+                if (run != 0)
+                {
+                    start = (wordnum << 5) + CyU3PDmaBufMgrCtz (run) + 1;
+                    found = CyTrue;
+                }
+            }
+
+            /* Carry the run of free cache lines at the top of the word over to the next word. */
+            if (!found)
+            {
+                count = CyU3PDmaBufMgrClz (~freebits);
+                start = (wordnum << 5) + (32 - count) + 1;
             }
         }
-        else
+
+        if (found)
         {
-            count = 0;
+            glBufferManager.searchPos = wordnum;
+            break;
         }
 
-        bitnum++;
-        if (bitnum == 32)
+        wordnum++;
+        tmp++;
+        if (wordnum == glBufferManager.statusSize)
         {
-            bitnum = 0;
-            wordnum++;
-            tmp++;
-            if (wordnum == glBufferManager.statusSize)
-            {
-                /* Wrap back to the top of the array. */
-                wordnum = 0;
-                count   = 0;
-            }
+            /* Wrap back to the top of the array. */
+            wordnum = 0;
+            count   = 0;
         }
     }
 
-    if (count == (uint16_t)(size + 1))
+    if (found)
     {
         /* Mark the memory region identified as occupied and return the pointer. */
         CyU3PDmaBufMgrSetStatus (start, size - 1, CyTrue);
         ptr = (void *)(glBufferManager.startAddr + (start << 5));
 
+        glBufCurLines += size;
+        if (glBufCurLines > glBufPeakLines)
+            glBufPeakLines = glBufCurLines;
+
 #ifdef CYFXTX_ERRORDETECTION
         if (glBufMgrEnableChecks)
         {
@@ -971,6 +1508,10 @@ CyU3PDmaBufferAlloc (
         }
 #endif
     }
+    else
+    {
+        glBufFailCnt++;
+    }
 
     CyU3PMutexPut (&glBufferManager.lock);
     return (ptr);
@@ -992,7 +1533,7 @@ CyU3PDmaBufferFree (
 #endif
 
     uint32_t status, start, count;
-    uint32_t wordnum, bitnum;
+    uint32_t wordnum, bitnum, tmp;
     int      retVal = -1;
 
     /* Validity check for the pointer. */
@@ -1054,18 +1595,25 @@ CyU3PDmaBufferFree (
         bitnum  = (start & 0x1F);
         count   = 0;
 
-        while ((wordnum < glBufferManager.statusSize) && ((glBufferManager.usedStatus[wordnum] & (1 << bitnum)) != 0))
+        /* Count the run of ones a word at a time. The bits shifted in from the top are zero, so the run
+           within a word ends at the end of the word at the latest. */
+        while (wordnum < glBufferManager.statusSize)
         {
-            count++;
-            bitnum++;
-            if (bitnum == 32)
+            tmp = glBufferManager.usedStatus[wordnum] >> bitnum;
+            if (tmp == (0xFFFFFFFFU >> bitnum))
             {
-                bitnum = 0;
+                count  += (32 - bitnum);
+                bitnum  = 0;
                 wordnum++;
+                continue;
             }
+
+            count += CyU3PDmaBufMgrCtz (~tmp);
+            break;
         }
 
         CyU3PDmaBufMgrSetStatus (start, count, CyFalse);
+        glBufCurLines -= (count + 1);
 
         /* Start the next buffer search at the top of the heap. This can help reduce fragmentation in cases where
            most of the heap is allocated and then freed as a whole. */
@@ -1078,6 +1626,108 @@ CyU3PDmaBufferFree (
     return retVal;
 }
 
+/* Function     : CyU3PBufGetUsage
+ * Description  : Get the usage counters of the buffer alloc functions.
+ * Parameters   :
+ *                curBytes_p  : Parameter to be filled with the number of bytes currently allocated.
+ *                peakBytes_p : Parameter to be filled with the largest number of bytes allocated.
+ *                failCnt_p   : Parameter to be filled with the number of failed allocations.
+ * Return Value : None
+ */
+void
+CyU3PBufGetUsage (
+        uint32_t *curBytes_p,
+        uint32_t *peakBytes_p,
+        uint32_t *failCnt_p)
+{
+    if (curBytes_p != 0)
+        *curBytes_p = glBufCurLines * FX3_CACHE_LINE_SZ;
+    if (peakBytes_p != 0)
+        *peakBytes_p = glBufPeakLines * FX3_CACHE_LINE_SZ;
+    if (failCnt_p != 0)
+        *failCnt_p = glBufFailCnt;
+}
+
+/* Function     : CyU3PBufGetFreeRuns
+ * Description  : Walk the status array of the buffer manager, and get the total free space and the
+ *                longest run of free cache lines. As one free cache line is needed in front of each
+ *                buffer, the largest buffer that can still be allocated is one cache line smaller than
+ *                the longest run. Fully used and fully free words are handled in a single step.
+ *                This takes the buffer manager lock, and is meant to be called from thread context
+ *                when the statistics are read.
+ * Parameters   :
+ *                freeBytes_p    : Parameter to be filled with the number of free bytes.
+ *                largestBytes_p : Parameter to be filled with the size of the longest free run in bytes.
+ * Return Value : None
+ */
+void
+CyU3PBufGetFreeRuns (
+        uint32_t *freeBytes_p,
+        uint32_t *largestBytes_p)
+{
+    uint32_t wordnum, bitnum, word;
+    uint32_t total = 0, run = 0, largest = 0;
+
+    if (CyU3PMutexGet (&glBufferManager.lock, CY_U3P_BUFFER_ALLOC_TIMEOUT) == CY_U3P_SUCCESS)
+    {
+        for (wordnum = 0; wordnum < glBufferManager.statusSize; wordnum++)
+        {
+            word = glBufferManager.usedStatus[wordnum];
+            if (word == 0)
+            {
+                run   += 32;
+                total += 32;
+                continue;
+            }
+            if (word == 0xFFFFFFFFU)
+            {
+                largest = CY_U3P_MAX (largest, run);
+                run     = 0;
+                continue;
+            }
+
+            for (bitnum = 0; bitnum < 32; bitnum++)
+            {
+                if ((word & (1U << bitnum)) == 0)
+                {
+                    run++;
+                    total++;
+                }
+                else
+                {
+                    largest = CY_U3P_MAX (largest, run);
+                    run     = 0;
+                }
+            }
+        }
+        largest = CY_U3P_MAX (largest, run);
+
+        CyU3PMutexPut (&glBufferManager.lock);
+    }
+
+    if (freeBytes_p != 0)
+        *freeBytes_p = total * FX3_CACHE_LINE_SZ;
+    if (largestBytes_p != 0)
+        *largestBytes_p = largest * FX3_CACHE_LINE_SZ;
+}
+
+/* Function     : CyU3PBufResetUsage
+ * Description  : Restart the high-water mark from the current usage, and clear the failure count.
+ * Parameters   : None
+ * Return Value : None
+ */
+void
+CyU3PBufResetUsage (
+        void)
+{
+    if (CyU3PMutexGet (&glBufferManager.lock, CY_U3P_BUFFER_ALLOC_TIMEOUT) == CY_U3P_SUCCESS)
+    {
+        glBufPeakLines = glBufCurLines;
+        glBufFailCnt   = 0;
+        CyU3PMutexPut (&glBufferManager.lock);
+    }
+}
+
 /* Function    : CyU3PFreeHeaps
  * Description : This function de-initializes both driver and buffer heap allocators.
  *               This is called from the SDK library and is not expected to be called
@@ -1092,7 +1742,9 @@ CyU3PFreeHeaps (
     CyU3PDmaBufferDeInit ();
 
     CyU3PBytePoolDestroy (&glMemBytePool);
-    glMemPoolInit = CyFalse;
+    glMemPoolInit  = CyFalse;
+    glMemCurBytes  = 0;
+    glMemPeakBytes = 0;
 
 #ifdef CYFXTX_ERRORDETECTION
     /* Clear status tracking variables. */
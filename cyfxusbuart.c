@@ -33,46 +33,185 @@
 #include <cyu3utils.h>
 #include "cyfxusbuart.h"
 
+/* The solution suggested for the case keeps the device at USB 2.0 speeds, and sizes the UART to USB buffers
+   for the largest burst expected on the UART. The throughput build profile turns it off
+   (CY_FX_CB_ERROR_SOLUTION=0). */
+#ifndef CY_FX_CB_ERROR_SOLUTION
+#define CY_FX_CB_ERROR_SOLUTION         (1)
+#endif
+#if (CY_FX_CB_ERROR_SOLUTION != 0)
 #define CB_ERROR_SOLUTION_SUGGESTED /*Only when needed to check the solution suggestion from the case*/
-
-#ifdef CB_ERROR_SOLUTION_SUGGESTED
-    #include <cyu3gpio.h>
 #endif
+
 CyU3PThread       USBUARTAppThread;
+CyU3PThread       USBUARTDataThread;            /* Thread doing the time critical data path work. */
+CyU3PEvent        glUartAppEvent;               /* Event group used to wake up the application and data threads. */
+CyU3PTimer        glRxIdleTimer;                /* Timer used to detect idle periods on the UART_RX line. */
+CyU3PMutex        glAppLock;                    /* Lock used to serialize channel create/destroy operations. */
 CyU3PDmaChannel   glChHandleUsbtoUart;          /* DMA AUTO (USB TO UART) channel handle.*/
 CyU3PDmaChannel   glChHandleUarttoUsb;          /* DMA AUTO_SIG(UART TO USB) channel handle.*/
 CyU3PDmaChannel   glChHandleDebug;              /* DMA MANUAL_OUT (Debug console) channel handle. */
+CyU3PDmaChannel   glChHandleStreamOut;          /* DMA MANUAL_OUT (Stream mode, CPU TO USB) channel handle. */
+CyU3PDmaChannel   glChHandlePort2;              /* DMA MANUAL_IN (Second port, USB TO CPU) channel handle. */
+CyU3PDmaChannel   glChHandleNotify;             /* DMA MANUAL_OUT (SERIAL_STATE notifications) channel handle. */
+CyU3PDmaChannel   glChHandleCoalesceOut;        /* DMA MANUAL_OUT (Coalescing and multiplexed modes, CPU TO UART) channel handle. */
 CyBool_t          glIsApplnActive = CyFalse;    /* Whether the application is active or not. */
 CyU3PUartConfig_t glUartConfig = {0};           /* Current UART configuration. */
-volatile uint16_t glPktsPending = 0;            /* Number of packets that have been committed since last check. */
+
+/* The device connects before the initialization is done (CY_FX_CONNECT_EARLY). A SET_CONFIGURATION seen
+   until then is held back, and the application is started at the end of the initialization. */
+static CyBool_t   glAppInitDone     = CyFalse;                  /* Whether CyFxUSBUARTAppInit is done. */
+static CyBool_t   glAppStartPending = CyFalse;                  /* Whether a SET_CONFIGURATION is held back. */
+static uint32_t   glAppStartCnt     = 0;                        /* Number of times the data path was started. */
+
+/* State of the UART RX idle flush engine. The first three variables are owned by the idle timer
+   callback, and are only re-initialized while the timer is stopped. */
+static uint32_t   glRxLastCount   = 0;                          /* UART_RX_BYTE_COUNT value at the last tick. */
+static CyBool_t   glRxDataPending = CyFalse;                    /* Whether data was received since the last flush. */
+static uint16_t   glRxIdleCnt     = 0;                          /* Number of consecutive idle ticks seen. */
+static uint16_t   glRxIdleChars   = CY_FX_UART_RX_IDLE_CHARS;   /* Idle period before a flush, in character times. */
+static uint16_t   glRxIdleTicks   = 1;                          /* Idle period before a flush, in timer ticks. */
+static uint32_t   glRxBurstStart  = 0;                          /* Time at which the current burst of data started. */
+
+/* Burst length of the data endpoints, and buffer geometry of the USB to UART DMA channel. */
+static uint8_t    glEpBurstLen    = 1;                          /* Burst length used for EP 2 IN/OUT. */
+static uint16_t   glTxBufSize     = 0;                          /* Size of each DMA buffer. */
+static uint16_t   glTxBufCount    = 0;                          /* Number of DMA buffers. */
+
+/* Buffer geometry of the UART to USB DMA channel. */
+static uint16_t   glRxBufSize     = 0;                          /* Size of each DMA buffer. */
+static uint16_t   glRxBufCount    = 0;                          /* Number of DMA buffers. */
+static uint16_t   glRxReconfigCnt = 0;                          /* Number of times the channel has been re-created. */
+
+/* Type of the UART to USB DMA channel: CY_U3P_DMA_TYPE_MANUAL or CY_U3P_DMA_TYPE_AUTO_SIGNAL. */
+static CyU3PDmaType_t glRxDmaType     = CY_FX_UART_RX_DMA_TYPE;   /* Type of the channel currently in use. */
+static CyU3PDmaType_t glRxDmaTypeReq  = CY_FX_UART_RX_DMA_TYPE;   /* Type requested by the host. */
+
+/* Stream mode settings of the UART to USB path. While stream mode is on, glChHandleUarttoUsb is a
+   MANUAL_IN channel, and glChHandleStreamOut carries the data to EP 2 IN. */
+static CyFxUsbUartStreamCfg_t glRxStreamCfg    = {CY_FX_STREAM_MODE_OFF, 0, CY_FX_STREAM_SHORT_FRAME_DEFAULT}; /* In use. */
+static CyFxUsbUartStreamCfg_t glRxStreamCfgReq = {CY_FX_STREAM_MODE_OFF, 0, CY_FX_STREAM_SHORT_FRAME_DEFAULT}; /* Requested. */
+#if (CY_FX_STREAM_ENABLE != 0)
+#define CY_FX_STREAM_ACTIVE             (glRxStreamCfg.mode != CY_FX_STREAM_MODE_OFF)
+#else
+/* Compiled out: the data path does not test for the mode at all. */
+#define CY_FX_STREAM_ACTIVE             (CyFalse)
+#endif
+
+/* Whether the UART to USB buffers carry a timestamp header (CY_FX_RX_TS_HDR_SIZE). */
+static CyBool_t   glRxTs            = CyFalse;                  /* In use. */
+static CyBool_t   glRxTsReq         = CyFalse;                  /* Requested. */
+#if (CY_FX_RX_TS_ENABLE != 0)
+#define CY_FX_RX_TS_ACTIVE              (glRxTs)
+#else
+/* Compiled out: the data path does not test for the mode at all. */
+#define CY_FX_RX_TS_ACTIVE              (CyFalse)
+#endif
+
+/* Whether the USB to UART data is packed into larger buffers by the CPU (coalescing mode). */
+static CyBool_t   glTxCoalesce      = CyFalse;                  /* In use. */
+static CyBool_t   glTxCoalesceReq   = CyFalse;                  /* Requested. */
+
+/* Whether the EP 2 data path carries the native UART and the bridge ports as chunks (multiplexed mode). */
+static CyBool_t   glMux             = CyFalse;                  /* In use. */
+static CyBool_t   glMuxReq          = CyFalse;                  /* Requested. */
+#if (CY_FX_MUX_ENABLE != 0)
+#define CY_FX_MUX_ACTIVE                (glMux)
+#else
+/* Compiled out: the data path does not test for the mode at all. */
+#define CY_FX_MUX_ACTIVE                (CyFalse)
+#endif
+
+/* Benchmark mode of the EP 2 data path. The pattern and rate are only used in CY_FX_BENCH_MODE_PATTERN. */
+static uint8_t    glBenchMode       = CY_FX_BENCH_MODE_OFF;     /* Mode currently in use. */
+static uint8_t    glBenchModeReq    = CY_FX_BENCH_MODE_OFF;     /* Mode requested by the host. */
+static uint8_t    glBenchPattern    = CY_FX_BENCH_PATTERN_COUNTER;  /* Pattern to generate and check. */
+static uint16_t   glBenchRate       = 0;                        /* Generator rate in KB/s, 0 for no limit. */
+
+/* Flow control statistics. These are updated by the idle timer callback while hardware flow control
+   is enabled. */
+static CyBool_t   glFlowStalled     = CyFalse;                  /* Whether CTS was de-asserted at the last tick. */
+static uint32_t   glFlowStallTicks  = 0;                        /* Total number of ticks with CTS de-asserted. */
+static uint32_t   glFlowStallCnt    = 0;                        /* Number of times the target stalled the UART. */
+
+/* Buffer used for EP0 data transfers. */
+static uint8_t    glEp0Buffer[CY_FX_EP0_BUFFER_SIZE] __attribute__ ((aligned (32)));
+
+/* Line coding of the UART port, as sent for GET_LINE_CODING. Filled from glUartConfigReq. */
+static CyFxUsbUartLineCoding_t glUartLineCoding __attribute__ ((aligned (32))) = {115200, 0, 0, 8};
+
+/* UART configuration last requested by the host (line coding and flow control), to be applied by the
+   application thread. Only written with the interrupts disabled. */
+static CyU3PUartConfig_t glUartConfigReq = {0};
 
 /* CDC Class specific requests to be handled by this application. */
 #define SET_LINE_CODING        0x20
 #define GET_LINE_CODING        0x21
 #define SET_CONTROL_LINE_STATE 0x22
 
+/* Vendor specific requests to be handled by this application. */
+#define CY_FX_RQT_SET_RX_IDLE_CHARS     0xB0    /* Set the RX idle flush period. wValue = character times. */
+#define CY_FX_RQT_GET_RX_IDLE_CHARS     0xB1    /* Get the RX idle flush period (2 bytes, character times). */
+#define CY_FX_RQT_GET_RX_GEOMETRY       0xB2    /* Get the UART to USB DMA buffer geometry (16 bytes). */
+#define CY_FX_RQT_SET_RX_DMA_MODE       0xB3    /* Select the UART to USB channel type. wValue = 0: MANUAL,
+                                                   1: AUTO_SIGNAL. */
+#define CY_FX_RQT_GET_TX_GEOMETRY       0xB4    /* Get the data endpoint burst length, the USB to UART DMA
+                                                   buffer geometry and the coalescing mode state (10 bytes). */
+#define CY_FX_RQT_SET_FLOW_CTRL         0xB5    /* Enable/disable RTS/CTS flow control. wValue = 0: Off, 1: On. */
+#define CY_FX_RQT_GET_FLOW_CTRL         0xB6    /* Get the flow control state and stall counters (12 bytes). */
+#define CY_FX_RQT_GET_DEBUG_STATS       0xB7    /* Get the debug console pending and dropped byte counts (8 bytes). */
+#define CY_FX_RQT_SET_DEBUG_MODE        0xB8    /* Select the debug console format. wValue = 0: Text, 1: Trace. */
+#define CY_FX_RQT_GET_STATS             0xB9    /* Get the statistics block. Only accepted with wIndex = 2 (debug
+                                                   interface). wValue = 1: Clear the counters after reading. */
+#define CY_FX_RQT_GET_PROFILE           0xBA    /* Get the execution time profile. Only accepted with wIndex = 2
+                                                   (debug interface). wValue = 1: Clear the results after reading. */
+#define CY_FX_RQT_SET_STREAM_MODE       0xBB    /* Select the stream mode of the UART to USB path. wValue bits 7:0 =
+                                                   CY_FX_STREAM_MODE_*, bits 15:8 = delimiter byte or length byte
+                                                   offset. wIndex = largest short frame, 0 for the default. */
+#define CY_FX_RQT_GET_STREAM_MODE       0xBC    /* Get the requested stream mode settings and whether stream mode
+                                                   is in use (16 bytes). */
+#define CY_FX_RQT_SET_PORT2_SINK        0xBD    /* Select the sink of the second port. wValue = 0: Discard,
+                                                   1: Echo on EP 4 IN, only in text mode. */
+#define CY_FX_RQT_SET_BENCH_MODE        0xBE    /* Select the benchmark mode. wValue bits 7:0 = CY_FX_BENCH_MODE_*,
+                                                   bits 15:8 = CY_FX_BENCH_PATTERN_*. wIndex = pattern rate in
+                                                   KB/s, 0 for no limit. */
+#define CY_FX_RQT_SET_NOTIFY            0xBF    /* Select the SERIAL_STATE notifications. wValue = CY_FX_NOTIFY_*
+                                                   flags. */
+#define CY_FX_RQT_SET_RX_TIMESTAMP      0xC0    /* Enable/disable the timestamp header on the UART to USB buffers.
+                                                   wValue = 0: Off, 1: On. */
+#define CY_FX_RQT_SET_TX_COALESCE       0xC1    /* Select the USB to UART path. wValue = 0: AUTO channel,
+                                                   1: Coalescing mode. */
+#define CY_FX_RQT_SET_LPM_IDLE          0xC2    /* Set the idle period after which U1/U2 is allowed. wValue = ms,
+                                                   0 to keep LPM disabled. */
+#define CY_FX_RQT_SET_MUX_MODE          0xC3    /* Select the multiplexed mode of the EP 2 data path. wValue = 0: Off,
+                                                   1: On. */
+#define CY_FX_RQT_GET_MUX_STATUS        0xC4    /* Get the multiplexed mode state and port counters (4 + 16 bytes
+                                                   per port). */
+#define CY_FX_RQT_SET_MUX_BAUD          0xC5    /* Set the baud rate of a bridge port. wValue = port (1 to
+                                                   CY_FX_MUX_EXP_PORTS), wIndex = baud rate / 100. */
+#define CY_FX_RQT_SET_STREAM_MATCH      0xC6    /* Set the byte sequence of the pattern stream mode (data stage, up
+                                                   to CY_FX_STREAM_PATTERN_MAX bytes). wValue = CY_FX_STREAM_FLAG_*
+                                                   flags. */
+
 #ifdef CB_ERROR_SOLUTION_SUGGESTED
     /*
     * The maximum amount of data that could be received on the UART_RX pin in a burst. The DMA buffer
     * used to receive data needs to be at least of this size.
     */
     #define UART_MAX_MSG_SIZE       (128)
-
-    /*
-    * We use the UART_RX_BYTE_COUNT register to check whether any new data has been received.
-    * The register is initialized to a large value of DFLT_UART_RX_COUNT and allowed to count
-    * down as each byte is being received.
-    */
-    #define DFLT_UART_RX_COUNT      (0x400)
-
-    /*
-    * Delay between iterations of the UART task. This time should be shorter than the half of the time taken
-    * to receive UART_MAX_MSG_SIZE bytes of data on the UART_RX pin. Default value is set to 5 ms as it takes
-    * ~11 ms to receive 128 bytes of data at 115200 baud.
-    */
-    #define UART_TASK_DELAY         (5)
 #endif
 
+/*
+ * We use the UART_RX_BYTE_COUNT register to check whether any new data has been received.
+ * The register is initialized to a large value of DFLT_UART_RX_COUNT and allowed to count
+ * down as each byte is being received. The data thread re-initializes it once it
+ * drops below UART_RX_COUNT_LOW, so that the receiver never runs out of block count. As
+ * the count is maintained by the UART block itself, this works in the same way for both
+ * the MANUAL and the AUTO_SIGNAL channel types.
+ */
+#define DFLT_UART_RX_COUNT      (0x01000000)
+#define UART_RX_COUNT_LOW       (0x00800000)
+
 
 void
 CyFxAppErrorHandler (
@@ -81,9 +220,16 @@ CyFxAppErrorHandler (
 {
     /* Application failed with the error code apiRetStatus */
 
-    /* Add custom debug or recovery actions here */
+    /* Once the application thread is running, the failure is counted and the application is restarted
+       from there. The caller goes on, and any further failures it sees are taken care of by the same
+       restart. */
+    if (CyFxUsbUartRecoverIsActive ())
+    {
+        CyFxUsbUartRecoverReport (CY_FX_ERR_API, apiRetStatus);
+        return;
+    }
 
-    /* Loop Indefinitely */
+    /* Loop Indefinitely, until the watchdog resets the device. */
     for (;;)
     {
         /* Thread sleep : 100 ms */
@@ -91,580 +237,2378 @@ CyFxAppErrorHandler (
     }
 }
 
-void
-CyFxUSBUARTDmaCallback(
-        CyU3PDmaChannel   *chHandle, /* Handle to the DMA channel. */
-        CyU3PDmaCbType_t   type,     /* Callback type.             */
-        CyU3PDmaCBInput_t *input)    /* Callback status.           */
+/* Initialize the UART_RX_BYTE_COUNT register to a large value, keeping the timestamp byte index in
+   step with the bytes counted down so far. */
+static void
+CyFxUartRxReprime (
+        void)
 {
-    switch (type)
-    {
-        case CY_U3P_DMA_CB_PROD_EVENT:
-            CyU3PDmaChannelCommitBuffer (&glChHandleUarttoUsb, input->buffer_p.count, 0);
-            glPktsPending++;
+#if (CY_FX_RX_TS_ENABLE != 0)
+    uint32_t intMask;
 
-#ifdef CB_ERROR_SOLUTION_SUGGESTED
-            /* Re-initialize UART_RX_BYTE_COUNT register to a large value. */
-            CyU3PUartRxSetBlockXfer (DFLT_UART_RX_COUNT);
+    intMask = CyU3PVicDisableAllInterrupts ();
+    CyFxUsbUartTsReprime (DFLT_UART_RX_COUNT - UART->lpp_uart_rx_byte_count);
+    CyU3PUartRxSetBlockXfer (DFLT_UART_RX_COUNT);
+    CyU3PVicEnableInterrupts (intMask);
+#else
+    CyU3PUartRxSetBlockXfer (DFLT_UART_RX_COUNT);
 #endif
-            break;
+}
 
-        case CY_U3P_DMA_CB_CONS_EVENT:
-        CyFxUsbUartDebugPrint(
-            "D[CyFxUSBUARTDmaCallback] : CY_U3P_DMA_CB_CONS_EVENT\r\n");
-        break;
+/* Get the number of bits on the UART line per character, based on the current UART configuration.
+   This is the start bit + 8 data bits + optional parity bit + stop bits. */
+static uint32_t
+CyFxUartBitsPerChar (
+        void)
+{
+    return (9 + ((glUartConfig.parity != CY_U3P_UART_NO_PARITY) ? 1 : 0) +
+            ((glUartConfig.stopBit == CY_U3P_UART_TWO_STOP_BIT) ? 2 : 1));
+}
 
-        case CY_U3P_DMA_CB_ABORTED:
-        CyFxUsbUartDebugPrint(
-            "[CyFxUSBUARTDmaCallback] : CY_U3P_DMA_CB_ABORTED\r\n");
-        break;
+/* Convert the RX idle period from character times into idle timer ticks, based on the
+   current UART configuration. Needs to be called whenever the line coding changes. */
+static void
+CyFxUartRxIdleUpdate (
+        void)
+{
+    uint32_t idleUs;
 
-        case CY_U3P_DMA_CB_ERROR:
-        CyFxUsbUartDebugPrint("[CyFxUSBUARTDmaCallback] : CY_U3P_DMA_CB_ERROR\r\n");
-        break;
+    if (glUartConfig.baudRate == 0)
+    {
+        return;
+    }
 
-        case CY_U3P_DMA_CB_PROD_SUSP:
-        CyFxUsbUartDebugPrint(
-            "[CyFxUSBUARTDmaCallback] : CY_U3P_DMA_CB_PROD_SUSP\r\n");
-        break;
+    idleUs = ((uint32_t)glRxIdleChars * CyFxUartBitsPerChar () * 1000000UL) / (uint32_t)glUartConfig.baudRate;
 
-        case CY_U3P_DMA_CB_CONS_SUSP:
-        CyFxUsbUartDebugPrint(
-            "[CyFxUSBUARTDmaCallback] : CY_U3P_DMA_CB_CONS_SUSP\r\n");
+    /* The line has to be seen idle for one full tick period beyond the required idle time, as the
+       last byte could have been received at any point during the previous tick. */
+    glRxIdleTicks = (uint16_t)CY_U3P_MIN ((idleUs / CY_FX_UART_RX_IDLE_TICK_US) + 1, 0xFFFF);
 
-        default:
-            break;
-    }
+    /* The timestamps of bytes received back to back are spaced by the character time. */
+    CyFxUsbUartTsSetCharTime (glUartConfig.baudRate, CyFxUartBitsPerChar ());
 }
 
-/* This function starts the USBUART application */
-void
-CyFxUSBUARTAppStart(
-        void )
-{ 
-    uint16_t size = 0;
-    CyU3PEpConfig_t epCfg;
-    CyU3PDmaChannelConfig_t dmaCfg;
-    CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
-    CyU3PUSBSpeed_t usbSpeed = CyU3PUsbGetSpeed();
-
-    /* Based on the Bus speed configure the endpoint packet size */
-    switch (usbSpeed)
-    {
-        case CY_U3P_FULL_SPEED:
-            size = 64;
-            break;
-
-        case CY_U3P_HIGH_SPEED:
-            size = 512;
-            break;
+/* Callback for the RX idle timer. This is called once every tick, and checks whether the UART
+   receiver has been idle for long enough that any partially filled DMA buffer should be sent
+   to the host. The actual wrap-up is done from the data thread. */
+static void
+CyFxUartRxIdleTimerCb (
+        uint32_t input)
+{
+    uint32_t count = UART->lpp_uart_rx_byte_count;
 
-        case  CY_U3P_SUPER_SPEED:
-            /* Turning low power mode off to avoid USB transfer delays. */
-            CyU3PUsbLPMDisable ();
-            size = 1024;
-            break;
+    CyFxUsbUartLpmTick ();
 
-        default:
-            CyFxAppErrorHandler (CY_U3P_ERROR_FAILURE);
-            break;
+    /* Events collected since the last tick are sent as a single notification. */
+    if (CyFxUsbUartNotifyPending ())
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_NOTIFY, CYU3P_EVENT_OR);
     }
 
-    CyU3PMemSet ((uint8_t *)&epCfg, 0, sizeof (epCfg));
-    epCfg.enable = CyTrue;
-    epCfg.epType = CY_U3P_USB_EP_BULK;
-    epCfg.burstLen = 1;
-    epCfg.streams = 0;
-    epCfg.pcktSize = size;
-
-    /* Producer endpoint configuration */
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_PRODUCER , &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {    
-        CyFxAppErrorHandler (apiRetStatus);
+    /* The bridge ports are polled, and partial buffers sent, once per tick. */
+    if (CY_FX_MUX_ACTIVE)
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_MUX, CYU3P_EVENT_OR);
     }
 
-    /* Consumer endpoint configuration */
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_CONSUMER, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
-        CyFxAppErrorHandler (apiRetStatus);
+    /* The UART is not connected to the data endpoints in these benchmark modes. */
+    if (glBenchMode == CY_FX_BENCH_MODE_PATTERN)
+    {
+        CyFxUsbUartBenchTick ();
+        return;
     }
-
-    /* Interrupt endpoint configuration */
-    epCfg.epType = CY_U3P_USB_EP_INTR;
-    epCfg.pcktSize = 64;
-    epCfg.isoPkts = 1;
-
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_INTERRUPT, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    if (glBenchMode == CY_FX_BENCH_MODE_USB_LOOPBACK)
     {
-        CyFxAppErrorHandler(apiRetStatus);
+        return;
     }
 
-    /* Debug Endpoint Configuration */
-    /* Debug Interrupt Endpoint */
-    epCfg.epType = CY_U3P_USB_EP_INTR;
-    epCfg.pcktSize = (usbSpeed == CY_U3P_SUPER_SPEED) ? 1024 : 64;
-    epCfg.isoPkts = 1;
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_INTERRUPT, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    /* Account for the time during which the target holds off the UART transmitter. */
+    if (glUartConfig.flowCtrl)
     {
-        CyFxAppErrorHandler(apiRetStatus);
+        if ((UART->lpp_uart_status & CY_U3P_LPP_UART_CTS_STAT) == 0)
+        {
+            if (!glFlowStalled)
+            {
+                glFlowStalled = CyTrue;
+                glFlowStallCnt++;
+                CY_FX_TRACE2 (CY_FX_TRACE_EVT_FLOW_STALL, 1, glFlowStallCnt);
+            }
+            glFlowStallTicks++;
+        }
+        else if (glFlowStalled)
+        {
+            glFlowStalled = CyFalse;
+            CY_FX_TRACE2 (CY_FX_TRACE_EVT_FLOW_STALL, 0, glFlowStallCnt);
+        }
     }
 
-    /* Debug Consumer Endpoint (Bulk IN) */
-    epCfg.epType = CY_U3P_USB_EP_BULK;
-    epCfg.pcktSize = size;
-    epCfg.streams = 0;
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_CONSUMER, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    if (count != glRxLastCount)
     {
-        CyFxAppErrorHandler(apiRetStatus);
+        /* New data has been received during the last tick. If the line was idle before, this is the
+           start of a new burst for the latency statistics. */
+        if (!glRxDataPending)
+        {
+            glRxBurstStart = CyU3PGetTime ();
+        }
+        glRxLastCount   = count;
+        glRxDataPending = CyTrue;
+        glRxIdleCnt     = 0;
+        CyFxUsbUartStartupMark (CY_FX_STARTUP_FIRST_RX);
+        CyFxUsbUartNotifyEvent (CY_FX_SERIAL_STATE_DATA_AVAIL);
+        CyFxUsbUartLpmActivity ();
+        if ((CY_FX_STREAM_ACTIVE) && ((glRxStreamCfg.flags & CY_FX_STREAM_FLAG_TICK) != 0))
+        {
+            CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_RX_PEEK, CYU3P_EVENT_OR);
+        }
+        if (CY_FX_RX_TS_ACTIVE)
+        {
+            CyFxUsbUartTsSample (DFLT_UART_RX_COUNT - count);
+        }
+
+        /* Get the byte count re-initialized before the receiver runs out of it. */
+        if (count < UART_RX_COUNT_LOW)
+        {
+            CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_RX_REPRIME, CYU3P_EVENT_OR);
+        }
+        return;
     }
 
-    /* Debug Producer Endpoint (Bulk OUT - Dummy) */
-    epCfg.epType = CY_U3P_USB_EP_BULK;
-    epCfg.pcktSize = size;
-    epCfg.streams = 0;
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_PRODUCER, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    if ((glRxDataPending) && (++glRxIdleCnt >= glRxIdleTicks))
     {
-        CyFxAppErrorHandler(apiRetStatus);
+        glRxDataPending = CyFalse;
+        glRxIdleCnt     = 0;
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_RX_IDLE, CYU3P_EVENT_OR);
     }
+}
 
+/* Callback for UART events. Only errors are notified in DMA mode, and these are counted. */
+static void
+CyFxUartEventCb (
+        CyU3PUartEvt_t   evt,
+        CyU3PUartError_t error)
+{
+    if (evt != CY_U3P_UART_EVENT_ERROR)
+    {
+        return;
+    }
 
-    /* Create a DMA_AUTO channel between usb producer socket and uart consumer socket */
-    dmaCfg.size = size;
-    dmaCfg.count = CY_FX_USBUART_DMA_BUF_COUNT;
-    dmaCfg.prodSckId = CY_FX_EP_PRODUCER1_SOCKET;
-    dmaCfg.consSckId = CY_FX_EP_CONSUMER1_SOCKET;
-    dmaCfg.dmaMode = CY_U3P_DMA_MODE_BYTE;
-    dmaCfg.notification = 0;
-    dmaCfg.cb = NULL;
-    dmaCfg.prodHeader = 0;
-    dmaCfg.prodFooter = 0;
-    dmaCfg.consHeader = 0;
-    dmaCfg.prodAvailCount = 0;
-
-    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUsbtoUart,
-            CY_U3P_DMA_TYPE_AUTO, &dmaCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
-        CyFxAppErrorHandler(apiRetStatus);
+    switch (error)
+    {
+        case CY_U3P_UART_ERROR_RX_PARITY_ERROR:
+            glUsbUartStats.uartParityErr++;
+            CyFxUsbUartNotifyEvent (CY_FX_SERIAL_STATE_PARITY);
+            break;
+        case CY_U3P_UART_ERROR_RX_OVERFLOW:
+            glUsbUartStats.uartRxOverflow++;
+            CyFxUsbUartNotifyEvent (CY_FX_SERIAL_STATE_OVERRUN);
+            break;
+        case CY_U3P_UART_ERROR_TX_OVERFLOW:
+            glUsbUartStats.uartTxOverflow++;
+            break;
+        default:
+            glUsbUartStats.uartOtherErr++;
+            break;
     }
+}
 
-    /* Create a DMA_MANUAL channel between uart producer socket and usb consumer socket */
-#ifndef CB_ERROR_SOLUTION_SUGGESTED
-    /* Use a smaller buffer size (32 bytes) to ensure that packets get filled in a short time. */
-    dmaCfg.size         = 32;
-#else
-    dmaCfg.size         = UART_MAX_MSG_SIZE;
-#endif
+/* Get the channel that feeds the UART: the USB to UART channel, or the UART side channel in the coalescing
+   and multiplexed modes. */
+static CyU3PDmaChannel *
+CyFxUsbUartTxChannel (
+        void)
+{
+    return ((glTxCoalesce) || (CY_FX_MUX_ACTIVE)) ? &glChHandleCoalesceOut : &glChHandleUsbtoUart;
+}
 
-    dmaCfg.prodSckId    = CY_FX_EP_PRODUCER2_SOCKET;
-    dmaCfg.consSckId    = CY_FX_EP_CONSUMER2_SOCKET;    
+/* Get the number of bytes transferred so far by the active data channels. These counts are maintained
+   by the DMA hardware, and are added to the statistics block when a channel is destroyed. */
+static void
+CyFxUsbUartStatsLiveBytes (
+        uint32_t *liveBytes)
+{
+    CyU3PDmaState_t state;
+    uint32_t prodCnt, consCnt;
 
-    dmaCfg.notification = CY_U3P_DMA_CB_PROD_EVENT | CY_U3P_DMA_CB_PROD_SUSP |
-                          CY_U3P_DMA_CB_CONS_SUSP | CY_U3P_DMA_CB_ABORTED |
-                          CY_U3P_DMA_CB_ERROR;
-    dmaCfg.cb           = CyFxUSBUARTDmaCallback;
+    liveBytes[CY_FX_STATS_CH_USBTOUART] = 0;
+    liveBytes[CY_FX_STATS_CH_UARTTOUSB] = 0;
+    liveBytes[CY_FX_STATS_CH_DEBUG]     = 0;
+    liveBytes[CY_FX_STATS_CH_PORT2]     = 0;
 
-    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUarttoUsb,
-            CY_U3P_DMA_TYPE_MANUAL, &dmaCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
-        CyFxAppErrorHandler(apiRetStatus);
+    /* The pattern generator and checker count their data as it is processed. */
+    if ((glIsApplnActive) && (glBenchMode != CY_FX_BENCH_MODE_PATTERN))
+    {
+        if (CyU3PDmaChannelGetStatus (CyFxUsbUartTxChannel (), &state, &prodCnt, &consCnt) == CY_U3P_SUCCESS)
+        {
+            liveBytes[CY_FX_STATS_CH_USBTOUART] = consCnt;
+        }
+        if ((glBenchMode != CY_FX_BENCH_MODE_USB_LOOPBACK) && CyU3PDmaChannelGetStatus (((CY_FX_STREAM_ACTIVE) || (CY_FX_MUX_ACTIVE)) ? &glChHandleStreamOut :
+                    &glChHandleUarttoUsb, &state, &prodCnt, &consCnt) == CY_U3P_SUCCESS)
+        {
+            liveBytes[CY_FX_STATS_CH_UARTTOUSB] = consCnt;
+        }
     }
+}
 
-    /* Set DMA Channel transfer size */
-    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUsbtoUart,0);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
-        CyFxAppErrorHandler(apiRetStatus);
-    }
+/* Get a value that changes whenever data has moved on the EP 2 data path, for the link power management
+   policy. Called with glAppLock held. */
+static uint32_t
+CyFxUsbUartTrafficCount (
+        void)
+{
+    uint32_t liveBytes[CY_FX_STATS_CH_COUNT];
 
-    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUarttoUsb, 0);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
-        CyFxAppErrorHandler(apiRetStatus);
-    }
+    CyFxUsbUartStatsLiveBytes (liveBytes);
+    return (liveBytes[CY_FX_STATS_CH_USBTOUART] + liveBytes[CY_FX_STATS_CH_UARTTOUSB] +
+            glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].bytes + glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].bytes +
+            glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].buffers + glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].buffers +
+            glUsbUartStats.benchWords);
+}
 
-    /* Create DMA Channel for Debug Console (CPU to USB) */
-    dmaCfg.size = size;
-    dmaCfg.count = 4;
-    dmaCfg.prodSckId = CY_U3P_CPU_SOCKET_PROD;
-    dmaCfg.consSckId = CY_FX_EP_DEBUG_CONS_SOCKET;
-    dmaCfg.dmaMode = CY_U3P_DMA_MODE_BYTE;
-    dmaCfg.notification = 0;
-    dmaCfg.cb = NULL;
-    dmaCfg.prodHeader = 0;
-    dmaCfg.prodFooter = 0;
-    dmaCfg.consHeader = 0;
-    dmaCfg.prodAvailCount = 0;
+/* Add the byte count of a data channel that is about to be destroyed to the statistics block. */
+static void
+CyFxUsbUartStatsChannelDone (
+        CyU3PDmaChannel *chHandle,
+        uint8_t          chIndex)
+{
+    CyU3PDmaState_t state;
+    uint32_t prodCnt, consCnt;
 
-    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleDebug,
-            CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    if (CyU3PDmaChannelGetStatus (chHandle, &state, &prodCnt, &consCnt) == CY_U3P_SUCCESS)
     {
-        CyFxAppErrorHandler(apiRetStatus);
+        glUsbUartStats.ch[chIndex].bytes += consCnt;
     }
+}
 
-    /* Set Debug DMA Channel transfer size */
-    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleDebug, 0);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+/* Put the UART block into internal loopback mode while the UART loopback benchmark is selected. This has
+   to be repeated after each CyU3PUartSetConfig call, which rewrites the UART configuration. */
+static void
+CyFxUartLoopbackUpdate (
+        void)
+{
+    if (glBenchMode == CY_FX_BENCH_MODE_UART_LOOPBACK)
     {
-        CyFxAppErrorHandler(apiRetStatus);
+        UART->lpp_uart_config |= CY_U3P_LPP_UART_LOOPBACK;
     }
+    else
+    {
+        UART->lpp_uart_config &= ~CY_U3P_LPP_UART_LOOPBACK;
+    }
+}
 
-    /* Update the status flag. */
-    glIsApplnActive = CyTrue;
-} 
+/* Copy the UART configuration last requested by the host. The setup callback updates it with the
+   interrupts disabled, so the copy is taken the same way. */
+static void
+CyFxUartConfigReqGet (
+        CyU3PUartConfig_t *config_p)
+{
+    uint32_t intMask;
 
-void
-CyFxUSBUARTAppStop (
+    intMask = CyU3PVicDisableAllInterrupts ();
+    CyU3PMemCopy ((uint8_t *)config_p, (uint8_t *)&glUartConfigReq, sizeof (CyU3PUartConfig_t));
+    CyU3PVicEnableInterrupts (intMask);
+}
+
+/* Update the line coding reported to the host from the UART configuration last requested. A
+   SET_LINE_CODING is reported back straight away, before the application thread applies it. The FX3
+   UART always uses 8 data bits. */
+static void
+CyFxUartLineCodingUpdate (
         void)
 {
-    CyU3PEpConfig_t epCfg;
-    CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
+    CyU3PUartConfig_t uartConfig;
 
-    /* Update the flag. */
-    glIsApplnActive = CyFalse;
+    CyFxUartConfigReqGet (&uartConfig);
+    glUartLineCoding.dwDTERate   = (uint32_t)uartConfig.baudRate;
+    glUartLineCoding.bCharFormat = (uartConfig.stopBit == CY_U3P_UART_TWO_STOP_BIT) ? 2 : 0;
+    glUartLineCoding.bParityType = (uartConfig.parity == CY_U3P_UART_EVEN_PARITY) ? 2 :
+        ((uartConfig.parity == CY_U3P_UART_ODD_PARITY) ? 1 : 0);
+    glUartLineCoding.bDataBits   = 8;
+}
 
-    /* Flush the endpoint memory */
-    CyU3PUsbFlushEp(CY_FX_EP_PRODUCER);
-    CyU3PUsbFlushEp(CY_FX_EP_CONSUMER);
-    CyU3PUsbFlushEp(CY_FX_EP_INTERRUPT);
+/* Apply the line coding and flow control setting last requested by the host. The UART is only
+   re-programmed if the settings differ from the current configuration, so that repeated requests with
+   the same settings do not disturb the data flow. Before a change of the baud rate or the framing, the
+   UART sockets are quiesced: the USB to UART channel gets up to CY_FX_UART_LINE_CODING_DRAIN_MS to hand
+   the data already sent by the host to the UART, and the UART then gets the time of
+   CY_FX_UART_TX_FIFO_CHARS characters to shift it out, so that it still goes out at the old rate. Any
+   partial UART to USB buffer is wrapped up. The time from the start of the drain until the UART runs
+   again is added to the dead time statistics. This is called from the application thread, with
+   glAppLock held. The lock is released while the thread sleeps between the polls of the drain, so that
+   the USB callbacks and the data thread are not held up for all of it; the data path is checked again
+   each time it is taken back. The request is read again after the drain, so that a flow control change
+   made by the host in the meantime is not undone by the new configuration. */
+static CyU3PReturnStatus_t
+CyFxUartLineCodingSet (
+        void)
+{
+    CyU3PUartConfig_t uartConfig;
+    CyU3PDmaState_t state;
+    uint32_t prodCnt, consCnt;
+    uint32_t startTime, deadTime, waitMs;
+    uint32_t intMask;
+    CyBool_t framing, flowChange;
+    CyU3PReturnStatus_t apiRetStatus;
+    CY_FX_PROF_DECLARE (profStart);
+
+    CyFxUartConfigReqGet (&uartConfig);
+    framing = (CyBool_t)((uartConfig.baudRate != glUartConfig.baudRate) ||
+            (uartConfig.stopBit != glUartConfig.stopBit) || (uartConfig.parity != glUartConfig.parity));
+    if ((!framing) && (uartConfig.flowCtrl == glUartConfig.flowCtrl))
+    {
+        glUsbUartStats.lineCodingSkipped++;
+        return CY_U3P_SUCCESS;
+    }
 
-    /* Destroy the channel */
-    CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
-    CyU3PDmaChannelDestroy (&glChHandleUarttoUsb);
+    CY_FX_PROF_ENTER (profStart);
+    startTime = CyU3PGetTime ();
 
-    /* Disable endpoints. */
-    CyU3PMemSet ((uint8_t *)&epCfg, 0, sizeof (epCfg));
-    epCfg.enable = CyFalse;
-
-    /* Producer endpoint configuration. */
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_PRODUCER, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    if (framing)
     {
-        CyFxAppErrorHandler (apiRetStatus);
-    }
+        /* The UART sockets are only connected in normal operation and in the UART loopback mode. The
+           transmitter has to be done with the last byte as well, before the divider is changed. */
+        waitMs = CY_FX_UART_LINE_CODING_DRAIN_MS + 1 + (uint32_t)((CY_FX_UART_TX_FIFO_CHARS *
+                    CyFxUartBitsPerChar () * 1000UL) / (uint32_t)glUartConfig.baudRate);
+        while ((CyU3PGetTime () - startTime) < waitMs)
+        {
+            if ((!glIsApplnActive) || ((glBenchMode != CY_FX_BENCH_MODE_OFF) && (glBenchMode != CY_FX_BENCH_MODE_UART_LOOPBACK)) ||
+                    (CyU3PDmaChannelGetStatus (CyFxUsbUartTxChannel (), &state, &prodCnt, &consCnt) != CY_U3P_SUCCESS))
+            {
+                break;
+            }
 
-    /* Consumer endpoint configuration. */
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_CONSUMER, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {
-        CyFxAppErrorHandler (apiRetStatus);
+            /* Past the drain time, only the data already in the UART is waited for. */
+            if ((prodCnt == consCnt) || ((CyU3PGetTime () - startTime) >= CY_FX_UART_LINE_CODING_DRAIN_MS))
+            {
+                if ((UART->lpp_uart_status & CY_U3P_LPP_UART_TX_DONE) != 0)
+                {
+                    break;
+                }
+            }
+
+            CyU3PMutexPut (&glAppLock);
+            CyU3PThreadSleep (1);
+            CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+        }
+
+        if ((glIsApplnActive) && ((glBenchMode == CY_FX_BENCH_MODE_OFF) || (glBenchMode == CY_FX_BENCH_MODE_UART_LOOPBACK)))
+        {
+            if (glRxDataPending)
+            {
+                if (CY_FX_STREAM_ACTIVE)
+                {
+                    CyFxUsbUartStreamWrapUp (CyTrue);
+                }
+                else
+                {
+                    CyU3PDmaChannelSetWrapUp (&glChHandleUarttoUsb);
+                }
+                glRxDataPending = CyFalse;
+            }
+        }
+
+        /* Pick up any change the host made while the lock was released. */
+        CyFxUartConfigReqGet (&uartConfig);
     }
 
-    /* Interrupt endpoint configuration. */
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_INTERRUPT, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    flowChange = (CyBool_t)(uartConfig.flowCtrl != glUartConfig.flowCtrl);
+    apiRetStatus = CyU3PUartSetConfig (&uartConfig, CyFxUartEventCb);
+    if (apiRetStatus == CY_U3P_SUCCESS)
     {
-        CyFxAppErrorHandler (apiRetStatus);
+        CyU3PMemCopy ((uint8_t *)&glUartConfig, (uint8_t *)&uartConfig, sizeof (CyU3PUartConfig_t));
+        CyFxUartLoopbackUpdate ();
+        if (framing)
+        {
+            glUsbUartStats.lineCodingChanges++;
+            CY_FX_TRACE3 (CY_FX_TRACE_EVT_LINE_CODING, glUartConfig.baudRate, glUartConfig.stopBit,
+                    glUartConfig.parity);
+        }
+        if (flowChange)
+        {
+            glFlowStalled = CyFalse;
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_FLOW_CTRL, glUartConfig.flowCtrl);
+        }
     }
-
-    /* Disable Debug Endpoints */
-    /* Debug Interrupt */
-    CyU3PUsbFlushEp(CY_FX_EP_DEBUG_INTERRUPT);
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_INTERRUPT, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    else
     {
-        CyFxAppErrorHandler (apiRetStatus);
+        /* Report the configuration in use again, unless the host has asked for another one since. */
+        intMask = CyU3PVicDisableAllInterrupts ();
+        if ((glUartConfigReq.baudRate == uartConfig.baudRate) && (glUartConfigReq.stopBit == uartConfig.stopBit) &&
+                (glUartConfigReq.parity == uartConfig.parity) && (glUartConfigReq.flowCtrl == uartConfig.flowCtrl))
+        {
+            CyU3PMemCopy ((uint8_t *)&glUartConfigReq, (uint8_t *)&glUartConfig, sizeof (CyU3PUartConfig_t));
+        }
+        CyU3PVicEnableInterrupts (intMask);
     }
-    /* Debug Consumer */
-    CyU3PUsbFlushEp(CY_FX_EP_DEBUG_CONSUMER);
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_CONSUMER, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+
+    /* Initialize the UART_RX_BYTE_COUNT register to a large value. The idle monitor starts from the new
+       value, so that the re-prime is not taken for received data. */
+    CyFxUartRxReprime ();
+    glRxLastCount = UART->lpp_uart_rx_byte_count;
+
+    if (framing)
     {
-        CyFxAppErrorHandler (apiRetStatus);
+        deadTime = CyU3PGetTime () - startTime;
+        glUsbUartStats.lineCodingDeadMs += deadTime;
+        glUsbUartStats.lineCodingDeadMaxMs = CY_U3P_MAX (glUsbUartStats.lineCodingDeadMaxMs, deadTime);
     }
+    CY_FX_PROF_EXIT (CY_FX_PROF_SITE_LINE_CODING, profStart);
 
-    /* Debug Producer (Dummy) */
-    CyU3PUsbFlushEp(CY_FX_EP_DEBUG_PRODUCER);
-    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_PRODUCER, &epCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    if (framing)
     {
-        CyFxAppErrorHandler (apiRetStatus);
+        /* The idle period depends on the character time at the new baud rate. */
+        CyFxUartRxIdleUpdate ();
+
+        /* Have the application thread re-size the UART to USB channel if a different buffer
+           geometry suits the new baud rate better. */
+        if (glIsApplnActive)
+        {
+            CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_RX_RECONFIG, CYU3P_EVENT_OR);
+        }
     }
 
-    /* Destroy Debug Channel */
-    CyU3PDmaChannelDestroy (&glChHandleDebug);
+    return apiRetStatus;
 }
 
-/* This is the callback function to handle the USB events. */
+/* Apply the UART configuration last requested by the host through SET_LINE_CODING or
+   CY_FX_RQT_SET_FLOW_CTRL. */
+static void
+CyFxUartLineCodingApply (
+        void)
+{
+    CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+    CyFxUartLineCodingSet ();
+    CyU3PMutexPut (&glAppLock);
+}
+
+/* Add the time since the first byte of the data just sent to EP 2 IN was received to the RX latency
+   histogram. Called for each buffer committed on the UART to USB path, including those sent by a
+   wrap-up. The next byte received starts the next buffer. */
 void
-CyFxUSBUARTAppUSBEventCB (
-        CyU3PUsbEventType_t evtype, /* Event type */
-        uint16_t            evdata  /* Event data */
-        )
+CyFxUsbUartRxLatencySample (
+        void)
 {
-    switch (evtype)
+    uint32_t now = CyU3PGetTime ();
+
+    CyFxUsbUartStatsRxLatency (now - glRxBurstStart);
+    glRxBurstStart = now;
+}
+
+void
+CyFxUSBUARTDmaCallback(
+        CyU3PDmaChannel   *chHandle, /* Handle to the DMA channel. */
+        CyU3PDmaCbType_t   type,     /* Callback type.             */
+        CyU3PDmaCBInput_t *input)    /* Callback status.           */
+{
+    CyBool_t isTx = (CyBool_t)((chHandle == &glChHandleUsbtoUart) || (chHandle == &glChHandleCoalesceOut));
+    CyFxUsbUartChStats_t *stats_p;
+    CY_FX_PROF_DECLARE (profStart);
+
+    CY_FX_PROF_ENTER (profStart);
+
+    /* Notifications of any other channel are not added to the data channel counters. The stream
+       channel is only created in the stream and mux modes. */
+    if (isTx)
     {
-        case CY_U3P_USB_EVENT_SETCONF:
-            /* Stop the application before re-starting. */
-            if (glIsApplnActive)
+        stats_p = &glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART];
+    }
+    else if ((chHandle == &glChHandleUarttoUsb) || (((CY_FX_STREAM_ENABLE != 0) || (CY_FX_MUX_ENABLE != 0)) &&
+                (chHandle == &glChHandleStreamOut)))
+    {
+        stats_p = &glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB];
+    }
+    else
+    {
+        glUsbUartStats.dmaCbUnknown++;
+        CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
+        CY_FX_PROF_EXIT (CY_FX_PROF_SITE_DMA_CB, profStart);
+        return;
+    }
+
+    switch (type)
+    {
+        case CY_U3P_DMA_CB_PROD_EVENT:
+            /* The MANUAL channel commits each buffer here. The AUTO_SIGNAL channel forwards the data
+               without any firmware involvement, and only signals each buffer for the latency
+               statistics. In timestamp mode, the header goes out in front of the data. */
+            if (CY_FX_RX_TS_ACTIVE)
             {
-                CyFxUSBUARTAppStop ();
+                CyU3PDmaChannelCommitBuffer (&glChHandleUarttoUsb, CyFxUsbUartTsFill (input->buffer_p.buffer,
+                            input->buffer_p.count, (CyBool_t)(input->buffer_p.count < glRxBufSize),
+                            DFLT_UART_RX_COUNT - UART->lpp_uart_rx_byte_count), 0);
             }
-            /* Start the loop back function. */
-            CyFxUSBUARTAppStart ();
-            break;
-
-        case CY_U3P_USB_EVENT_RESET:
-        case CY_U3P_USB_EVENT_CONNECT:
-        case CY_U3P_USB_EVENT_DISCONNECT:
-            /* Stop the loop back function. */
-            if (glIsApplnActive)
+            else if (glRxDmaType == CY_U3P_DMA_TYPE_MANUAL)
             {
-                CyU3PUsbLPMEnable ();
-                CyFxUSBUARTAppStop ();
+                CyU3PDmaChannelCommitBuffer (&glChHandleUarttoUsb, input->buffer_p.count, 0);
             }
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_RX_COMMIT, input->buffer_p.count);
+
+            CyFxUsbUartRxLatencySample ();
+            stats_p->buffers++;
+            break;
+
+        case CY_U3P_DMA_CB_ERROR:
+            stats_p->errors++;
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
+            CyFxUsbUartRecoverReport ((isTx) ? CY_FX_ERR_USBTOUART : CY_FX_ERR_UARTTOUSB, type);
+            break;
+
+        case CY_U3P_DMA_CB_ABORTED:
+            stats_p->aborts++;
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
+            break;
+
+        case CY_U3P_DMA_CB_PROD_SUSP:
+            stats_p->prodSusp++;
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
+            break;
+
+        case CY_U3P_DMA_CB_CONS_SUSP:
+            stats_p->consSusp++;
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
             break;
 
         default:
+            /* All other notifications are only logged. */
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
             break;
     }
-}
 
+    CY_FX_PROF_EXIT (CY_FX_PROF_SITE_DMA_CB, profStart);
+}
 
-/* Callback to handle the USB Setup Requests and CDC Class events */
-static CyBool_t
-CyFxUSBUARTAppUSBSetupCB (
-        uint32_t setupdat0, /* SETUP Data 0 */
-        uint32_t setupdat1  /* SETUP Data 1 */
-        )
+/* Select the DMA buffer geometry for the UART to USB channel. The buffer size is chosen such that a
+   buffer fills up in about CY_FX_UART_RX_BUF_FILL_US at the current baud rate. This keeps the buffer
+   commit (and DMA callback) rate bounded at high baud rates, while not adding latency at low
+   baud rates. */
+static void
+CyFxUartRxGeometrySelect (
+        CyU3PUSBSpeed_t  usbSpeed,      /* Current USB connection speed. */
+        uint16_t        *bufSize_p,     /* Return parameter for the buffer size. */
+        uint16_t        *bufCount_p)    /* Return parameter for the buffer count. */
 {
-    uint16_t readCount = 0;
-    uint8_t  bRequest, bReqType;
-    uint8_t  bType, bTarget;
-    uint16_t wValue, wIndex;
-    uint8_t config_data[7];
-    CyBool_t isHandled = CyFalse;
-    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
-    CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
-    CyU3PUartConfig_t uartConfig;
+    uint32_t fillSize, maxSize, size;
 
-    /* Fast enumeration is used. Only requests addressed to the interface, class,
-     * vendor and unknown control requests are received by this function. */
+    if (glRxStreamCfgReq.mode != CY_FX_STREAM_MODE_OFF)
+    {
+        /* Stream mode uses small UART side buffers, so that the firmware sees the data early. */
+        *bufSize_p  = CY_FX_STREAM_RX_BUF_SIZE;
+        *bufCount_p = CY_FX_STREAM_RX_BUF_COUNT;
+        return;
+    }
 
-    /* Decode the fields from the setup request. */
-    bReqType = (setupdat0 & CY_U3P_USB_REQUEST_TYPE_MASK);
-    bType    = (bReqType & CY_U3P_USB_TYPE_MASK);
-    bTarget  = (bReqType & CY_U3P_USB_TARGET_MASK);
-    bRequest = ((setupdat0 & CY_U3P_USB_REQUEST_MASK) >> CY_U3P_USB_REQUEST_POS);
-    wValue   = ((setupdat0 & CY_U3P_USB_VALUE_MASK)   >> CY_U3P_USB_VALUE_POS);
-    wIndex   = (setupdat1 & CY_U3P_USB_INDEX_MASK);
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+    /* The channel outlives the USB connection, and is sized for the fastest connection allowed. */
+    usbSpeed = CY_FX_USBUART_PERSIST_SPEED;
+#endif
+
+    switch (usbSpeed)
+    {
+        case CY_U3P_SUPER_SPEED:
+            maxSize = CY_FX_UART_RX_BUF_MAX_SS;
+            break;
+        case CY_U3P_HIGH_SPEED:
+            maxSize = CY_FX_UART_RX_BUF_MAX_HS;
+            break;
+        default:
+            maxSize = CY_FX_UART_RX_BUF_MAX_FS;
+            break;
+    }
+
+    /* Number of bytes received on the UART during the target fill time. */
+    fillSize = (((uint32_t)glUartConfig.baudRate / CyFxUartBitsPerChar ()) * CY_FX_UART_RX_BUF_FILL_US) / 1000000UL;
 
-    if (bType == CY_U3P_USB_STANDARD_RQT)
+    /* Round up to a power of two within the allowed range. */
+#ifndef CB_ERROR_SOLUTION_SUGGESTED
+    size = CY_FX_UART_RX_BUF_MIN_SIZE;
+#else
+    /* The buffer needs to be able to hold the largest burst of data expected on the UART. */
+    size = UART_MAX_MSG_SIZE;
+#endif
+    while ((size < fillSize) && (size < maxSize))
+    {
+        size <<= 1;
+    }
+
+    *bufSize_p  = (uint16_t)size;
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+    /* The buffers also hold the data received while the host is away. */
+    *bufCount_p = (uint16_t)CY_U3P_MAX (2, CY_U3P_MIN (CY_FX_UART_RX_HOLD_BUF_COUNT, CY_FX_UART_RX_HOLD_BUDGET / size));
+#else
+    *bufCount_p = (uint16_t)CY_U3P_MAX (2, CY_U3P_MIN (CY_FX_USBUART_DMA_BUF_COUNT, CY_FX_UART_RX_BUF_BUDGET / size));
+#endif
+}
+
+/* Create the UART to USB DMA channel with the currently selected buffer geometry and type, and start it.
+   The MANUAL channel commits each buffer from the DMA callback. The AUTO_SIGNAL channel lets the
+   hardware forward the buffers, and notifies the firmware of each buffer only for the latency
+   statistics. In
+   stream mode, a MANUAL_IN channel from the UART and a MANUAL_OUT channel to EP 2 IN are created
+   instead, and the stream mode DMA callback copies the data across. In timestamp mode, a MANUAL
+   channel is used with header space in front of the data of each buffer. */
+static CyU3PReturnStatus_t
+CyFxUartRxChannelCreate (
+        void)
+{
+    CyU3PDmaChannelConfig_t dmaCfg;
+    CyU3PReturnStatus_t apiRetStatus;
+
+    CyU3PMemSet ((uint8_t *)&dmaCfg, 0, sizeof (dmaCfg));
+    dmaCfg.size         = glRxBufSize;
+    dmaCfg.count        = glRxBufCount;
+    dmaCfg.prodSckId    = CY_FX_EP_PRODUCER2_SOCKET;
+    dmaCfg.consSckId    = CY_FX_EP_CONSUMER2_SOCKET;
+    dmaCfg.dmaMode      = CY_U3P_DMA_MODE_BYTE;
+    dmaCfg.notification = CY_U3P_DMA_CB_PROD_SUSP | CY_U3P_DMA_CB_CONS_SUSP |
+                          CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+
+    if (CY_FX_STREAM_ACTIVE)
     {
-        /* Handle SET_FEATURE(FUNCTION_SUSPEND) and CLEAR_FEATURE(FUNCTION_SUSPEND)
-         * requests here. It should be allowed to pass if the device is in configured
-         * state and failed otherwise. */
-        if ((bTarget == CY_U3P_USB_TARGET_INTF) && ((bRequest == CY_U3P_USB_SC_SET_FEATURE)
-                    || (bRequest == CY_U3P_USB_SC_CLEAR_FEATURE)) && (wValue == 0))
+        dmaCfg.consSckId     = CY_U3P_CPU_SOCKET_CONS;
+        dmaCfg.notification |= CY_U3P_DMA_CB_PROD_EVENT;
+        dmaCfg.cb            = CyFxUsbUartStreamDmaCallback;
+        apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUarttoUsb, CY_U3P_DMA_TYPE_MANUAL_IN, &dmaCfg);
+        if (apiRetStatus != CY_U3P_SUCCESS)
         {
-            if (glIsApplnActive)
-                CyU3PUsbAckSetup ();
-            else
-                CyU3PUsbStall (0, CyTrue, CyFalse);
+            return apiRetStatus;
+        }
+
+        dmaCfg.size          = CY_FX_STREAM_TX_BUF_SIZE;
+        dmaCfg.count         = CY_FX_STREAM_TX_BUF_COUNT;
+        dmaCfg.prodSckId     = CY_U3P_CPU_SOCKET_PROD;
+        dmaCfg.consSckId     = CY_FX_EP_CONSUMER2_SOCKET;
+        dmaCfg.notification  = CY_U3P_DMA_CB_CONS_EVENT | CY_U3P_DMA_CB_CONS_SUSP |
+                               CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+        apiRetStatus = CyU3PDmaChannelCreate (&glChHandleStreamOut, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDmaChannelDestroy (&glChHandleUarttoUsb);
+            return apiRetStatus;
+        }
 
-            isHandled = CyTrue;
+        CyFxUsbUartStreamStart (&glRxStreamCfg);
+        apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleStreamOut, 0);
+        if (apiRetStatus == CY_U3P_SUCCESS)
+        {
+            apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUarttoUsb, 0);
         }
+
+        return apiRetStatus;
+    }
+
+    if (CY_FX_RX_TS_ACTIVE)
+    {
+        dmaCfg.size        += CY_FX_RX_TS_HDR_SIZE;
+        dmaCfg.prodHeader   = CY_FX_RX_TS_HDR_SIZE;
+        dmaCfg.notification |= CY_U3P_DMA_CB_PROD_EVENT;
+        CyFxUsbUartTsStart (DFLT_UART_RX_COUNT - UART->lpp_uart_rx_byte_count);
+    }
+    else
+    {
+        /* The AUTO_SIGNAL channel signals each buffer for the latency statistics only. */
+        dmaCfg.notification |= CY_U3P_DMA_CB_PROD_EVENT;
+    }
+    dmaCfg.cb           = CyFxUSBUARTDmaCallback;
+
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUarttoUsb,
+            (CY_FX_RX_TS_ACTIVE) ? CY_U3P_DMA_TYPE_MANUAL : glRxDmaType, &dmaCfg);
+    if (apiRetStatus == CY_U3P_SUCCESS)
+    {
+        apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUarttoUsb, 0);
+    }
+
+    return apiRetStatus;
+}
+
+/* Destroy the UART to USB DMA channel, or both stream mode channels, adding the byte count of the
+   channel that feeds EP 2 IN to the statistics block. */
+static void
+CyFxUartRxChannelDestroy (
+        void)
+{
+    if (CY_FX_STREAM_ACTIVE)
+    {
+        CyFxUsbUartStatsChannelDone (&glChHandleStreamOut, CY_FX_STATS_CH_UARTTOUSB);
+        CyU3PDmaChannelDestroy (&glChHandleUarttoUsb);
+        CyU3PDmaChannelDestroy (&glChHandleStreamOut);
+    }
+    else
+    {
+        CyFxUsbUartStatsChannelDone (&glChHandleUarttoUsb, CY_FX_STATS_CH_UARTTOUSB);
+        CyU3PDmaChannelDestroy (&glChHandleUarttoUsb);
+    }
+}
+
+/* Re-create the UART to USB DMA channel with a new buffer geometry or channel type. This is called
+   from the application thread after a SET_LINE_CODING request has changed the preferred geometry,
+   or the host has selected a different channel type or stream mode. Data that has already been received is sent
+   to the host before the channel is torn down: the wrap-up has to reach the channel, and in stream mode
+   be copied to the USB side and committed there, before the host can be waited for. The host is waited
+   for as long as it keeps reading, with CY_FX_UART_RX_RECONFIG_TIMEOUT allowed between reads and
+   CY_FX_UART_RX_RECONFIG_MAX_MS in total. Committed data that is still in the channel after that is
+   dropped, and counted in the statistics block and by a CY_FX_TRACE_EVT_RX_RECONFIG_LOST record; a
+   partial buffer that has not been committed yet cannot be counted. glAppLock is not held while waiting
+   for the host, so that the USB callbacks are not held up. If the data path has been stopped or
+   re-started in the meantime, the channel is left as it is, and a re-started data path is re-configured
+   on the next pass. */
+static void
+CyFxUartRxChannelReconfig (
+        void)
+{
+    CyU3PDmaChannel *chHandle;
+    CyU3PDmaState_t state;
+    uint32_t prodCnt = 0, consCnt = 0;
+    uint32_t startTime, lastTime, now, startCnt;
+    uint32_t prodStart = 0, consLast = 0;
+    uint16_t size, count;
+    CyBool_t wrapPending = CyFalse, flushed, timedOut = CyFalse;
+    CyU3PReturnStatus_t apiRetStatus;
+
+    CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+
+    /* The multiplexed mode uses a fixed geometry, and picks up the stream and timestamp settings when
+       it is left. */
+    CyFxUartRxGeometrySelect (CyU3PUsbGetSpeed (), &size, &count);
+    if ((!glIsApplnActive) || (CY_FX_MUX_ACTIVE) || (glBenchMode == CY_FX_BENCH_MODE_USB_LOOPBACK) || (glBenchMode == CY_FX_BENCH_MODE_PATTERN) ||
+            ((size == glRxBufSize) && (count == glRxBufCount) && (glRxDmaTypeReq == glRxDmaType) &&
+                (glRxStreamCfgReq.mode == glRxStreamCfg.mode) && (glRxStreamCfgReq.param == glRxStreamCfg.param) &&
+                (glRxStreamCfgReq.shortMax == glRxStreamCfg.shortMax) && (glRxStreamCfgReq.flags == glRxStreamCfg.flags) &&
+                (glRxStreamCfgReq.patternLen == glRxStreamCfg.patternLen) &&
+                (CyU3PMemCmp (glRxStreamCfgReq.pattern, glRxStreamCfg.pattern, CY_FX_STREAM_PATTERN_MAX) == 0) &&
+                (glRxTsReq == glRxTs)))
+    {
+        CyU3PMutexPut (&glAppLock);
+        return;
     }
 
-    /* Check for CDC Class Requests */
-    if (bType == CY_U3P_USB_CLASS_RQT)
+    /* Send out any partial buffer, and give the host some time to read all committed data. */
+    CyU3PTimerStop (&glRxIdleTimer);
+    if (CY_FX_STREAM_ACTIVE)
+    {
+        CyFxUsbUartStreamWrapUp (CyTrue);
+        chHandle = &glChHandleStreamOut;
+    }
+    else
     {
-        isHandled = CyTrue;
+        /* A partial buffer only shows up in the producer count once the socket has acted on the wrap-up. */
+        chHandle    = &glChHandleUarttoUsb;
+        wrapPending = (CyBool_t)((glRxDataPending) &&
+                (CyU3PDmaChannelGetStatus (chHandle, &state, &prodStart, &consCnt) == CY_U3P_SUCCESS));
+        CyU3PDmaChannelSetWrapUp (chHandle);
+    }
+    glRxDataPending = CyFalse;
 
-        /* Handle Debug Interface (Interface 2) Requests */
-        if (wIndex == 0x02)
+    startCnt  = glAppStartCnt;
+    startTime = CyU3PGetTime ();
+    lastTime  = startTime;
+    for (;;)
+    {
+        now = CyU3PGetTime ();
+        if (((now - lastTime) >= CY_FX_UART_RX_RECONFIG_TIMEOUT) || ((now - startTime) >= CY_FX_UART_RX_RECONFIG_MAX_MS))
         {
-            if (bRequest == SET_LINE_CODING)
-            {
-                /* Read and discard data */
-                status = CyU3PUsbGetEP0Data(0x07, config_data, &readCount);
-                if (status == CY_U3P_SUCCESS)
-                {
-                    CyU3PUsbAckSetup();
-                }
-            }
-            else if (bRequest == GET_LINE_CODING)
-            {
-                /* Send dummy 115200 8N1 */
-                config_data[0] = 0x00; config_data[1] = 0xC2; config_data[2] = 0x01; config_data[3] = 0x00;
-                config_data[4] = 0x00; config_data[5] = 0x00; config_data[6] = 0x08;
-                status = CyU3PUsbSendEP0Data(0x07, config_data);
-            }
-            else if (bRequest == SET_CONTROL_LINE_STATE)
+            timedOut = CyTrue;
+            break;
+        }
+
+        flushed = (CyBool_t)((!CY_FX_STREAM_ACTIVE) || (CyFxUsbUartStreamFlush ()));
+        if (CyU3PDmaChannelGetStatus (chHandle, &state, &prodCnt, &consCnt) != CY_U3P_SUCCESS)
+        {
+            break;
+        }
+
+        /* The host is still reading. */
+        if (consCnt != consLast)
+        {
+            consLast = consCnt;
+            lastTime = now;
+        }
+
+        if (flushed)
+        {
+            if (prodCnt != prodStart)
             {
-                CyU3PUsbAckSetup();
+                wrapPending = CyFalse;
             }
-            
-            if (status != CY_U3P_SUCCESS)
+            if ((!wrapPending) && (prodCnt == consCnt))
             {
-                CyFxAppErrorHandler(status);
+                break;
             }
-            return CyTrue;
         }
 
-        /* CDC Specific Requests for UART */
-        /* set_line_coding */
-        if (bRequest == SET_LINE_CODING)                                                      
+        CyU3PMutexPut (&glAppLock);
+        CyU3PThreadSleep (1);
+        CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+        if ((!glIsApplnActive) || (glAppStartCnt != startCnt))
         {
-            status = CyU3PUsbGetEP0Data(0x07, config_data, &readCount);
-            if (status != CY_U3P_SUCCESS)
-            {
-                CyFxAppErrorHandler(status);
-            }
-            if (readCount != 0x07)
+            if (glIsApplnActive)
             {
-                CyFxAppErrorHandler(CY_U3P_ERROR_BAD_SIZE);
+                CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_RX_RECONFIG, CYU3P_EVENT_OR);
             }
-            else
-            {
-                CyU3PMemSet ((uint8_t *)&uartConfig, 0, sizeof (uartConfig));
-                uartConfig.baudRate = (CyU3PUartBaudrate_t)(config_data[0] | (config_data[1]<<8)|
-                        (config_data[2]<<16)|(config_data[3]<<24));
-                if (config_data[4] == 0)
-                {
-                    uartConfig.stopBit = CY_U3P_UART_ONE_STOP_BIT;
-                }
-                else if (config_data[4] == 2)
-                {
-                    uartConfig.stopBit = CY_U3P_UART_TWO_STOP_BIT;
-                }
-                else
-                {
-                    /* Give invalid value. */
-                    uartConfig.stopBit = (CyU3PUartStopBit_t)0;
-                }
-                if (config_data[5] == 1)
-                {
-                    uartConfig.parity = CY_U3P_UART_ODD_PARITY;
-                }
-                else if (config_data[5] == 2)
-                {
-                    uartConfig.parity = CY_U3P_UART_EVEN_PARITY;
-                }
-                else
-                {
-                    /* 0 = no parity; any other value - invalid parity. */
-                    uartConfig.parity = CY_U3P_UART_NO_PARITY;
-                }
+            CyU3PMutexPut (&glAppLock);
+            return;
+        }
+    }
 
-                uartConfig.txEnable = CyTrue;
-                uartConfig.rxEnable = CyTrue;
-                uartConfig.flowCtrl = CyFalse;
-                uartConfig.isDma = CyTrue;
+    if ((timedOut) && (prodCnt != consCnt))
+    {
+        glUsbUartStats.rxReconfigTimeouts++;
+        glUsbUartStats.rxReconfigLostBytes += prodCnt - consCnt;
+        CY_FX_TRACE2 (CY_FX_TRACE_EVT_RX_RECONFIG_LOST, prodCnt - consCnt, now - startTime);
+    }
 
-#ifndef CB_ERROR_SOLUTION_SUGGESTED
-                /* Set the uart configuration */
-                apiRetStatus = CyU3PUartSetConfig (&uartConfig, NULL);
-                if (apiRetStatus == CY_U3P_SUCCESS)
-                {
-                    CyU3PMemCopy ((uint8_t *)&glUartConfig, (uint8_t *)&uartConfig,
-                            sizeof (CyU3PUartConfig_t));
-                }
+    CyFxUartRxChannelDestroy ();
+
+    glRxBufSize   = size;
+    glRxBufCount  = count;
+    glRxDmaType   = glRxDmaTypeReq;
+    glRxStreamCfg = glRxStreamCfgReq;
+    glRxTs        = glRxTsReq;
+    glRxReconfigCnt++;
+    CY_FX_TRACE3 (CY_FX_TRACE_EVT_RX_RECONFIG, size, count, glRxDmaType);
+    apiRetStatus = CyFxUartRxChannelCreate ();
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    CyFxUartRxReprime ();
+    glRxLastCount   = UART->lpp_uart_rx_byte_count;
+    glRxDataPending = CyFalse;
+    glRxIdleCnt     = 0;
+    CyU3PTimerStart (&glRxIdleTimer);
+
+    CyU3PMutexPut (&glAppLock);
+}
+
+/* Create the EP 2 data channels for the current benchmark mode. The channel that feeds EP 2 IN is
+   started right away, the channel from EP 2 OUT (glChHandleUsbtoUart) is started by the caller. In the
+   USB loopback mode, glChHandleUsbtoUart is the only channel, and connects EP 2 OUT to EP 2 IN. Where
+   the data from EP 2 OUT goes to the UART, the coalescing mode channels can be used instead of the AUTO
+   channel, or the multiplexed mode channels instead of all data channels. */
+static void
+CyFxUsbUartDataChannelsCreate (
+        CyU3PUSBSpeed_t usbSpeed)
+{
+    CyU3PDmaChannelConfig_t dmaCfg;
+    CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
+
+    glMux        = (CyBool_t)((glMuxReq) && (glBenchMode == CY_FX_BENCH_MODE_OFF));
+    glTxCoalesce = (CyBool_t)((glTxCoalesceReq) && (!glMux) &&
+            ((glBenchMode == CY_FX_BENCH_MODE_OFF) || (glBenchMode == CY_FX_BENCH_MODE_UART_LOOPBACK)));
+
+    if (glBenchMode == CY_FX_BENCH_MODE_PATTERN)
+    {
+        apiRetStatus = CyFxUsbUartBenchChannelsCreate (glTxBufSize, glTxBufCount, glBenchPattern, glBenchRate);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyFxAppErrorHandler(apiRetStatus);
+        }
+        return;
+    }
+
+    if (CY_FX_MUX_ACTIVE)
+    {
+        /* The chunks are not stream mode or timestamp aware, so these are left off while in use. */
+        glRxStreamCfg.mode = CY_FX_STREAM_MODE_OFF;
+        glRxTs             = CyFalse;
+        apiRetStatus = CyFxUsbUartMuxChannelsCreate (glTxBufSize);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyFxAppErrorHandler(apiRetStatus);
+        }
+        CyFxUartLoopbackUpdate ();
+        return;
+    }
+
+    if (glTxCoalesce)
+    {
+        /* Pack the data from EP 2 OUT into larger buffers for the UART. */
+        apiRetStatus = CyFxUsbUartCoalesceChannelsCreate (glTxBufSize);
+    }
+    else
+    {
+        /* Create a DMA_AUTO channel between usb producer socket and uart consumer socket */
+        CyU3PMemSet ((uint8_t *)&dmaCfg, 0, sizeof (dmaCfg));
+        dmaCfg.size = glTxBufSize;
+        dmaCfg.count = glTxBufCount;
+        dmaCfg.prodSckId = CY_FX_EP_PRODUCER1_SOCKET;
+        dmaCfg.consSckId = (glBenchMode == CY_FX_BENCH_MODE_USB_LOOPBACK) ? CY_FX_EP_CONSUMER2_SOCKET :
+            CY_FX_EP_CONSUMER1_SOCKET;
+        dmaCfg.dmaMode = CY_U3P_DMA_MODE_BYTE;
+        dmaCfg.notification = CY_U3P_DMA_CB_PROD_SUSP | CY_U3P_DMA_CB_CONS_SUSP |
+                              CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+        dmaCfg.cb = CyFxUSBUARTDmaCallback;
+        dmaCfg.prodHeader = 0;
+        dmaCfg.prodFooter = 0;
+        dmaCfg.consHeader = 0;
+        dmaCfg.prodAvailCount = 0;
+
+        apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUsbtoUart,
+                CY_U3P_DMA_TYPE_AUTO, &dmaCfg);
+    }
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {       
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    if (glBenchMode == CY_FX_BENCH_MODE_USB_LOOPBACK)
+    {
+        return;
+    }
+
+    /* Create the DMA_MANUAL channel between uart producer socket and usb consumer socket, using the
+       buffer geometry that suits the current baud rate and USB connection speed. */
+    glRxStreamCfg = glRxStreamCfgReq;
+    glRxTs        = glRxTsReq;
+    CyFxUartRxGeometrySelect (usbSpeed, &glRxBufSize, &glRxBufCount);
+    apiRetStatus = CyFxUartRxChannelCreate ();
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {       
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    CyFxUartLoopbackUpdate ();
+}
+
+/* Destroy the EP 2 data channels created by CyFxUsbUartDataChannelsCreate. */
+static void
+CyFxUsbUartDataChannelsDestroy (
+        void)
+{
+    switch (glBenchMode)
+    {
+        case CY_FX_BENCH_MODE_PATTERN:
+            CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
+            CyU3PDmaChannelDestroy (&glChHandleUarttoUsb);
+            break;
+
+        case CY_FX_BENCH_MODE_USB_LOOPBACK:
+            CyFxUsbUartStatsChannelDone (&glChHandleUsbtoUart, CY_FX_STATS_CH_USBTOUART);
+            CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
+            break;
+
+        default:
+            CyFxUsbUartStatsChannelDone (CyFxUsbUartTxChannel (), CY_FX_STATS_CH_USBTOUART);
+            CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
+            if ((glTxCoalesce) || (CY_FX_MUX_ACTIVE))
+            {
+                CyU3PDmaChannelDestroy (&glChHandleCoalesceOut);
+            }
+            if (CY_FX_MUX_ACTIVE)
+            {
+                CyFxUsbUartMuxStop ();
+                CyFxUsbUartStatsChannelDone (&glChHandleStreamOut, CY_FX_STATS_CH_UARTTOUSB);
+                CyU3PDmaChannelDestroy (&glChHandleUarttoUsb);
+                CyU3PDmaChannelDestroy (&glChHandleStreamOut);
+            }
+            else
+            {
+                CyFxUartRxChannelDestroy ();
+            }
+            break;
+    }
+}
+
+/* Switch the EP 2 data path to the benchmark mode or USB to UART path requested by the host. This is
+   called from the application thread. Data in flight on the data endpoints is dropped. */
+static void
+CyFxUsbUartBenchReconfig (
+        void)
+{
+    CyU3PReturnStatus_t apiRetStatus;
+
+    CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+
+    if (!glIsApplnActive)
+    {
+        CyU3PMutexPut (&glAppLock);
+        return;
+    }
+
+    CyU3PTimerStop (&glRxIdleTimer);
+    CyFxUsbUartDataChannelsDestroy ();
+    CyU3PUsbFlushEp (CY_FX_EP_PRODUCER);
+    CyU3PUsbFlushEp (CY_FX_EP_CONSUMER);
+
+    glBenchMode = glBenchModeReq;
+    CY_FX_TRACE3 (CY_FX_TRACE_EVT_BENCH_MODE, glBenchMode, glBenchPattern, glBenchRate);
+    CyFxUsbUartDataChannelsCreate (CyU3PUsbGetSpeed ());
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUsbtoUart, 0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    CyFxUartRxReprime ();
+    glRxLastCount   = UART->lpp_uart_rx_byte_count;
+    glRxDataPending = CyFalse;
+    glRxIdleCnt     = 0;
+    CyU3PTimerStart (&glRxIdleTimer);
+
+    CyU3PMutexPut (&glAppLock);
+}
+
+/* Create the data and debug DMA channels, with the buffer geometry that suits the given USB connection
+   speed. The channel feeding EP 2 IN is started right away, the other channels are started by the caller. */
+static void
+CyFxUSBUARTChannelsCreate (
+        CyU3PUSBSpeed_t usbSpeed)
+{
+    CyU3PDmaChannelConfig_t dmaCfg;
+    CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
+    uint16_t pktSize;
+
+    /* Packet size of the data and debug endpoints. Bursts are only supported on SuperSpeed
+       connections. The DMA buffers used for the USB to UART channel are sized to hold one
+       complete burst. */
+    pktSize = (usbSpeed == CY_U3P_SUPER_SPEED) ? 1024 : ((usbSpeed == CY_U3P_HIGH_SPEED) ? 512 : 64);
+    glTxBufSize  = pktSize * ((usbSpeed == CY_U3P_SUPER_SPEED) ? CY_FX_EP_BURST_LENGTH : 1);
+    glTxBufCount = (uint16_t)CY_U3P_MAX (2, CY_U3P_MIN (CY_FX_USBUART_DMA_BUF_COUNT,
+                CY_FX_USBTOUART_DMA_BUDGET / glTxBufSize));
+
+    CyFxUsbUartDataChannelsCreate (usbSpeed);
+
+    /* Create DMA Channel for Debug Console (CPU to USB) */
+    dmaCfg.size = pktSize;
+    dmaCfg.count = 4;
+    dmaCfg.prodSckId = CY_U3P_CPU_SOCKET_PROD;
+    dmaCfg.consSckId = CY_FX_EP_DEBUG_CONS_SOCKET;
+    dmaCfg.dmaMode = CY_U3P_DMA_MODE_BYTE;
+    dmaCfg.notification = 0;
+    dmaCfg.cb = NULL;
+    dmaCfg.prodHeader = 0;
+    dmaCfg.prodFooter = 0;
+    dmaCfg.consHeader = 0;
+    dmaCfg.prodAvailCount = 0;
+
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleDebug,
+            CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    /* Create DMA Channel for the second port (USB to CPU) */
+    dmaCfg.size = pktSize;
+    dmaCfg.count = CY_FX_PORT2_DMA_BUF_COUNT;
+    dmaCfg.prodSckId = CY_FX_EP_DEBUG_PROD_SOCKET;
+    dmaCfg.consSckId = CY_U3P_CPU_SOCKET_CONS;
+    dmaCfg.dmaMode = CY_U3P_DMA_MODE_BYTE;
+    dmaCfg.notification = CY_U3P_DMA_CB_PROD_EVENT | CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    dmaCfg.cb = CyFxUsbUartPort2DmaCallback;
+
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandlePort2,
+            CY_U3P_DMA_TYPE_MANUAL_IN, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    /* Create DMA Channel for the SERIAL_STATE notifications (CPU to USB) */
+    dmaCfg.size = CY_FX_NOTIFY_DMA_BUF_SIZE;
+    dmaCfg.count = CY_FX_NOTIFY_DMA_BUF_COUNT;
+    dmaCfg.prodSckId = CY_U3P_CPU_SOCKET_PROD;
+    dmaCfg.consSckId = CY_FX_EP_INTR_CONSUMER1_SOCKET;
+    dmaCfg.dmaMode = CY_U3P_DMA_MODE_BYTE;
+    dmaCfg.notification = 0;
+    dmaCfg.cb = NULL;
+
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleNotify,
+            CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+}
+
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+
+/* Start the channels after a (re-)connection. The USB to UART and debug channels have been reset when
+   the host went away, and only need to be armed again. The UART to USB channel has kept running, and
+   its buffers hold the data received while the host was away. It is only reset if it has stopped. */
+static void
+CyFxUSBUARTChannelsArm (
+        void)
+{
+    CyU3PDmaState_t state;
+    uint32_t prodCnt, consCnt;
+    CyU3PReturnStatus_t apiRetStatus;
+
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUsbtoUart, 0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleDebug, 0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandlePort2, 0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleNotify, 0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    apiRetStatus = CyU3PDmaChannelGetStatus (&glChHandleUarttoUsb, &state, &prodCnt, &consCnt);
+    if ((apiRetStatus != CY_U3P_SUCCESS) || (state != CY_U3P_DMA_ACTIVE))
+    {
+        CyFxUsbUartStatsChannelDone (&glChHandleUarttoUsb, CY_FX_STATS_CH_UARTTOUSB);
+        CyU3PDmaChannelReset (&glChHandleUarttoUsb);
+        apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUarttoUsb, 0);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyFxAppErrorHandler (apiRetStatus);
+        }
+    }
+}
+
+#endif
+
+/* This function starts the USBUART application */
+void
+CyFxUSBUARTAppStart(
+        void )
+{ 
+    uint16_t size = 0;
+    CyU3PEpConfig_t epCfg;
+    CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
+    CyU3PUSBSpeed_t usbSpeed = CyU3PUsbGetSpeed();
+
+    /* Based on the Bus speed configure the endpoint packet size */
+    switch (usbSpeed)
+    {
+        case CY_U3P_FULL_SPEED:
+            size = 64;
+            break;
+
+        case CY_U3P_HIGH_SPEED:
+            size = 512;
+            break;
+
+        case  CY_U3P_SUPER_SPEED:
+            /* Low power mode stays off until the link has been idle for a while, so that the first
+               transfers are not delayed. */
+            size = 1024;
+            break;
+
+        default:
+            CyFxAppErrorHandler (CY_U3P_ERROR_FAILURE);
+            break;
+    }
+
+    /* Bursts are only supported on SuperSpeed connections. */
+    glEpBurstLen = (usbSpeed == CY_U3P_SUPER_SPEED) ? CY_FX_EP_BURST_LENGTH : 1;
+
+    CyU3PMemSet ((uint8_t *)&epCfg, 0, sizeof (epCfg));
+    epCfg.enable = CyTrue;
+    epCfg.epType = CY_U3P_USB_EP_BULK;
+    epCfg.burstLen = glEpBurstLen;
+    epCfg.streams = 0;
+    epCfg.pcktSize = size;
+
+    /* Producer endpoint configuration */
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_PRODUCER , &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {    
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    /* Consumer endpoint configuration */
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_CONSUMER, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {       
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    /* Interrupt endpoint configuration */
+    epCfg.epType = CY_U3P_USB_EP_INTR;
+    epCfg.burstLen = 1;
+    epCfg.pcktSize = 64;
+    epCfg.isoPkts = 1;
+
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_INTERRUPT, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    /* Debug Endpoint Configuration */
+    /* Debug Interrupt Endpoint */
+    epCfg.epType = CY_U3P_USB_EP_INTR;
+    epCfg.pcktSize = (usbSpeed == CY_U3P_SUPER_SPEED) ? 1024 : 64;
+    epCfg.isoPkts = 1;
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_INTERRUPT, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    /* Debug Consumer Endpoint (Bulk IN) */
+    epCfg.epType = CY_U3P_USB_EP_BULK;
+    epCfg.pcktSize = size;
+    epCfg.streams = 0;
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_CONSUMER, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    /* Second Port Producer Endpoint (Bulk OUT) */
+    epCfg.epType = CY_U3P_USB_EP_BULK;
+    epCfg.pcktSize = size;
+    epCfg.streams = 0;
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_PRODUCER, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+    /* The channels were created at init time. Re-arm the sockets that were reset when the
+       host went away, and resume the UART to USB channel that has been holding the data
+       received in the meantime. */
+    CyFxUSBUARTChannelsArm ();
+#else
+    CyFxUSBUARTChannelsCreate (usbSpeed);
+
+    /* Set DMA Channel transfer size */
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUsbtoUart,0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {       
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    /* Set Debug DMA Channel transfer size */
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleDebug, 0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    /* Set Second Port DMA Channel transfer size */
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandlePort2, 0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+
+    /* Set Notification DMA Channel transfer size */
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleNotify, 0);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+#endif
+
+    /* Initialize the UART_RX_BYTE_COUNT register to a large value and start monitoring the
+       receiver for idle periods. */
+    CyFxUartRxReprime ();
+    glRxLastCount   = UART->lpp_uart_rx_byte_count;
+    glRxDataPending = CyFalse;
+    glRxIdleCnt     = 0;
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+    /* Any partial buffer left from the time the host was away is sent once the line is idle. */
+    glRxDataPending = CyTrue;
+#endif
+    CyU3PTimerStart (&glRxIdleTimer);
+
+    /* Report the carrier bits to the host with the first notification. */
+    CyFxUsbUartNotifySetCarrier (CyTrue);
+    CyFxUsbUartLpmStart ((CyBool_t)(usbSpeed == CY_U3P_SUPER_SPEED));
+
+    /* Update the status flag. */
+    glIsApplnActive = CyTrue;
+    glAppStartCnt++;
+    CyFxUsbUartStartupMark (CY_FX_STARTUP_APP_START);
+} 
+
+void
+CyFxUSBUARTAppStop (
+        void)
+{
+    CyU3PEpConfig_t epCfg;
+    CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
+    uint32_t flags;
+
+    /* Update the flag. */
+    glIsApplnActive = CyFalse;
+
+    /* Stop the RX idle monitor and drop any pending flush request. */
+    CyU3PTimerStop (&glRxIdleTimer);
+    CyU3PEventGet (&glUartAppEvent, CY_FX_USBUART_EVT_RX_IDLE | CY_FX_USBUART_EVT_RX_PEEK | CY_FX_USBUART_EVT_NOTIFY |
+            CY_FX_USBUART_EVT_STREAM | CY_FX_USBUART_EVT_MUX_DATA, CYU3P_EVENT_OR_CLEAR, &flags, CYU3P_NO_WAIT);
+    CyFxUsbUartNotifySetCarrier (CyFalse);
+    CyFxUsbUartLpmStop ();
+
+    /* Flush the endpoint memory. With persistent channels, EP 2 IN is not flushed: the UART to USB channel
+       keeps producing into it, and a flush would drop whatever part of its data has already reached the
+       endpoint. That data is sent once the host is back, ahead of the data held in the channel. */
+    CyU3PUsbFlushEp(CY_FX_EP_PRODUCER);
+#ifndef CY_FX_USBUART_PERSISTENT_CHANNELS
+    CyU3PUsbFlushEp(CY_FX_EP_CONSUMER);
+#endif
+    CyU3PUsbFlushEp(CY_FX_EP_INTERRUPT);
+
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+    /* Reset the USB to UART channel, dropping any data that the host had sent. The UART to USB
+       channel keeps running, and holds on to the data received until the host is back. */
+    CyFxUsbUartStatsChannelDone (&glChHandleUsbtoUart, CY_FX_STATS_CH_USBTOUART);
+    CyU3PDmaChannelReset (&glChHandleUsbtoUart);
+#else
+    /* Destroy the channel */
+    CyFxUsbUartDataChannelsDestroy ();
+#endif
+
+    /* Disable endpoints. */
+    CyU3PMemSet ((uint8_t *)&epCfg, 0, sizeof (epCfg));
+    epCfg.enable = CyFalse;
+
+    /* Producer endpoint configuration. */
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_PRODUCER, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    /* Consumer endpoint configuration. */
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_CONSUMER, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    /* Interrupt endpoint configuration. */
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_INTERRUPT, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    /* Disable Debug Endpoints */
+    /* Debug Interrupt */
+    CyU3PUsbFlushEp(CY_FX_EP_DEBUG_INTERRUPT);
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_INTERRUPT, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+    /* Debug Consumer */
+    CyU3PUsbFlushEp(CY_FX_EP_DEBUG_CONSUMER);
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_CONSUMER, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+    /* Second Port Producer */
+    CyU3PUsbFlushEp(CY_FX_EP_DEBUG_PRODUCER);
+    apiRetStatus = CyU3PSetEpConfig(CY_FX_EP_DEBUG_PRODUCER, &epCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyFxAppErrorHandler (apiRetStatus);
+    }
+
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+    /* Reset Debug Channel. Messages that have not been sent yet are kept in the debug ring buffer. */
+    CyU3PDmaChannelReset (&glChHandleDebug);
+    CyU3PDmaChannelReset (&glChHandlePort2);
+    CyU3PDmaChannelReset (&glChHandleNotify);
 #else
-                /* Call CyU3PUartSetConfig to change configuration only if any of the parameters have changed. */
-                if (
-                        (uartConfig.baudRate != glUartConfig.baudRate) ||
-                        (uartConfig.stopBit != glUartConfig.stopBit) ||
-                        (uartConfig.parity != glUartConfig.parity)
-                   )
+    /* Destroy Debug, Second Port and Notification Channels */
+    CyU3PDmaChannelDestroy (&glChHandleDebug);
+    CyU3PDmaChannelDestroy (&glChHandlePort2);
+    CyU3PDmaChannelDestroy (&glChHandleNotify);
+#endif
+}
+
+/* Re-arm the channel(s) of the given CY_FX_ERR_* class after a DMA error. The channel is reset and
+   started again, which drops any data in its buffers, but keeps its configuration. The other channels
+   are not touched. This is called by the error recovery engine in the application thread. */
+CyU3PReturnStatus_t
+CyFxUsbUartChannelRearm (
+        uint8_t errClass)
+{
+    CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
+
+    CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+
+    if (!glIsApplnActive)
+    {
+        CyU3PMutexPut (&glAppLock);
+        return CY_U3P_SUCCESS;
+    }
+
+    /* The rings of the multiplexed mode span all of its channels, which are re-created instead. */
+    if ((CY_FX_MUX_ACTIVE) && ((errClass == CY_FX_ERR_USBTOUART) || (errClass == CY_FX_ERR_UARTTOUSB)))
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_BENCH, CYU3P_EVENT_OR);
+        CyU3PMutexPut (&glAppLock);
+        return CY_U3P_SUCCESS;
+    }
+
+    switch (errClass)
+    {
+        case CY_FX_ERR_USBTOUART:
+            /* In the pattern mode, the checker counts the received data itself. */
+            if (glBenchMode != CY_FX_BENCH_MODE_PATTERN)
+            {
+                CyFxUsbUartStatsChannelDone (CyFxUsbUartTxChannel (), CY_FX_STATS_CH_USBTOUART);
+            }
+            CyU3PDmaChannelReset (&glChHandleUsbtoUart);
+            CyU3PUsbFlushEp (CY_FX_EP_PRODUCER);
+            if (glTxCoalesce)
+            {
+                CyU3PDmaChannelReset (&glChHandleCoalesceOut);
+                CyFxUsbUartCoalesceStart ();
+                apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleCoalesceOut, 0);
+            }
+            if (apiRetStatus == CY_U3P_SUCCESS)
+            {
+                apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUsbtoUart, 0);
+            }
+            break;
+
+        case CY_FX_ERR_UARTTOUSB:
+            if (glBenchMode == CY_FX_BENCH_MODE_PATTERN)
+            {
+                /* The pattern generator only refills buffers it has been handed back, so its channels
+                   are re-created instead. */
+                CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_BENCH, CYU3P_EVENT_OR);
+                break;
+            }
+
+            CyU3PTimerStop (&glRxIdleTimer);
+            if (CY_FX_STREAM_ACTIVE)
+            {
+                CyFxUsbUartStatsChannelDone (&glChHandleStreamOut, CY_FX_STATS_CH_UARTTOUSB);
+                CyU3PDmaChannelReset (&glChHandleUarttoUsb);
+                CyU3PDmaChannelReset (&glChHandleStreamOut);
+                CyU3PUsbFlushEp (CY_FX_EP_CONSUMER);
+                CyFxUsbUartStreamStart (&glRxStreamCfg);
+                apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleStreamOut, 0);
+            }
+            else
+            {
+                CyFxUsbUartStatsChannelDone (&glChHandleUarttoUsb, CY_FX_STATS_CH_UARTTOUSB);
+                CyU3PDmaChannelReset (&glChHandleUarttoUsb);
+                CyU3PUsbFlushEp (CY_FX_EP_CONSUMER);
+                if (CY_FX_RX_TS_ACTIVE)
                 {
-                    /* Set the uart configuration */
-                    apiRetStatus = CyU3PUartSetConfig (&uartConfig, NULL);
-                    if (apiRetStatus == CY_U3P_SUCCESS)
-                    {
-                        CyU3PMemCopy ((uint8_t *)&glUartConfig, (uint8_t *)&uartConfig,
-                                sizeof (CyU3PUartConfig_t));
-                    }
+                    CyFxUsbUartTsStart (DFLT_UART_RX_COUNT - UART->lpp_uart_rx_byte_count);
                 }
+            }
+            if (apiRetStatus == CY_U3P_SUCCESS)
+            {
+                apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUarttoUsb, 0);
+            }
+
+            CyFxUartRxReprime ();
+            glRxLastCount   = UART->lpp_uart_rx_byte_count;
+            glRxDataPending = CyFalse;
+            glRxIdleCnt     = 0;
+            CyU3PTimerStart (&glRxIdleTimer);
+            break;
+
+        case CY_FX_ERR_PORT2:
+            CyU3PDmaChannelReset (&glChHandlePort2);
+            CyU3PUsbFlushEp (CY_FX_EP_DEBUG_PRODUCER);
+            apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandlePort2, 0);
+            break;
+
+        default:
+            break;
+    }
+
+    CyU3PMutexPut (&glAppLock);
+    return apiRetStatus;
+}
+
+/* Restart the application, as a SET_CONFIGURATION request would. This is called by the error recovery
+   engine in the application thread. */
+void
+CyFxUsbUartAppRestart (
+        void)
+{
+    CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+    if (glIsApplnActive)
+    {
+        CyFxUSBUARTAppStop ();
+        CyFxUSBUARTAppStart ();
+    }
+    CyU3PMutexPut (&glAppLock);
+}
+
+/* This is the callback function to handle the USB events. */
+void
+CyFxUSBUARTAppUSBEventCB (
+        CyU3PUsbEventType_t evtype, /* Event type */
+        uint16_t            evdata  /* Event data */
+        )
+{
+    CY_FX_TRACE2 (CY_FX_TRACE_EVT_USB_EVENT, evtype, evdata);
 
-                /* Initialize the UART_RX_BYTE_COUNT register to a large value. */
-                CyU3PUartRxSetBlockXfer (DFLT_UART_RX_COUNT);
-#endif
-            }
-        }
-        /* get_line_coding */
-        else if (bRequest == GET_LINE_CODING )                                                   
-        {
-            /* get current uart config */
-            config_data[0] = glUartConfig.baudRate&(0x000000FF);
-            config_data[1] = ((glUartConfig.baudRate&(0x0000FF00))>> 8);
-            config_data[2] = ((glUartConfig.baudRate&(0x00FF0000))>>16);
-            config_data[3] = ((glUartConfig.baudRate&(0xFF000000))>>24);
-            if (glUartConfig.stopBit == CY_U3P_UART_ONE_STOP_BIT)
-            {
-                config_data[4] = 0;
-            }
-            else /* CY_U3P_UART_TWO_STOP_BIT */
+    switch (evtype)
+    {
+        case CY_U3P_USB_EVENT_SETCONF:
+            CyFxUsbUartStartupMark (CY_FX_STARTUP_SETCONF);
+            CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+            if (!glAppInitDone)
             {
-                config_data[4] = 2;
+                /* Started at the end of the initialization. */
+                glAppStartPending = CyTrue;
+                CyU3PMutexPut (&glAppLock);
+                break;
             }
 
-            if (glUartConfig.parity == CY_U3P_UART_EVEN_PARITY)
-            {
-                config_data[5] = 2;
-            }
-            else if (glUartConfig.parity == CY_U3P_UART_ODD_PARITY)
+            /* Stop the application before re-starting. */
+            if (glIsApplnActive)
             {
-                config_data[5] = 1;
+                CyFxUSBUARTAppStop ();
             }
-            else
+            /* Start the loop back function. */
+            CyFxUSBUARTAppStart ();
+            CyU3PMutexPut (&glAppLock);
+            break;
+
+        case CY_U3P_USB_EVENT_RESET:
+        case CY_U3P_USB_EVENT_CONNECT:
+        case CY_U3P_USB_EVENT_DISCONNECT:
+            if (evtype != CY_U3P_USB_EVENT_DISCONNECT)
             {
-                config_data[5] = 0;
+                CyFxUsbUartStartupMark (CY_FX_STARTUP_USB_RESET);
             }
-            config_data[6] =  0x08;
-            status = CyU3PUsbSendEP0Data( 0x07, config_data);
-            if (status != CY_U3P_SUCCESS)
+            CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+            glAppStartPending = CyFalse;
+            /* Stop the loop back function. */
+            if (glIsApplnActive)
             {
-                CyFxAppErrorHandler(status);
+                CyU3PUsbLPMEnable ();
+                CyFxUSBUARTAppStop ();
             }
-        }
-        /* SET_CONTROL_LINE_STATE */
-        else if (bRequest == SET_CONTROL_LINE_STATE)                                                   
+            CyU3PMutexPut (&glAppLock);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/* Handlers of the control requests in glUsbUartRqtTable. Each one is called with the wValue, wIndex and
+   wLength fields of the request, and takes care of the data or status stage. A handler that does not
+   return CY_U3P_SUCCESS has the request stalled by the USB driver; one that refuses the request in a
+   given state stalls EP0 itself and reports success. */
+typedef CyU3PReturnStatus_t (*CyFxUsbUartRqtHandler_t) (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength);
+
+typedef struct CyFxUsbUartRqt_t
+{
+    uint8_t  type;              /* CY_U3P_USB_*_RQT. */
+    uint8_t  target;            /* CY_U3P_USB_TARGET_*, or CY_FX_RQT_ANY_TARGET. */
+    uint16_t intf;              /* wIndex to be matched, or CY_FX_RQT_ANY_INTF. */
+    uint8_t  request;           /* bRequest. */
+    CyFxUsbUartRqtHandler_t handler;
+} CyFxUsbUartRqt_t;
+
+#define CY_FX_RQT_ANY_TARGET    (0xFF)
+#define CY_FX_RQT_ANY_INTF      (0xFFFF)
+
+/* Set the requested value of a setting that re-creates the data channels, and wake up the application
+   thread to apply it. */
+#define CY_FX_RQT_APPLY(evt, cur, req)                                  \
+    do {                                                                \
+        if (glIsApplnActive)                                            \
+        {                                                               \
+            CyU3PEventSet (&glUartAppEvent, (evt), CYU3P_EVENT_OR);     \
+        }                                                               \
+        else                                                            \
+        {                                                               \
+            (cur) = (req);                                              \
+        }                                                               \
+    } while (0)
+
+/* SET_FEATURE(FUNCTION_SUSPEND) and CLEAR_FEATURE(FUNCTION_SUSPEND): Allowed to pass if the device is in
+   configured state and failed otherwise. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtFunctionSuspend (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if (wValue != 0)
+    {
+        return CY_U3P_ERROR_FAILURE;
+    }
+
+    if (glIsApplnActive)
+        CyU3PUsbAckSetup ();
+    else
+        CyU3PUsbStall (0, CyTrue, CyFalse);
+
+    return CY_U3P_SUCCESS;
+}
+
+/* SET_LINE_CODING on either port. A failed data phase, a short line coding structure or an unsupported
+   framing leaves the settings as they are, and the request is stalled. A valid line coding for the UART port is passed on to the
+   application thread, which quiesces the data path and re-programs the UART if the settings differ. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetLineCoding (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    const CyFxUsbUartLineCoding_t *lineCoding_p = (const CyFxUsbUartLineCoding_t *)glEp0Buffer;
+    uint16_t readCount = 0;
+    uint32_t intMask;
+    CyU3PReturnStatus_t status;
+
+    status = CyU3PUsbGetEP0Data (sizeof (CyFxUsbUartLineCoding_t), glEp0Buffer, &readCount);
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyFxUsbUartRecoverReport (CY_FX_ERR_EP0, status);
+        return status;
+    }
+
+    if (readCount != sizeof (CyFxUsbUartLineCoding_t))
+    {
+        CyFxUsbUartRecoverReport (CY_FX_ERR_EP0, CY_U3P_ERROR_BAD_SIZE);
+        return CY_U3P_ERROR_BAD_SIZE;
+    }
+
+    /* The second port keeps its own line coding. */
+    if (wIndex == CY_FX_INTF_DEBUG_COMM)
+    {
+        *CyFxUsbUartPort2LineCoding () = *lineCoding_p;
+        return CY_U3P_SUCCESS;
+    }
+
+    /* The FX3 UART only supports 1 or 2 stop bits, and no, odd or even parity. The data stage has been
+       completed, so the stall fails the status stage. */
+    if ((lineCoding_p->dwDTERate == 0) || ((lineCoding_p->bCharFormat != 0) && (lineCoding_p->bCharFormat != 2)) ||
+            (lineCoding_p->bParityType > 2))
+    {
+        CyFxUsbUartRecoverReport (CY_FX_ERR_EP0, CY_U3P_ERROR_BAD_ARGUMENT);
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    /* The flow control setting is kept as last requested. */
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glUartConfigReq.baudRate = (CyU3PUartBaudrate_t)lineCoding_p->dwDTERate;
+    glUartConfigReq.stopBit  = (lineCoding_p->bCharFormat == 2) ? CY_U3P_UART_TWO_STOP_BIT : CY_U3P_UART_ONE_STOP_BIT;
+    glUartConfigReq.parity   = (lineCoding_p->bParityType == 2) ? CY_U3P_UART_EVEN_PARITY :
+        ((lineCoding_p->bParityType == 1) ? CY_U3P_UART_ODD_PARITY : CY_U3P_UART_NO_PARITY);
+    CyU3PVicEnableInterrupts (intMask);
+    CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_LINE_CODING, CYU3P_EVENT_OR);
+
+    return CY_U3P_SUCCESS;
+}
+
+/* GET_LINE_CODING on either port. The UART port reports the line coding last requested, even if the
+   application thread has not applied it yet. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetLineCoding (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    CyU3PReturnStatus_t status;
+
+    if (wIndex != CY_FX_INTF_DEBUG_COMM)
+    {
+        CyFxUartLineCodingUpdate ();
+    }
+    status = CyU3PUsbSendEP0Data (sizeof (CyFxUsbUartLineCoding_t), (uint8_t *)((wIndex == CY_FX_INTF_DEBUG_COMM) ?
+                CyFxUsbUartPort2LineCoding () : &glUartLineCoding));
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyFxUsbUartRecoverReport (CY_FX_ERR_EP0, status);
+    }
+
+    return status;
+}
+
+/* SET_CONTROL_LINE_STATE on the UART port. wValue bit 1 is the RTS state requested by the host. This is
+   only applied while hardware flow control is disabled; otherwise the UART block drives RTS itself. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetControlLineState (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if (!glIsApplnActive)
+    {
+        CyU3PUsbStall (0, CyTrue, CyFalse);
+        return CY_U3P_SUCCESS;
+    }
+
+    if (!glUartConfig.flowCtrl)
+    {
+        if ((wValue & 0x02) != 0)
         {
-            if (glIsApplnActive)
-            {    
-                CyU3PUsbAckSetup ();
-            }   
-            else {
-                CyU3PUsbStall (0, CyTrue, CyFalse);
-            }
+            UART->lpp_uart_config |= CY_U3P_LPP_UART_RTS;
         }
         else
         {
-            status = CY_U3P_ERROR_FAILURE;
+            UART->lpp_uart_config &= ~CY_U3P_LPP_UART_RTS;
+        }
+    }
+
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+/* SET_CONTROL_LINE_STATE on the second port, which has no control lines. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtAck (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetRxIdleChars (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if (wValue == 0)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    glRxIdleChars = wValue;
+    CyFxUartRxIdleUpdate ();
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetRxIdleChars (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    glEp0Buffer[0] = CY_U3P_GET_LSB (glRxIdleChars);
+    glEp0Buffer[1] = CY_U3P_GET_MSB (glRxIdleChars);
+    return CyU3PUsbSendEP0Data (2, glEp0Buffer);
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetRxGeometry (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    CyU3PDmaState_t dmaState;
+    uint32_t prodCnt = 0, consCnt;
+
+    glEp0Buffer[0]  = CY_U3P_GET_LSB (glRxBufSize);
+    glEp0Buffer[1]  = CY_U3P_GET_MSB (glRxBufSize);
+    glEp0Buffer[2]  = CY_U3P_GET_LSB (glRxBufCount);
+    glEp0Buffer[3]  = CY_U3P_GET_MSB (glRxBufCount);
+    glEp0Buffer[4]  = CY_U3P_DWORD_GET_BYTE0 (glUartConfig.baudRate);
+    glEp0Buffer[5]  = CY_U3P_DWORD_GET_BYTE1 (glUartConfig.baudRate);
+    glEp0Buffer[6]  = CY_U3P_DWORD_GET_BYTE2 (glUartConfig.baudRate);
+    glEp0Buffer[7]  = CY_U3P_DWORD_GET_BYTE3 (glUartConfig.baudRate);
+    glEp0Buffer[8]  = (uint8_t)CyU3PUsbGetSpeed ();
+    glEp0Buffer[9]  = (glRxDmaType == CY_U3P_DMA_TYPE_AUTO_SIGNAL) ? 1 : 0;
+    glEp0Buffer[10] = CY_U3P_GET_LSB (glRxReconfigCnt);
+    glEp0Buffer[11] = CY_U3P_GET_MSB (glRxReconfigCnt);
+
+    /* Number of bytes forwarded by the producer socket of the current channel. */
+    if (glIsApplnActive)
+    {
+        CyU3PDmaChannelGetStatus (&glChHandleUarttoUsb, &dmaState, &prodCnt, &consCnt);
+    }
+    glEp0Buffer[12] = CY_U3P_DWORD_GET_BYTE0 (prodCnt);
+    glEp0Buffer[13] = CY_U3P_DWORD_GET_BYTE1 (prodCnt);
+    glEp0Buffer[14] = CY_U3P_DWORD_GET_BYTE2 (prodCnt);
+    glEp0Buffer[15] = CY_U3P_DWORD_GET_BYTE3 (prodCnt);
+    return CyU3PUsbSendEP0Data (16, glEp0Buffer);
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetTxGeometry (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    glEp0Buffer[0] = CY_U3P_GET_LSB (glTxBufSize / glEpBurstLen);
+    glEp0Buffer[1] = CY_U3P_GET_MSB (glTxBufSize / glEpBurstLen);
+    glEp0Buffer[2] = glEpBurstLen;
+    glEp0Buffer[3] = CY_FX_EP_BURST_LENGTH;
+    glEp0Buffer[4] = CY_U3P_GET_LSB (glTxBufSize);
+    glEp0Buffer[5] = CY_U3P_GET_MSB (glTxBufSize);
+    glEp0Buffer[6] = CY_U3P_GET_LSB (glTxBufCount);
+    glEp0Buffer[7] = CY_U3P_GET_MSB (glTxBufCount);
+    glEp0Buffer[8] = ((glIsApplnActive) && (glTxCoalesce)) ? 1 : 0;
+    glEp0Buffer[9] = (glTxCoalesceReq) ? 1 : 0;
+    return CyU3PUsbSendEP0Data (10, glEp0Buffer);
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetRxDmaMode (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if (wValue > 1)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    glRxDmaTypeReq = (wValue == 1) ? CY_U3P_DMA_TYPE_AUTO_SIGNAL : CY_U3P_DMA_TYPE_MANUAL;
+    CY_FX_RQT_APPLY (CY_FX_USBUART_EVT_RX_RECONFIG, glRxDmaType, glRxDmaTypeReq);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetFlowCtrl (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    uint32_t intMask;
+
+    if (wValue > 1)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    /* Applied by the application thread together with the line coding, so that neither undoes the
+       other. */
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glUartConfigReq.flowCtrl = (wValue == 1) ? CyTrue : CyFalse;
+    CyU3PVicEnableInterrupts (intMask);
+    CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_LINE_CODING, CYU3P_EVENT_OR);
+
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetFlowCtrl (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    /* The stall time is reported in ms. */
+    uint32_t stallMs = (uint32_t)(((uint64_t)glFlowStallTicks * CY_FX_UART_RX_IDLE_TICK_US) / 1000);
+
+    glEp0Buffer[0]  = (glUartConfigReq.flowCtrl) ? 1 : 0;
+    glEp0Buffer[1]  = ((UART->lpp_uart_status & CY_U3P_LPP_UART_CTS_STAT) != 0) ? 1 : 0;
+    glEp0Buffer[2]  = ((UART->lpp_uart_config & CY_U3P_LPP_UART_RTS) != 0) ? 1 : 0;
+    glEp0Buffer[3]  = 0;
+    glEp0Buffer[4]  = CY_U3P_DWORD_GET_BYTE0 (stallMs);
+    glEp0Buffer[5]  = CY_U3P_DWORD_GET_BYTE1 (stallMs);
+    glEp0Buffer[6]  = CY_U3P_DWORD_GET_BYTE2 (stallMs);
+    glEp0Buffer[7]  = CY_U3P_DWORD_GET_BYTE3 (stallMs);
+    glEp0Buffer[8]  = CY_U3P_DWORD_GET_BYTE0 (glFlowStallCnt);
+    glEp0Buffer[9]  = CY_U3P_DWORD_GET_BYTE1 (glFlowStallCnt);
+    glEp0Buffer[10] = CY_U3P_DWORD_GET_BYTE2 (glFlowStallCnt);
+    glEp0Buffer[11] = CY_U3P_DWORD_GET_BYTE3 (glFlowStallCnt);
+    return CyU3PUsbSendEP0Data (12, glEp0Buffer);
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetDebugStats (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    uint32_t pending, dropped;
+
+    CyFxUsbUartDebugGetStats (&pending, &dropped);
+    glEp0Buffer[0] = CY_U3P_DWORD_GET_BYTE0 (pending);
+    glEp0Buffer[1] = CY_U3P_DWORD_GET_BYTE1 (pending);
+    glEp0Buffer[2] = CY_U3P_DWORD_GET_BYTE2 (pending);
+    glEp0Buffer[3] = CY_U3P_DWORD_GET_BYTE3 (pending);
+    glEp0Buffer[4] = CY_U3P_DWORD_GET_BYTE0 (dropped);
+    glEp0Buffer[5] = CY_U3P_DWORD_GET_BYTE1 (dropped);
+    glEp0Buffer[6] = CY_U3P_DWORD_GET_BYTE2 (dropped);
+    glEp0Buffer[7] = CY_U3P_DWORD_GET_BYTE3 (dropped);
+    return CyU3PUsbSendEP0Data (8, glEp0Buffer);
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetDebugMode (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if (wValue > CY_FX_DEBUG_MODE_TRACE)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    /* The second port stops echoing in trace mode. */
+    if (wValue == CY_FX_DEBUG_MODE_TRACE)
+    {
+        CyFxUsbUartPort2SetSink (CY_FX_PORT2_SINK_DISCARD);
+    }
+
+    CyFxUsbUartDebugSetMode ((uint8_t)wValue);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetStats (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    uint32_t liveBytes[CY_FX_STATS_CH_COUNT];
+    CyU3PReturnStatus_t status;
+
+    if (wValue > 1)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    CyFxUsbUartStatsLiveBytes (liveBytes);
+    glUsbUartStats.benchMode = glBenchMode;
+    status = CyU3PUsbSendEP0Data (CyFxUsbUartStatsPack (glEp0Buffer, liveBytes), glEp0Buffer);
+    if ((status == CY_U3P_SUCCESS) && (wValue == 1))
+    {
+        CyFxUsbUartStatsClear (liveBytes);
+    }
+    return status;
+}
+
+#ifdef CY_FX_PROFILE_ENABLE
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetProfile (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if (wValue > 1)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    return CyU3PUsbSendEP0Data (CyFxUsbUartProfPack (glEp0Buffer, (wValue == 1) ? CyTrue : CyFalse), glEp0Buffer);
+}
+#endif
+
+#ifndef CY_FX_USBUART_PERSISTENT_CHANNELS
+/* Short frames have to fit into one USB side buffer. Stream mode is not available with persistent
+   channels, as the UART to USB channel is never re-created there. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetStreamMode (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if ((CY_U3P_GET_LSB (wValue) > CY_FX_STREAM_MODE_PATTERN) || (wIndex > CY_FX_STREAM_TX_BUF_SIZE) ||
+            ((CY_U3P_GET_LSB (wValue) != CY_FX_STREAM_MODE_OFF) && (CY_FX_STREAM_ENABLE == 0)) ||
+            ((CY_U3P_GET_LSB (wValue) == CY_FX_STREAM_MODE_PATTERN) && (glRxStreamCfgReq.patternLen == 0)))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    glRxStreamCfgReq.mode     = CY_U3P_GET_LSB (wValue);
+    glRxStreamCfgReq.param    = CY_U3P_GET_MSB (wValue);
+    glRxStreamCfgReq.shortMax = (wIndex != 0) ? wIndex : CY_FX_STREAM_SHORT_FRAME_DEFAULT;
+    CY_FX_RQT_APPLY (CY_FX_USBUART_EVT_RX_RECONFIG, glRxStreamCfg, glRxStreamCfgReq);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+/* The pattern is set before the pattern mode is selected, and can only be cleared while another mode
+   is requested. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetStreamMatch (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    uint16_t readCount = 0;
+    CyU3PReturnStatus_t status;
+
+    if ((wValue > CY_FX_STREAM_FLAG_TICK) || (wLength > CY_FX_STREAM_PATTERN_MAX) ||
+            ((wLength == 0) && (glRxStreamCfgReq.mode == CY_FX_STREAM_MODE_PATTERN)))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    if (wLength != 0)
+    {
+        status = CyU3PUsbGetEP0Data (wLength, glEp0Buffer, &readCount);
+        if (status != CY_U3P_SUCCESS)
+        {
+            return status;
+        }
+        if (readCount != wLength)
+        {
+            return CY_U3P_ERROR_BAD_SIZE;
         }
+        CyU3PMemCopy (glRxStreamCfgReq.pattern, glEp0Buffer, wLength);
+    }
+    else
+    {
+        CyU3PUsbAckSetup ();
+    }
+
+    glRxStreamCfgReq.flags      = (uint8_t)wValue;
+    glRxStreamCfgReq.patternLen = (uint8_t)wLength;
+    CY_FX_RQT_APPLY (CY_FX_USBUART_EVT_RX_RECONFIG, glRxStreamCfg, glRxStreamCfgReq);
+    return CY_U3P_SUCCESS;
+}
+
+/* The header is only added outside of stream mode, which takes precedence. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetRxTimestamp (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if ((wValue > 1) || ((wValue == 1) && (CY_FX_RX_TS_ENABLE == 0)))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    glRxTsReq = (wValue == 1) ? CyTrue : CyFalse;
+    CY_FX_RQT_APPLY (CY_FX_USBUART_EVT_RX_RECONFIG, glRxTs, glRxTsReq);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+/* The benchmark modes re-create the data channels, which is not done with persistent channels. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetBenchMode (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if ((CY_U3P_GET_LSB (wValue) > CY_FX_BENCH_MODE_PATTERN) ||
+            (CY_U3P_GET_MSB (wValue) > CY_FX_BENCH_PATTERN_PRBS))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    glBenchModeReq = CY_U3P_GET_LSB (wValue);
+    glBenchPattern = CY_U3P_GET_MSB (wValue);
+    glBenchRate    = wIndex;
+    CY_FX_RQT_APPLY (CY_FX_USBUART_EVT_BENCH, glBenchMode, glBenchModeReq);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+/* The data channels are re-created in the same way as for a benchmark mode change. Only used where the
+   data from EP 2 OUT goes to the UART. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetTxCoalesce (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if (wValue > 1)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    glTxCoalesceReq = (wValue == 1) ? CyTrue : CyFalse;
+    if (glIsApplnActive)
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_BENCH, CYU3P_EVENT_OR);
+    }
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+/* The data channels are re-created in the same way as for a benchmark mode change. Only used while no
+   benchmark mode is selected. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetMuxMode (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if ((wValue > 1) || ((wValue == 1) && (CY_FX_MUX_ENABLE == 0)))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    glMuxReq = (wValue == 1) ? CyTrue : CyFalse;
+    if (glIsApplnActive)
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_BENCH, CYU3P_EVENT_OR);
+    }
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+#endif
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetStreamMode (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    glEp0Buffer[0] = glRxStreamCfgReq.mode;
+    glEp0Buffer[1] = glRxStreamCfgReq.param;
+    glEp0Buffer[2] = CY_U3P_GET_LSB (glRxStreamCfgReq.shortMax);
+    glEp0Buffer[3] = CY_U3P_GET_MSB (glRxStreamCfgReq.shortMax);
+    glEp0Buffer[4] = ((glIsApplnActive) && (CY_FX_STREAM_ACTIVE)) ? 1 : 0;
+    glEp0Buffer[5] = glRxStreamCfgReq.flags;
+    glEp0Buffer[6] = glRxStreamCfgReq.patternLen;
+    glEp0Buffer[7] = 0;
+    CyU3PMemCopy (glEp0Buffer + 8, glRxStreamCfgReq.pattern, CY_FX_STREAM_PATTERN_MAX);
+    return CyU3PUsbSendEP0Data (8 + CY_FX_STREAM_PATTERN_MAX, glEp0Buffer);
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetPort2Sink (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    /* The echo would corrupt the trace record stream on EP 4 IN. */
+    if ((wValue > CY_FX_PORT2_SINK_ECHO) ||
+            ((wValue == CY_FX_PORT2_SINK_ECHO) && (CyFxUsbUartDebugGetMode () != CY_FX_DEBUG_MODE_TEXT)))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    CyFxUsbUartPort2SetSink ((uint8_t)wValue);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetNotify (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if (wValue > (CY_FX_NOTIFY_ENABLE | CY_FX_NOTIFY_DATA_HINT))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    CyFxUsbUartNotifySetFlags ((uint8_t)wValue);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetLpmIdle (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    CyFxUsbUartLpmSetIdle (wValue);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtGetMuxStatus (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    return CyU3PUsbSendEP0Data (CyFxUsbUartMuxStatus (glEp0Buffer), glEp0Buffer);
+}
+
+/* Port 0 is the native UART, whose baud rate is set with SET_LINE_CODING. */
+static CyU3PReturnStatus_t
+CyFxUsbUartRqtSetMuxBaud (
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint16_t wLength)
+{
+    if ((wValue == 0) || (wValue >= CY_FX_MUX_PORT_COUNT) || (wIndex == 0))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    CyFxUsbUartMuxSetBaud ((uint8_t)wValue, (uint32_t)wIndex * 100);
+    CyU3PUsbAckSetup ();
+    return CY_U3P_SUCCESS;
+}
+
+/* Control requests handled by this application. Fast enumeration is used, so only requests addressed to
+   the interface, class, vendor and unknown control requests are looked up here. The CDC requests come
+   first, as they are the ones sent by the host drivers during normal operation. The vendor requests are
+   accepted with any recipient, as wIndex carries a parameter for most of them. */
+static const CyFxUsbUartRqt_t glUsbUartRqtTable[] =
+{
+    /* CDC class requests of the UART port and of the second port. */
+    {CY_U3P_USB_CLASS_RQT, CY_U3P_USB_TARGET_INTF, CY_FX_INTF_UART_COMM, SET_CONTROL_LINE_STATE,
+        CyFxUsbUartRqtSetControlLineState},
+    {CY_U3P_USB_CLASS_RQT, CY_U3P_USB_TARGET_INTF, CY_FX_INTF_UART_COMM, SET_LINE_CODING, CyFxUsbUartRqtSetLineCoding},
+    {CY_U3P_USB_CLASS_RQT, CY_U3P_USB_TARGET_INTF, CY_FX_INTF_UART_COMM, GET_LINE_CODING, CyFxUsbUartRqtGetLineCoding},
+    {CY_U3P_USB_CLASS_RQT, CY_U3P_USB_TARGET_INTF, CY_FX_INTF_DEBUG_COMM, SET_CONTROL_LINE_STATE, CyFxUsbUartRqtAck},
+    {CY_U3P_USB_CLASS_RQT, CY_U3P_USB_TARGET_INTF, CY_FX_INTF_DEBUG_COMM, SET_LINE_CODING, CyFxUsbUartRqtSetLineCoding},
+    {CY_U3P_USB_CLASS_RQT, CY_U3P_USB_TARGET_INTF, CY_FX_INTF_DEBUG_COMM, GET_LINE_CODING, CyFxUsbUartRqtGetLineCoding},
+
+    /* Standard requests not handled by the USB driver. */
+    {CY_U3P_USB_STANDARD_RQT, CY_U3P_USB_TARGET_INTF, CY_FX_RQT_ANY_INTF, CY_U3P_USB_SC_SET_FEATURE,
+        CyFxUsbUartRqtFunctionSuspend},
+    {CY_U3P_USB_STANDARD_RQT, CY_U3P_USB_TARGET_INTF, CY_FX_RQT_ANY_INTF, CY_U3P_USB_SC_CLEAR_FEATURE,
+        CyFxUsbUartRqtFunctionSuspend},
+
+    /* Vendor requests used to tune the bridge at runtime. */
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_RX_IDLE_CHARS,
+        CyFxUsbUartRqtSetRxIdleChars},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_GET_RX_IDLE_CHARS,
+        CyFxUsbUartRqtGetRxIdleChars},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_GET_RX_GEOMETRY,
+        CyFxUsbUartRqtGetRxGeometry},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_RX_DMA_MODE,
+        CyFxUsbUartRqtSetRxDmaMode},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_GET_TX_GEOMETRY,
+        CyFxUsbUartRqtGetTxGeometry},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_FLOW_CTRL,
+        CyFxUsbUartRqtSetFlowCtrl},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_GET_FLOW_CTRL,
+        CyFxUsbUartRqtGetFlowCtrl},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_GET_DEBUG_STATS,
+        CyFxUsbUartRqtGetDebugStats},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_DEBUG_MODE,
+        CyFxUsbUartRqtSetDebugMode},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_INTF_DEBUG_COMM, CY_FX_RQT_GET_STATS,
+        CyFxUsbUartRqtGetStats},
+#ifdef CY_FX_PROFILE_ENABLE
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_INTF_DEBUG_COMM, CY_FX_RQT_GET_PROFILE,
+        CyFxUsbUartRqtGetProfile},
+#endif
+#ifndef CY_FX_USBUART_PERSISTENT_CHANNELS
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_STREAM_MODE,
+        CyFxUsbUartRqtSetStreamMode},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_STREAM_MATCH,
+        CyFxUsbUartRqtSetStreamMatch},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_RX_TIMESTAMP,
+        CyFxUsbUartRqtSetRxTimestamp},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_BENCH_MODE,
+        CyFxUsbUartRqtSetBenchMode},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_TX_COALESCE,
+        CyFxUsbUartRqtSetTxCoalesce},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_MUX_MODE,
+        CyFxUsbUartRqtSetMuxMode},
+#endif
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_GET_STREAM_MODE,
+        CyFxUsbUartRqtGetStreamMode},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_PORT2_SINK,
+        CyFxUsbUartRqtSetPort2Sink},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_NOTIFY,
+        CyFxUsbUartRqtSetNotify},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_LPM_IDLE,
+        CyFxUsbUartRqtSetLpmIdle},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_GET_MUX_STATUS,
+        CyFxUsbUartRqtGetMuxStatus},
+    {CY_U3P_USB_VENDOR_RQT, CY_FX_RQT_ANY_TARGET, CY_FX_RQT_ANY_INTF, CY_FX_RQT_SET_MUX_BAUD,
+        CyFxUsbUartRqtSetMuxBaud}
+};
+
+/* Callback to handle the USB Setup Requests and CDC Class events. The request is looked up in
+   glUsbUartRqtTable; requests without an entry are left to the USB driver, which stalls them. The
+   device only connects once the descriptors are registered, and the CDC class and standard requests
+   are served from then on: their handlers only use state that is valid before the initialization is
+   done, or hand the work to the application thread. Vendor requests received before the
+   initialization is done are stalled, as they use the state of the data path. */
+static CyBool_t
+CyFxUSBUARTAppUSBSetupCB (
+        uint32_t setupdat0, /* SETUP Data 0 */
+        uint32_t setupdat1  /* SETUP Data 1 */
+        )
+{
+    const CyFxUsbUartRqt_t *rqt_p;
+    uint8_t  bRequest, bReqType;
+    uint8_t  bType, bTarget;
+    uint16_t wValue, wIndex, wLength;
+    CyBool_t isHandled = CyFalse;
+    uint32_t i;
+    CY_FX_PROF_DECLARE (profStart);
+
+    CY_FX_PROF_ENTER (profStart);
+
+    /* Decode the fields from the setup request. */
+    bReqType = (setupdat0 & CY_U3P_USB_REQUEST_TYPE_MASK);
+    bType    = (bReqType & CY_U3P_USB_TYPE_MASK);
+    bTarget  = (bReqType & CY_U3P_USB_TARGET_MASK);
+    bRequest = ((setupdat0 & CY_U3P_USB_REQUEST_MASK) >> CY_U3P_USB_REQUEST_POS);
+    wValue   = ((setupdat0 & CY_U3P_USB_VALUE_MASK)   >> CY_U3P_USB_VALUE_POS);
+    wIndex   = (setupdat1 & CY_U3P_USB_INDEX_MASK);
+    wLength  = ((setupdat1 & CY_U3P_USB_LENGTH_MASK)  >> CY_U3P_USB_LENGTH_POS);
 
-        if (status != CY_U3P_SUCCESS)
+    for (i = 0; ((glAppInitDone) || (bType != CY_U3P_USB_VENDOR_RQT)) &&
+            (i < (sizeof (glUsbUartRqtTable) / sizeof (glUsbUartRqtTable[0]))); i++)
+    {
+        rqt_p = &glUsbUartRqtTable[i];
+        if ((rqt_p->request == bRequest) && (rqt_p->type == bType) &&
+                ((rqt_p->target == CY_FX_RQT_ANY_TARGET) || (rqt_p->target == bTarget)) &&
+                ((rqt_p->intf == CY_FX_RQT_ANY_INTF) || (rqt_p->intf == wIndex)))
         {
-            isHandled = CyFalse;
+            isHandled = (rqt_p->handler (wValue, wIndex, wLength) == CY_U3P_SUCCESS) ? CyTrue : CyFalse;
+            break;
         }
     }
 
+    CY_FX_PROF_EXIT (CY_FX_PROF_SITE_EP0, profStart);
     return isHandled;
 }
 
+/* Callback to handle the LPM requests from the USB 3.0 host. The decision is left to the link power
+   management policy. */
 CyBool_t
 CyFxUSBUARTAppLPMRqtCB (
         CyU3PUsbLinkPowerMode link_mode)
 {
-    return CyTrue;
+    return CyFxUsbUartLpmAccept ();
+}
+
+/* Connect the USB pins. */
+static void
+CyFxUSBUARTAppConnect (
+        void)
+{
+    CyU3PReturnStatus_t apiRetStatus;
+
+#if (!defined (CB_ERROR_SOLUTION_SUGGESTED)) && (!defined (CY_FX_USBUART_PERSIST_HS))
+    /* Connect the USB Pins with super speed operation enabled. */
+    apiRetStatus = CyU3PConnectState(CyTrue, CyTrue);
+#else
+    /* Connect the USB Pins with super speed operation disabled. The persistent channels sized for
+       High-Speed cannot take SuperSpeed bursts. */
+    apiRetStatus = CyU3PConnectState(CyTrue, CyFalse);
+#endif
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {        
+        CyFxAppErrorHandler(apiRetStatus);
+    }
+    CyFxUsbUartStartupMark (CY_FX_STARTUP_CONNECT);
 }
 
-/* This function initializes the USB module, UART module and sets the enumeration descriptors */
+/* This function initializes the USB module, UART module and sets the enumeration descriptors. Only the USB
+   driver, the callbacks and the descriptors are needed for the host to enumerate the device. With
+   CY_FX_CONNECT_EARLY, the device connects right after these, and the rest is set up while the host
+   enumerates it. */
 void
 CyFxUSBUARTAppInit (
         void )
 
 {
     CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
+    uint8_t i;
 
     /* Start the USB functionality. */
     apiRetStatus = CyU3PUsbStart();
@@ -673,33 +2617,8 @@ CyFxUSBUARTAppInit (
         CyFxAppErrorHandler(apiRetStatus);
     }
 
-    /* Initialize the UART module */
-    apiRetStatus = CyU3PUartInit ();
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {
-        /* Error handling */
-        CyFxAppErrorHandler(apiRetStatus);
-    }
-
-    /* Configure the UART */
-    CyU3PMemSet ((uint8_t *)&glUartConfig, 0, sizeof (glUartConfig));
-    glUartConfig.baudRate = CY_U3P_UART_BAUDRATE_115200;
-    glUartConfig.stopBit = CY_U3P_UART_ONE_STOP_BIT;
-    glUartConfig.parity = CY_U3P_UART_NO_PARITY;
-    glUartConfig.flowCtrl = CyFalse;
-    glUartConfig.txEnable = CyTrue;
-    glUartConfig.rxEnable = CyTrue;
-    glUartConfig.isDma = CyTrue;
-
-    /* Set the UART configuration */
-    apiRetStatus = CyU3PUartSetConfig (&glUartConfig, NULL);
-    if (apiRetStatus != CY_U3P_SUCCESS )
-    {
-        /* Error handling */
-        CyFxAppErrorHandler(apiRetStatus);
-    }
-
-    /* Setup the callback to handle the setup requests */
+    /* Setup the callback to handle the setup requests. Requests are stalled until the initialization
+       is done. */
     CyU3PUsbRegisterSetupCallback(CyFxUSBUARTAppUSBSetupCB, CyTrue);
 
     /* Setup the callback to handle the USB events. */
@@ -709,199 +2628,316 @@ CyFxUSBUARTAppInit (
     CyU3PUsbRegisterLPMRequestCallback(CyFxUSBUARTAppLPMRqtCB);    
 
     /* Set the USB enumeration descriptors */
-
-    /* Super speed device descriptor. */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_SS_DEVICE_DESCR, 0, (uint8_t *)CyFxUSB30DeviceDscr);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
-        CyFxAppErrorHandler(apiRetStatus);
+    for (i = 0; i < CyFxUSBDscrCount; i++)
+    {
+        apiRetStatus = CyU3PUsbSetDesc ((CyU3PUSBSetDescType_t)CyFxUSBDscrTable[i].type,
+                CyFxUSBDscrTable[i].index, (uint8_t *)CyFxUSBDscrTable[i].desc);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyFxAppErrorHandler(apiRetStatus);
+        }
     }
 
-    /* High speed device descriptor. */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_HS_DEVICE_DESCR, 0, (uint8_t *)CyFxUSB20DeviceDscr);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
-        CyFxAppErrorHandler(apiRetStatus);
-    }
+#if (CY_FX_CONNECT_EARLY != 0)
+    CyFxUSBUARTAppConnect ();
+#endif
 
-    /* BOS descriptor */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_SS_BOS_DESCR, 0, (uint8_t *)CyFxUSBBOSDscr);
+    /* Initialize the UART module */
+    apiRetStatus = CyU3PUartInit ();
     if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
+    {
+        /* Error handling */
         CyFxAppErrorHandler(apiRetStatus);
     }
 
-    /* Device qualifier descriptor */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_DEVQUAL_DESCR, 0, (uint8_t *)CyFxUSBDeviceQualDscr);
+#ifdef CY_FX_PROFILE_ENABLE
+    /* Start the execution time profiler. */
+    apiRetStatus = CyFxUsbUartProfInit ();
     if (apiRetStatus != CY_U3P_SUCCESS)
-    {        
+    {
         CyFxAppErrorHandler(apiRetStatus);
     }
 
-    /* Super speed configuration descriptor */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_SS_CONFIG_DESCR, 0, (uint8_t *)CyFxUSBSSConfigDscr);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {      
-        CyFxAppErrorHandler(apiRetStatus);
-    }
+    /* Time the memory copy and set paths, and the DMA buffer allocator. The results are sent as trace records. */
+    CyFxUsbUartMemBenchmark ();
+    CyFxUsbUartBufBenchmark ();
+#endif
 
-    /* High speed configuration descriptor*/
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_HS_CONFIG_DESCR, 0, (uint8_t *)CyFxUSBHSConfigDscr);
+#if (CY_FX_RX_TS_ENABLE != 0)
+    /* Start the timer used for the timestamped RX stream. */
+    apiRetStatus = CyFxUsbUartTsInit ();
     if (apiRetStatus != CY_U3P_SUCCESS)
-    {        
+    {
         CyFxAppErrorHandler(apiRetStatus);
     }
+#endif
 
-    /* Full speed configuration descriptor */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_FS_CONFIG_DESCR, 0, (uint8_t *)CyFxUSBFSConfigDscr);
+    /* Set up the multiplexed mode, and the UART bridge if one is used. */
+    apiRetStatus = CyFxUsbUartMuxInit ();
     if (apiRetStatus != CY_U3P_SUCCESS)
-    {       
+    {
         CyFxAppErrorHandler(apiRetStatus);
     }
 
-    /* String descriptor 0 */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_STRING_DESCR, 0, (uint8_t *)CyFxUSBStringLangIDDscr);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {        
+    /* Configure the UART */
+    CyU3PMemSet ((uint8_t *)&glUartConfig, 0, sizeof (glUartConfig));
+    glUartConfig.baudRate = CY_U3P_UART_BAUDRATE_115200;
+    glUartConfig.stopBit = CY_U3P_UART_ONE_STOP_BIT;
+    glUartConfig.parity = CY_U3P_UART_NO_PARITY;
+    glUartConfig.flowCtrl = CY_FX_UART_FLOW_CTRL_DEFAULT;
+    glUartConfig.txEnable = CyTrue;
+    glUartConfig.rxEnable = CyTrue;
+    glUartConfig.isDma = CyTrue;
+
+    /* Set the UART configuration */
+    apiRetStatus = CyU3PUartSetConfig (&glUartConfig, CyFxUartEventCb);
+    if (apiRetStatus != CY_U3P_SUCCESS )
+    {
+        /* Error handling */
         CyFxAppErrorHandler(apiRetStatus);
     }
+    CyU3PMemCopy ((uint8_t *)&glUartConfigReq, (uint8_t *)&glUartConfig, sizeof (CyU3PUartConfig_t));
 
-    /* String descriptor 1 */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_STRING_DESCR, 1, (uint8_t *)CyFxUSBManufactureDscr);
+    apiRetStatus = CyFxUsbUartStreamInit ();
     if (apiRetStatus != CY_U3P_SUCCESS)
-    {        
+    {
         CyFxAppErrorHandler(apiRetStatus);
     }
 
-    /* String descriptor 2 */
-    apiRetStatus = CyU3PUsbSetDesc(CY_U3P_USB_SET_STRING_DESCR, 2, (uint8_t *)CyFxUSBProductDscr);
+    /* Create the timer used by the RX idle flush engine. The timer runs once every tick while the
+       application is active. */
+    apiRetStatus = CyU3PTimerCreate (&glRxIdleTimer, CyFxUartRxIdleTimerCb, 0, 1, 1, CYU3P_NO_ACTIVATE);
     if (apiRetStatus != CY_U3P_SUCCESS)
-    {        
+    {
         CyFxAppErrorHandler(apiRetStatus);
     }
+    CyFxUartRxIdleUpdate ();
 
-#ifndef CB_ERROR_SOLUTION_SUGGESTED
-    /* Connect the USB Pins with super speed operation enabled. */
-    apiRetStatus = CyU3PConnectState(CyTrue, CyTrue);
-#else
-    /* Connect the USB Pins with super speed operation enabled. */
-    apiRetStatus = CyU3PConnectState(CyTrue, CyFalse);
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+    /* Create all channels once, sized for the fastest connection allowed. The UART to USB channel
+       starts holding received data right away. */
+    CyFxUSBUARTChannelsCreate (CY_FX_USBUART_PERSIST_SPEED);
+    CyFxUartRxReprime ();
 #endif
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {        
-        CyFxAppErrorHandler(apiRetStatus);
+
+#if (CY_FX_CONNECT_EARLY == 0)
+    CyFxUSBUARTAppConnect ();
+#endif
+    CyFxUsbUartStartupMark (CY_FX_STARTUP_INIT_DONE);
+
+    /* Start the application if the host has configured the device in the meantime. */
+    CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+    glAppInitDone = CyTrue;
+    if (glAppStartPending)
+    {
+        glAppStartPending = CyFalse;
+        CyFxUSBUARTAppStart ();
     }
+    CyU3PMutexPut (&glAppLock);
 }
 
-/* Entry function for the USBUARTAppThread */
-void
-USBUARTAppThread_Entry (
+/* Entry function for the USBUARTDataThread. This thread only does the time critical work of the data
+   path, which is requested by the RX idle timer and the DMA callbacks through event flags:
+   wrapping up partial UART to USB buffers, re-priming the UART byte count and sending the
+   SERIAL_STATE notifications. It runs at a higher priority than the application thread, so that the
+   housekeeping done there does not delay a flush. glAppLock keeps the channels from being re-created
+   or destroyed while they are used. */
+static void
+USBUARTDataThread_Entry (
         uint32_t input)
 {
 #ifdef EN_UART_RCV_BLOCK_EN_DIS   
-    uint32_t regValueEn = 0, regValueDs = 0;
-#endif
-#ifdef CB_ERROR_SOLUTION_SUGGESTED
-    volatile uint32_t *pUartRxCount = (volatile uint32_t *)0xE000081C;  /* UART_RX_BYTE_COUNT register. */
-    volatile uint32_t *pIoState     = (volatile uint32_t *)0xE00013D4;  /* GPIO_INVALUE1 register. */
-    uint32_t prevCount = DFLT_UART_RX_COUNT;
-    uint32_t currCount = 0;
-    uint32_t ioState, ioPollCnt;
-    uint32_t sleepDelay = UART_TASK_DELAY;
-#endif
-
-    /* Initialize the USBUART Example Application */
-    CyFxUSBUARTAppInit();
-
-#ifdef EN_UART_RCV_BLOCK_EN_DIS   
-    /* UART Config Value for Enabling Rx Block */
-    regValueEn = UART->lpp_uart_config;
-
-    /* UART Config Value for Disabling the Rx Block  */
-    regValueDs = UART->lpp_uart_config & (~(CY_U3P_LPP_UART_RTS | CY_U3P_LPP_UART_RX_ENABLE));
+    uint32_t regValue = 0;
 #endif
+    CyU3PReturnStatus_t apiRetStatus;
+    uint32_t flags;
+    CY_FX_PROF_DECLARE (profStart);
 
     for (;;)
     {
+        if (CyU3PEventGet (&glUartAppEvent, CY_FX_USBUART_EVT_DATA_MASK, CYU3P_EVENT_OR_CLEAR, &flags,
+                    CYU3P_WAIT_FOREVER) != CY_U3P_SUCCESS)
+        {
+            continue;
+        }
+
+        CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
         if (glIsApplnActive)
         {
-#ifdef CB_ERROR_SOLUTION_SUGGESTED
-            /* While the application is active, check for data sent during the last 50 ms. If no data
-               has been sent to the host, use the channel wrap-up feature to send any partial buffer to
-               the USB host.
-            */
-            if (glPktsPending == 0)
+            if ((flags & CY_FX_USBUART_EVT_RX_REPRIME) != 0)
+            {
+                /* Re-initialize UART_RX_BYTE_COUNT register to a large value before it runs out. */
+                CY_FX_TRACE1 (CY_FX_TRACE_EVT_RX_REPRIME, UART->lpp_uart_rx_byte_count);
+                CyFxUartRxReprime ();
+            }
+
+            if ((flags & CY_FX_USBUART_EVT_NOTIFY) != 0)
+            {
+                CyFxUsbUartNotifySend ();
+            }
+
+            if ((flags & CY_FX_USBUART_EVT_LPM) != 0)
             {
+                CyFxUsbUartLpmApply ();
+            }
+
+            if ((flags & CY_FX_USBUART_EVT_MUX_DATA) != 0)
+            {
+                CyFxUsbUartMuxPump ();
+            }
+
+            if ((flags & CY_FX_USBUART_EVT_MUX) != 0)
+            {
+                CyFxUsbUartMuxService ();
+            }
+
+            if (((flags & CY_FX_USBUART_EVT_STREAM) != 0) && (CY_FX_STREAM_ACTIVE))
+            {
+                /* Copy the received data into the USB side buffers, before any wrap-up is issued below. */
+                CyFxUsbUartStreamPump ();
+            }
+
+            if ((flags & (CY_FX_USBUART_EVT_RX_IDLE | CY_FX_USBUART_EVT_RX_PEEK)) != 0)
+            {
+                CY_FX_PROF_ENTER (profStart);
+
+                /* Use the channel wrap-up feature to send the partial buffer to the USB host. */
 #ifdef EN_UART_RCV_BLOCK_EN_DIS   
-                /* Disable UART Receiver Block */
-                UART->lpp_uart_config = regValueDs;
+                /* Disable UART Receiver Block. The current configuration is read back each time, as the
+                   line coding, flow control and RTS settings can change at runtime. RTS is only cleared
+                   by hand while hardware flow control is disabled. */
+                regValue = UART->lpp_uart_config;
+                UART->lpp_uart_config = regValue & (~((glUartConfig.flowCtrl) ? CY_U3P_LPP_UART_RX_ENABLE :
+                            (CY_U3P_LPP_UART_RTS | CY_U3P_LPP_UART_RX_ENABLE)));
 #endif
 
-                CyU3PDmaChannelSetWrapUp (&glChHandleUarttoUsb);
+                if ((flags & CY_FX_USBUART_EVT_RX_IDLE) == 0)
+                {
+                    /* Hand the data received during the tick to the stream mode frame scanner. */
+                    if (CY_FX_STREAM_ACTIVE)
+                    {
+                        CyFxUsbUartStreamWrapUp (CyFalse);
+                    }
+                }
+                else
+                {
+                    /* In stream mode, the USB side buffer is also sent if there is nothing left to wrap up. */
+                    apiRetStatus = (CY_FX_STREAM_ACTIVE) ? CyFxUsbUartStreamWrapUp (CyTrue) :
+                        CyU3PDmaChannelSetWrapUp (&glChHandleUarttoUsb);
+                    CY_FX_TRACE1 (CY_FX_TRACE_EVT_RX_WRAPUP, apiRetStatus);
+                    if (apiRetStatus == CY_U3P_SUCCESS)
+                    {
+                        glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].wrapUps++;
+                    }
+                }
 
 #ifdef EN_UART_RCV_BLOCK_EN_DIS   
                 /* Enable UART Receiver Block */
-                UART->lpp_uart_config = regValueEn;
+                UART->lpp_uart_config = regValue;
 #endif
+
+                CY_FX_PROF_EXIT (CY_FX_PROF_SITE_RX_WRAPUP, profStart);
             }
+        }
+        CyU3PMutexPut (&glAppLock);
+    }
+}
+
+/* Create the data thread. This is done from CyFxApplicationDefine, once the event group and lock used by
+   the thread have been created. */
+static CyU3PReturnStatus_t
+CyFxUsbUartDataThreadCreate (
+        void)
+{
+    void *ptr = NULL;
+
+    ptr = CyU3PMemAlloc (CY_FX_USBUART_DATA_THREAD_STACK);
+    if (ptr == NULL)
+    {
+        return CY_U3P_ERROR_MEMORY_ERROR;
+    }
+
+    return CyU3PThreadCreate (&USBUARTDataThread,  /* Data thread structure */
+            "23:USBUART_data",                      /* Thread ID and Thread name */
+            USBUARTDataThread_Entry,                /* Data thread entry function */
+            0,                                      /* No input parameter to thread */
+            ptr,                                    /* Pointer to the allocated thread stack */
+            CY_FX_USBUART_DATA_THREAD_STACK,        /* Data thread stack size */
+            CY_FX_USBUART_DATA_THREAD_PRIORITY,     /* Data thread priority */
+            CY_FX_USBUART_DATA_THREAD_PRIORITY,     /* Data thread pre-emption threshold */
+            CYU3P_NO_TIME_SLICE,                    /* No time slice for the data thread */
+            CYU3P_AUTO_START                        /* Start the thread immediately */
+            );
+}
+
+/* Entry function for the USBUARTAppThread. After the initialization, this thread does the housekeeping:
+   error recovery, channel re-configuration, the link power management policy, the watchdog and the
+   keep-alive message. */
+void
+USBUARTAppThread_Entry (
+        uint32_t input)
+{
+    uint32_t evStat, flags;
+    uint32_t aliveTime;
+    uint32_t traffic, lastTraffic = 0;
+
+    /* A failure during the initialization stops this thread, and the watchdog then resets the device. */
+    CyFxUsbUartWatchdogStart ();
+
+    /* Initialize the USBUART Example Application */
+    CyFxUSBUARTAppInit();
+    CyFxUsbUartRecoverStart ();
+
+    aliveTime = CyU3PGetTime ();
+    for (;;)
+    {
+        /* Wait until a channel re-configuration or error recovery is requested. The timeout is used to
+           clear the watchdog and to send the periodic keep-alive message. */
+        evStat = CyU3PEventGet (&glUartAppEvent, CY_FX_USBUART_EVT_HOUSEKEEPING_MASK, CYU3P_EVENT_OR_CLEAR,
+                &flags, CY_FX_USBUART_WAKE_INTERVAL);
+        CyFxUsbUartWatchdogClear ();
+
+        if ((evStat == CY_U3P_SUCCESS) && ((flags & CY_FX_USBUART_EVT_RECOVER) != 0))
+        {
+            CyFxUsbUartRecoverRun ();
+        }
 
-            glPktsPending = 0;
-            
-            static uint16_t counter = 0;
-            counter++;
-            if (counter == 1200)
+        if ((evStat == CY_U3P_SUCCESS) && ((flags & CY_FX_USBUART_EVT_LINE_CODING) != 0))
+        {
+            CyFxUartLineCodingApply ();
+        }
+
+        if (glIsApplnActive)
+        {
+            if ((evStat == CY_U3P_SUCCESS) && ((flags & CY_FX_USBUART_EVT_BENCH) != 0))
             {
-                CyFxUsbUartDebugPrint("Alive\r\n");
-                counter = 0;
+                CyFxUsbUartBenchReconfig ();
             }
-#else /*solition suggested*/
-            currCount = *pUartRxCount;
-            if ((glPktsPending == 0) && (currCount == prevCount) && (currCount < DFLT_UART_RX_COUNT))
+
+            if ((evStat == CY_U3P_SUCCESS) && ((flags & CY_FX_USBUART_EVT_RX_RECONFIG) != 0))
             {
-                /*
-                 * State of UART_RX pin (GPIO56) can be read in bit number 24 of the GPIO_INVALUE1 register.
-                 *
-                 * At a baud rate of 115200, one bit time is about 8.7 us.
-                 * We will ensure that the signal stays high continuously for 100 us. Since the IO has to go low 
-                 * at least once per byte, this will ensure that there is no ongoing data reception.
-                 */
-                for (ioPollCnt = 0; ioPollCnt < 20; ioPollCnt++)
-                {
-                    ioState = *pIoState;
-                    if ((ioState & 0x01000000) == 0)
-                    {
-                        /* UART_RX pin sampled low indicating some activity. Skip wrap-up operation for now. */
-                        sleepDelay = 1;
-                        break;
-                    }
+                CyFxUartRxChannelReconfig ();
+            }
 
-                    CyU3PBusyWait(5);
-                }
+            /* Data sent by the host, and data that the idle timer only sees the start of, count as
+               traffic for the link power management policy. */
+            CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+            traffic = (glIsApplnActive) ? CyFxUsbUartTrafficCount () : lastTraffic;
+            CyU3PMutexPut (&glAppLock);
+            if (traffic != lastTraffic)
+            {
+                lastTraffic = traffic;
+                CyFxUsbUartLpmActivity ();
+            }
+            CyFxUsbUartLpmPoll ();
+            CyFxUsbUartStartupReport ();
 
-                if ((ioState & 0x01000000) != 0)
-                {
-                    /* Some data already received and UART is currently idle. Perform wrap operation. */
-                    CyU3PDmaChannelSetWrapUp (&glChHandleUarttoUsb);
-                    prevCount     = DFLT_UART_RX_COUNT;
-                    glPktsPending = 0;
-                    sleepDelay    = UART_TASK_DELAY;
-                }   
-            } else {
-                /* Sleep for UART_TASK_DELAY between iterations when UART is idle and less time when it is not. */
-                sleepDelay = (currCount == DFLT_UART_RX_COUNT) ? UART_TASK_DELAY : 1;
-
-                /* Either no data received from start or new data has been received. Skip Wrap-up operation for now. */
-                prevCount     = currCount;
-                glPktsPending = 0;
+            if ((CyU3PGetTime () - aliveTime) >= CY_FX_USBUART_ALIVE_INTERVAL)
+            {
+                CyFxUsbUartDebugPrint("Alive\r\n");
+                aliveTime = CyU3PGetTime ();
             }
-#endif
         }
-
-#ifdef CB_ERROR_SOLUTION_SUGGESTED
-        CyU3PThreadSleep (sleepDelay);
-#else
-        CyU3PThreadSleep (50);
-#endif
     }
 }
 
@@ -913,6 +2949,29 @@ CyFxApplicationDefine (
     void *ptr = NULL;
     uint32_t retThrdCreate = CY_U3P_SUCCESS;
 
+    /* The event group and channel lock are used by the USB callbacks, which may run as soon as the device
+       connects. They are created here, together with the data thread, so that the application thread
+       only has the USB connect and the module setup left to do. */
+    if (CyU3PEventCreate (&glUartAppEvent) != CY_U3P_SUCCESS)
+    {
+        /* Loop indefinitely */
+        while(1);
+    }
+
+    /* The lock is shared by threads of different priorities, and passes the priority of a waiting thread
+       on to the one holding it. */
+    if (CyU3PMutexCreate (&glAppLock, CYU3P_INHERIT) != CY_U3P_SUCCESS)
+    {
+        /* Loop indefinitely */
+        while(1);
+    }
+
+    if (CyFxUsbUartDataThreadCreate () != CY_U3P_SUCCESS)
+    {
+        /* Loop indefinitely */
+        while(1);
+    }
+
     /* Allocate the memory for the thread*/
     ptr = CyU3PMemAlloc (CY_FX_USBUART_THREAD_STACK);
 
@@ -935,6 +2994,14 @@ CyFxApplicationDefine (
         /* Loop indefinitely */
         while(1);
     }
+
+    /* Create the thread which sends the debug console output to the host. */
+    retThrdCreate = CyFxUsbUartDebugInit ();
+    if (retThrdCreate != 0)
+    {
+        /* Loop indefinitely */
+        while(1);
+    }
 }
 
 /* Main function */
@@ -965,12 +3032,26 @@ main (
     io_cfg.useUart   = CyTrue;
     io_cfg.useI2C    = CyFalse;
     io_cfg.useI2S    = CyFalse;
+#if (CY_FX_IO_SPI_PINOUT != 0)
+    /* UART and SPI, for the UART bridge of the multiplexed mode. This moves the UART pins. */
+    io_cfg.useSpi    = CyTrue;
+    io_cfg.lppMode   = CY_U3P_IO_MATRIX_LPP_DEFAULT;
+#else
     io_cfg.useSpi    = CyFalse;
     io_cfg.lppMode   = CY_U3P_IO_MATRIX_LPP_UART_ONLY;
+#endif
     io_cfg.gpioSimpleEn[0]  = 0;
     io_cfg.gpioSimpleEn[1]  = 0;
     io_cfg.gpioComplexEn[0] = 0;
     io_cfg.gpioComplexEn[1] = 0;
+#if (CY_FX_RX_TS_ENABLE != 0)
+    /* GPIO used as the timestamp timer. */
+    io_cfg.gpioComplexEn[CY_FX_RX_TS_TIMER_GPIO / 32] |= (1 << (CY_FX_RX_TS_TIMER_GPIO % 32));
+#endif
+#ifdef CY_FX_PROFILE_ENABLE
+    /* GPIO used as the profiling timer. */
+    io_cfg.gpioComplexEn[CY_FX_PROF_TIMER_GPIO / 32] |= (1 << (CY_FX_PROF_TIMER_GPIO % 32));
+#endif
     status = CyU3PDeviceConfigureIOMatrix (&io_cfg);
     if (status != CY_U3P_SUCCESS)
     {
@@ -987,51 +3068,3 @@ handle_fatal_error:
 
 }
 
-/* Function to send debug strings over the second CDC interface */
-CyU3PReturnStatus_t
-CyFxUsbUartDebugPrint (
-        const char *debugMsg
-        )
-{
-    CyU3PDmaBuffer_t dmaInfo;
-    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
-    uint16_t length = 0;
-
-    if (!glIsApplnActive)
-    {
-        return CY_U3P_ERROR_NOT_STARTED;
-    }
-    
-    /* Calculate length */
-    while (debugMsg[length] != '\0')
-    {
-        length++;
-    }
-
-    if (length == 0)
-    {
-        return CY_U3P_SUCCESS;
-    }
-
-    /* Acquire a buffer */
-    status = CyU3PDmaChannelGetBuffer (&glChHandleDebug, &dmaInfo, CYU3P_WAIT_FOREVER);
-    if (status != CY_U3P_SUCCESS)
-    {
-        return status;
-    }
-
-    /* Copy data. Note: If message is longer than buffer size, it will be truncated. */
-    if (length > dmaInfo.size)
-    {
-        length = dmaInfo.size;
-    }
-
-    CyU3PMemCopy (dmaInfo.buffer, (uint8_t *)debugMsg, length);
-    dmaInfo.count = length;
-
-    /* Commit buffer */
-    status = CyU3PDmaChannelCommitBuffer (&glChHandleDebug, dmaInfo.count, 0);
-
-    return status;
-}
-
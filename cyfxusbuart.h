@@ -27,12 +27,569 @@
 
 #include "cyu3types.h"
 #include "cyu3usbconst.h"
+#include "cyu3dma.h"
 #include "cyu3externcstart.h"
 
+/* Most of the compile-time settings below can be overridden on the compiler command line. The build
+   profiles of the makefile (make latency, make throughput, make debug) use this to select a coherent
+   set of settings. */
+#ifndef CY_FX_USBUART_DMA_BUF_COUNT
 #define  CY_FX_USBUART_DMA_BUF_COUNT      (8)
+#endif
 #define  CY_FX_USBUART_THREAD_STACK       (1000)
 #define  CY_FX_USBUART_THREAD_PRIORITY     (8)
 
+/* Burst length used for the data interface bulk endpoints (EP 2 IN/OUT) on SuperSpeed connections.
+   The default of 1 can be overridden at build time (make SS_BURST=<n>) to select the high-throughput
+   profile, where each USB to UART DMA buffer holds a complete burst of packets. The total memory
+   used by the USB to UART channel is limited to CY_FX_USBTOUART_DMA_BUDGET bytes. */
+#ifndef CY_FX_EP_BURST_LENGTH
+#define  CY_FX_EP_BURST_LENGTH            (1)
+#endif
+#if ((CY_FX_EP_BURST_LENGTH < 1) || (CY_FX_EP_BURST_LENGTH > 16))
+#error "CY_FX_EP_BURST_LENGTH should be in the range 1 to 16."
+#endif
+#define  CY_FX_USBTOUART_DMA_BUDGET       (65536)
+
+/* Interval (in ms) at which the application thread sends the keep-alive message on the debug port. */
+#define  CY_FX_USBUART_ALIVE_INTERVAL     (60000)
+
+/* Longest time (in ms) the application thread waits for an event. The watchdog is cleared each time the
+   thread wakes up, so this has to be well below the watchdog period. */
+#define  CY_FX_USBUART_WAKE_INTERVAL      (250)
+
+/* Watchdog period in ms, 0 to disable the watchdog (e.g. while debugging over JTAG). If the application
+   thread stops running for this long, the device is reset. */
+#ifndef CY_FX_WATCHDOG_PERIOD_MS
+#define  CY_FX_WATCHDOG_PERIOD_MS         (2000)
+#endif
+#if ((CY_FX_WATCHDOG_PERIOD_MS != 0) && (CY_FX_WATCHDOG_PERIOD_MS < (4 * CY_FX_USBUART_WAKE_INTERVAL)))
+#error "CY_FX_WATCHDOG_PERIOD_MS should be 0, or at least four times CY_FX_USBUART_WAKE_INTERVAL."
+#endif
+
+/* Data thread, which does the time critical work of the data path. It runs at a higher priority than the
+   application thread, which does the initialization and housekeeping. The deepest frame is the mux
+   expander service: with its CY_FX_MUX_EXP_FIFO_SIZE byte copy buffer and the SPI driver calls below it,
+   it is estimated at 400 bytes, and a profiler or trace record taken in the SPI wait adds about 100. The
+   stream pump, notification and LPM paths stay below 300 bytes. The stack is sized like that of the
+   application thread, to leave room for the SDK calls whose use is not known. */
+#define  CY_FX_USBUART_DATA_THREAD_STACK     (1024)
+#define  CY_FX_USBUART_DATA_THREAD_PRIORITY  (7)
+
+/* Event flags used to wake up the application and data threads. */
+#define  CY_FX_USBUART_EVT_RX_IDLE        (1 << 0)      /* UART receiver idle, partial buffer to be flushed. */
+#define  CY_FX_USBUART_EVT_RX_RECONFIG    (1 << 1)      /* UART to USB channel to be re-created with new settings. */
+#define  CY_FX_USBUART_EVT_RX_REPRIME     (1 << 2)      /* UART_RX_BYTE_COUNT running low, to be re-initialized. */
+#define  CY_FX_USBUART_EVT_BENCH          (1 << 3)      /* Data channels to be re-created for a new benchmark or TX mode. */
+#define  CY_FX_USBUART_EVT_NOTIFY         (1 << 4)      /* SERIAL_STATE notification to be sent. */
+#define  CY_FX_USBUART_EVT_RECOVER        (1 << 5)      /* Error recovery action to be run. */
+#define  CY_FX_USBUART_EVT_LPM            (1 << 6)      /* Link power management decision to be applied. */
+#define  CY_FX_USBUART_EVT_MUX            (1 << 7)      /* Multiplexed mode ports to be serviced. */
+#define  CY_FX_USBUART_EVT_RX_PEEK        (1 << 8)      /* Stream mode: data received during the tick to be scanned. */
+#define  CY_FX_USBUART_EVT_STREAM         (1 << 9)      /* Stream mode: buffers ready for the copy engine. */
+#define  CY_FX_USBUART_EVT_MUX_DATA       (1 << 10)     /* Multiplexed mode: buffers ready for the rings. */
+#define  CY_FX_USBUART_EVT_LINE_CODING    (1 << 11)     /* Line coding or flow control requested by the host to be applied. */
+
+/* Events handled by the data thread, and by the application thread. */
+#define  CY_FX_USBUART_EVT_DATA_MASK      (CY_FX_USBUART_EVT_RX_IDLE | CY_FX_USBUART_EVT_RX_REPRIME | \
+                                           CY_FX_USBUART_EVT_NOTIFY | CY_FX_USBUART_EVT_LPM | CY_FX_USBUART_EVT_MUX | \
+                                           CY_FX_USBUART_EVT_RX_PEEK | CY_FX_USBUART_EVT_STREAM | \
+                                           CY_FX_USBUART_EVT_MUX_DATA)
+#define  CY_FX_USBUART_EVT_HOUSEKEEPING_MASK (CY_FX_USBUART_EVT_RX_RECONFIG | CY_FX_USBUART_EVT_BENCH | \
+                                           CY_FX_USBUART_EVT_RECOVER | CY_FX_USBUART_EVT_LINE_CODING)
+
+/* RX idle flush engine: Any partially filled UART to USB buffer is sent to the host once no data has been
+   received for CY_FX_UART_RX_IDLE_CHARS character times. The receiver is sampled once every OS timer tick,
+   which is CY_FX_UART_RX_IDLE_TICK_US micro-seconds long. */
+#ifndef CY_FX_UART_RX_IDLE_CHARS
+#define  CY_FX_UART_RX_IDLE_CHARS         (4)
+#endif
+#define  CY_FX_UART_RX_IDLE_TICK_US       (1000)
+
+/* UART to USB DMA buffer geometry: The buffer size is the smallest power of two (at least
+   CY_FX_UART_RX_BUF_MIN_SIZE) that takes CY_FX_UART_RX_BUF_FILL_US or longer to fill at the current
+   baud rate, limited to a maximum that depends on the USB connection speed. The number of buffers
+   is chosen to keep the channel within CY_FX_UART_RX_BUF_BUDGET bytes. */
+#ifndef CY_FX_UART_RX_BUF_FILL_US
+#define  CY_FX_UART_RX_BUF_FILL_US        (1000)
+#endif
+#define  CY_FX_UART_RX_BUF_MIN_SIZE       (32)
+#define  CY_FX_UART_RX_BUF_MAX_FS         (512)
+#define  CY_FX_UART_RX_BUF_MAX_HS         (2048)
+#define  CY_FX_UART_RX_BUF_MAX_SS         (4096)
+#ifndef CY_FX_UART_RX_BUF_BUDGET
+#define  CY_FX_UART_RX_BUF_BUDGET         (8192)
+#endif
+
+/* Default type of the UART to USB DMA channel. CY_U3P_DMA_TYPE_MANUAL commits each buffer from the
+   DMA callback, while CY_U3P_DMA_TYPE_AUTO_SIGNAL lets the DMA hardware forward buffers without waiting
+   for the firmware; the callback is still told of each buffer, to sample the RX latency. The type can also be changed at runtime through a vendor request. */
+#ifndef CY_FX_UART_RX_DMA_TYPE
+#define  CY_FX_UART_RX_DMA_TYPE           (CY_U3P_DMA_TYPE_AUTO_SIGNAL)
+#endif
+
+/* Link power management of SuperSpeed connections (cyfxusbuartlpm.c): U1/U2 is allowed once no UART or
+   USB traffic has been seen for CY_FX_LPM_IDLE_MS ms, and disabled again as soon as data is received
+   by the UART. 0 keeps LPM disabled at all times. The idle period can be changed at runtime through a
+   vendor request. */
+#ifndef CY_FX_LPM_IDLE_MS
+#define  CY_FX_LPM_IDLE_MS                (2000)
+#endif
+
+/* Startup sequence: With CY_FX_CONNECT_EARLY set, the device connects to the bus as soon as the USB driver
+   has been started and the descriptors are in place. The UART and the other modules are set up while the
+   host enumerates the device, and a SET_CONFIGURATION that arrives before then starts the application
+   once they are ready. 0 keeps the connect at the end of the initialization (make CONNECT_EARLY=0), so
+   that the two can be compared.
+   The time at which each CY_FX_STARTUP_* milestone is first reached is sent on the debug port once the
+   first byte has been received (cyfxusbuartstartup.c). */
+#ifndef CY_FX_CONNECT_EARLY
+#define  CY_FX_CONNECT_EARLY              (1)
+#endif
+#define  CY_FX_STARTUP_CONNECT            (0)       /* CyU3PConnectState done. */
+#define  CY_FX_STARTUP_INIT_DONE          (1)       /* CyFxUSBUARTAppInit done. */
+#define  CY_FX_STARTUP_USB_RESET          (2)       /* First USB connect or reset event. */
+#define  CY_FX_STARTUP_SETCONF            (3)       /* First SET_CONFIGURATION. */
+#define  CY_FX_STARTUP_APP_START          (4)       /* Data path started for the first time. */
+#define  CY_FX_STARTUP_FIRST_RX           (5)       /* First byte received by the UART. */
+#define  CY_FX_STARTUP_COUNT              (6)
+
+/* Time (in ms) the host is given to read more of the UART to USB channel before it is re-created, and the
+   longest total time it is waited for while it keeps reading. Data left in the channel is dropped, and
+   counted in the statistics block. */
+#define  CY_FX_UART_RX_RECONFIG_TIMEOUT   (20)
+#define  CY_FX_UART_RX_RECONFIG_MAX_MS    (500)
+
+/* Coalescing mode: The USB to UART path is split into a MANUAL_IN channel from EP 2 OUT, with one packet
+   (or burst) per buffer, from which the firmware packs the data into the buffers of a MANUAL_OUT channel
+   to the UART. Each USB side buffer is freed as soon as its data has been copied, so that the host can
+   queue many small writes without running out of buffers. A UART side buffer is sent when it is full,
+   or straight away if the UART is idle. The mode is selected at runtime through a vendor request, and
+   is not available with persistent channels. */
+#define  CY_FX_COALESCE_USB_BUF_COUNT     (16)      /* Largest number of USB side buffers. */
+#define  CY_FX_COALESCE_UART_BUF_SIZE     (1024)    /* Size of the UART side buffers. */
+#define  CY_FX_COALESCE_UART_BUF_COUNT    (4)
+
+/* Maximum time (in ms) to wait for the USB to UART channel to drain before the line coding is changed, and
+   the number of characters the UART transmitter is given on top of that to send out what it holds. */
+#define  CY_FX_UART_LINE_CODING_DRAIN_MS  (2)
+#define  CY_FX_UART_TX_FIFO_CHARS         (16)
+
+/* Stream mode: The UART to USB path is split into a MANUAL_IN channel with small buffers, from which the
+   firmware copies the received data into the large buffers of a MANUAL_OUT channel to EP 2 IN. Frame
+   boundaries are found in the received data, using either a delimiter byte or a length byte at a fixed
+   offset in each frame (the frame holds offset + 1 + length bytes). A frame of up to shortMax bytes is
+   committed to the host as soon as its end has been received (latency lane); other data accumulates
+   until a buffer is full (throughput lane) or the receiver goes idle.
+
+   Frames can also end with a sequence of up to CY_FX_STREAM_PATTERN_MAX bytes, such as CR/LF or a
+   protocol trailer. The scanner only sees the data of UART side buffers that are full or have been
+   wrapped up. With CY_FX_STREAM_FLAG_TICK, the data thread wraps up the UART side buffer on each idle
+   timer tick that saw new data, so that the end of a frame is found within a tick even while the line
+   stays busy. Setting CY_FX_STREAM_ENABLE to 0 removes the mode tests from the data path, and the mode
+   can then not be selected. */
+#ifndef CY_FX_STREAM_ENABLE
+#define  CY_FX_STREAM_ENABLE              (1)
+#endif
+#define  CY_FX_STREAM_MODE_OFF            (0)       /* Stream mode disabled. */
+#define  CY_FX_STREAM_MODE_DELIMITER      (1)       /* Frames end with the delimiter byte. */
+#define  CY_FX_STREAM_MODE_LENGTH         (2)       /* Frames carry a length byte. */
+#define  CY_FX_STREAM_MODE_PATTERN        (3)       /* Frames end with the byte sequence. */
+#define  CY_FX_STREAM_PATTERN_MAX         (8)       /* Longest byte sequence that can be matched. */
+#define  CY_FX_STREAM_FLAG_TICK           (1 << 0)  /* Scan the data received during each tick. */
+#define  CY_FX_STREAM_RX_BUF_SIZE         (32)      /* Size of the UART side buffers. */
+#define  CY_FX_STREAM_RX_BUF_COUNT        (16)
+#define  CY_FX_STREAM_TX_BUF_SIZE         (4096)    /* Size of the USB side buffers. */
+#define  CY_FX_STREAM_TX_BUF_COUNT        (4)
+#define  CY_FX_STREAM_SHORT_FRAME_DEFAULT (64)
+
+typedef struct CyFxUsbUartStreamCfg_t
+{
+    uint8_t  mode;              /* CY_FX_STREAM_MODE_* */
+    uint8_t  param;             /* Delimiter byte, or offset of the length byte. */
+    uint16_t shortMax;          /* Largest frame that is sent on the latency lane. */
+    uint8_t  flags;             /* CY_FX_STREAM_FLAG_* */
+    uint8_t  patternLen;        /* Length of the byte sequence, in CY_FX_STREAM_MODE_PATTERN. */
+    uint8_t  pattern[CY_FX_STREAM_PATTERN_MAX];     /* Byte sequence that ends a frame. */
+} CyFxUsbUartStreamCfg_t;
+
+/* Timestamped RX stream (cyfxusbuartts.c): When enabled, each buffer sent on EP 2 IN starts with a
+   CY_FX_RX_TS_HDR_SIZE byte header, which is placed in the producer header space of the UART to USB
+   channel. The channel is a MANUAL channel in this mode. Header layout (all fields little endian):
+     Byte  0       : CY_FX_RX_TS_SYNC
+     Byte  1       : CY_FX_RX_TS_FLAG_* flags
+     Bytes 2 - 3   : Number of data bytes following the header
+     Bytes 4 - 7   : Buffer sequence number, counting from 0 whenever the channel is (re-)created
+     Bytes 8 - 11  : Time at which the first byte was received, in CY_FX_RX_TS_TICK_HZ timer ticks
+     Bytes 12 - 15 : Idle time on the line before the first byte in timer ticks, 0xFFFFFFFF if not known
+   A buffer is wrapped up when the line goes idle, so each idle period longer than the RX idle flush
+   period shows up as the gap in front of a buffer. Stream mode takes precedence over this mode, and
+   neither is available with persistent channels. The byte counts of the statistics block include
+   the headers. Setting CY_FX_RX_TS_ENABLE to 0 removes the mode from the data path, and leaves
+   CY_FX_RX_TS_TIMER_GPIO free. */
+#ifndef CY_FX_RX_TS_ENABLE
+#define  CY_FX_RX_TS_ENABLE               (1)
+#endif
+#define  CY_FX_RX_TS_HDR_SIZE             (16)
+#define  CY_FX_RX_TS_SYNC                 (0xA7)
+#define  CY_FX_RX_TS_FLAG_IDLE            (1 << 0)  /* The line went idle after the last byte. */
+#define  CY_FX_RX_TS_FLAG_APPROX          (1 << 1)  /* The time of the first byte is an estimate. */
+#define  CY_FX_RX_TS_FLAG_START           (1 << 2)  /* First buffer after the channel was (re-)created. */
+#define  CY_FX_RX_TS_TIMER_GPIO           (51)      /* Complex GPIO used as the timestamp timer. Not used by the UART. */
+#define  CY_FX_RX_TS_SLOW_CLK_DIV         (64)      /* Slow GPIO clock = fast GPIO clock / 64. */
+#define  CY_FX_RX_TS_TICK_HZ              (3150000) /* Nominal timer rate: SYS_CLK (403.2 MHz) / 2 / 64. */
+#define  CY_FX_RX_TS_SAMPLES              (128)     /* Number of UART byte count samples kept. */
+
+/* Multiplexed mode (cyfxusbuartmux.c): EP 2 carries several logical serial ports, each chunk of data
+   starting with a CY_FX_MUX_HDR_SIZE byte header:
+     Byte 0 : Bits 3:0 = port, bits 7:4 = CY_FX_MUX_TYPE_*
+     Byte 1 : Number of payload bytes following the header (0 - 255)
+   Port 0 is the native UART; ports 1 to CY_FX_MUX_EXP_PORTS are the channels of a dual UART bridge with
+   an SPI interface (SC16IS752 register set) on the FX3 SPI port. The host only sends DATA chunks.
+   Each port has a transmit and a receive ring of CY_FX_MUX_RING_SIZE bytes:
+     - The host may send as many bytes to a port as the transmit ring holds when the mode is started,
+       and gets more through CREDIT chunks (2 byte payload: bytes freed, little endian) as the data
+       goes out. Data beyond the credit is dropped, so that the EP 2 OUT path never stalls.
+     - A port whose receive ring is full is stalled by itself: the native UART through its DMA buffers,
+       the bridge channels through their FIFOs and automatic RTS.
+     - The receive rings are served in turn, at most CY_FX_MUX_QUANTUM bytes at a time, into large
+       EP 2 IN buffers that are sent when full or CY_FX_MUX_BATCH_MS after their first chunk.
+   The mode is selected at runtime through a vendor request, and is not available with persistent
+   channels. Without the bridge (CY_FX_MUX_EXP_PORTS = 0), only port 0 is available. Setting
+   CY_FX_MUX_ENABLE to 0 removes the mode tests from the data path, and the mode can then not be
+   selected. */
+#ifndef CY_FX_MUX_ENABLE
+#define  CY_FX_MUX_ENABLE                 (1)
+#endif
+#ifndef CY_FX_MUX_EXP_PORTS
+#define  CY_FX_MUX_EXP_PORTS              (0)
+#endif
+#if ((CY_FX_MUX_EXP_PORTS < 0) || (CY_FX_MUX_EXP_PORTS > 2))
+#error "CY_FX_MUX_EXP_PORTS should be in the range 0 to 2."
+#endif
+#if ((CY_FX_MUX_EXP_PORTS != 0) && (CY_FX_MUX_ENABLE == 0))
+#error "CY_FX_MUX_EXP_PORTS needs CY_FX_MUX_ENABLE=1."
+#endif
+
+/* Pinout of the serial peripherals. By default (0), the IO matrix is set up for the UART only, which
+   puts the UART on GPIO 53 - 56. With 1, the default pinout is used instead: the UART moves to
+   GPIO 46 - 49 and the SPI block gets GPIO 53 - 56. The SPI UART bridge of the multiplexed mode needs
+   the SPI block, so boards with the bridge have to be wired for, and built with, the default pinout. */
+#ifndef CY_FX_IO_SPI_PINOUT
+#define  CY_FX_IO_SPI_PINOUT              (0)
+#endif
+#if ((CY_FX_MUX_EXP_PORTS != 0) && (CY_FX_IO_SPI_PINOUT == 0))
+#error "CY_FX_MUX_EXP_PORTS needs CY_FX_IO_SPI_PINOUT=1, which moves the UART to GPIO 46 - 49."
+#endif
+#define  CY_FX_MUX_PORT_COUNT             (1 + CY_FX_MUX_EXP_PORTS)
+#define  CY_FX_MUX_HDR_SIZE               (2)
+#define  CY_FX_MUX_TYPE_DATA              (0)       /* Serial data for or from the port. */
+#define  CY_FX_MUX_TYPE_CREDIT            (1)       /* Transmit ring space freed on the port. */
+#define  CY_FX_MUX_RING_SIZE              (1024)    /* Size of each ring, a power of two. */
+#define  CY_FX_MUX_QUANTUM                (128)     /* Largest chunk taken from one port in turn. */
+#define  CY_FX_MUX_CREDIT_MIN             (64)      /* Credits of this size are sent at once, smaller ones each tick. */
+#define  CY_FX_MUX_BATCH_MS               (2)       /* Longest time data waits in a partial EP 2 IN buffer. */
+#define  CY_FX_MUX_USB_BUF_SIZE           (4096)    /* Size of the EP 2 IN buffers. */
+#define  CY_FX_MUX_USB_BUF_COUNT          (4)
+#define  CY_FX_MUX_USB_OUT_BUF_COUNT      (8)       /* Number of EP 2 OUT buffers. */
+#define  CY_FX_MUX_UART_BUF_SIZE          (64)      /* Size of the native UART receive buffers. */
+#define  CY_FX_MUX_UART_BUF_COUNT         (8)
+#define  CY_FX_MUX_EXP_SPI_CLOCK          (4000000) /* SPI clock of the bridge. */
+#define  CY_FX_MUX_EXP_XTAL_HZ            (14745600) /* Crystal frequency of the bridge. */
+#define  CY_FX_MUX_EXP_BAUD_DEFAULT       (115200)  /* Baud rate of the bridge channels, always 8N1. */
+#define  CY_FX_MUX_EXP_FIFO_SIZE          (64)      /* Size of the bridge FIFOs. */
+
+/* Second CDC port: Data written to EP 4 OUT is received by the firmware, counted in the statistics block
+   and passed to the selected sink. The port has its own line coding, which is only stored. The echo
+   shares the debug console ring with the log messages, so it is only available in text mode; raw bytes
+   would break up the trace record stream. */
+#define  CY_FX_PORT2_SINK_DISCARD         (0)       /* Drop the received data. */
+#define  CY_FX_PORT2_SINK_ECHO            (1)       /* Echo the received data on EP 4 IN, text mode only. */
+#define  CY_FX_PORT2_DMA_BUF_COUNT        (4)
+#define  CY_FX_INTF_UART_COMM             (0)       /* Communication interface of the UART port. */
+#define  CY_FX_INTF_DEBUG_COMM            (2)       /* Communication interface of the second (debug) port. */
+
+/* CDC line coding structure, in the layout of the SET_LINE_CODING and GET_LINE_CODING data stages. The
+   structure is packed, so that the state of each port can be sent as it is. */
+typedef struct __attribute__ ((packed)) CyFxUsbUartLineCoding_t
+{
+    uint32_t dwDTERate;         /* Baud rate. */
+    uint8_t  bCharFormat;       /* Stop bits. 0: 1, 1: 1.5, 2: 2. */
+    uint8_t  bParityType;       /* Parity. 0: None, 1: Odd, 2: Even, 3: Mark, 4: Space. */
+    uint8_t  bDataBits;         /* Data bits. */
+} CyFxUsbUartLineCoding_t;
+
+/* CDC SERIAL_STATE notifications of the UART port, sent on EP 1 IN (cyfxusbuartnotify.c). The FX3 UART
+   does not report break and framing errors, so CY_FX_SERIAL_STATE_BREAK and CY_FX_SERIAL_STATE_FRAMING
+   are never set. CY_FX_SERIAL_STATE_DATA_AVAIL uses a reserved bit, and is only sent when enabled with
+   CY_FX_NOTIFY_DATA_HINT. */
+#define  CY_FX_SERIAL_STATE_DCD           (1 << 0)  /* bRxCarrier: The bridge is active. */
+#define  CY_FX_SERIAL_STATE_DSR           (1 << 1)  /* bTxCarrier: The bridge is active. */
+#define  CY_FX_SERIAL_STATE_BREAK         (1 << 2)
+#define  CY_FX_SERIAL_STATE_RING          (1 << 3)
+#define  CY_FX_SERIAL_STATE_FRAMING       (1 << 4)
+#define  CY_FX_SERIAL_STATE_PARITY        (1 << 5)  /* UART parity error. */
+#define  CY_FX_SERIAL_STATE_OVERRUN       (1 << 6)  /* UART receive FIFO overflow. */
+#define  CY_FX_SERIAL_STATE_DATA_AVAIL    (1 << 8)  /* Vendor specific: New data received by the UART. */
+#define  CY_FX_NOTIFY_ENABLE              (1 << 0)  /* Send SERIAL_STATE notifications. */
+#define  CY_FX_NOTIFY_DATA_HINT           (1 << 1)  /* Also send the data available hint. */
+#define  CY_FX_NOTIFY_DMA_BUF_SIZE        (64)
+#define  CY_FX_NOTIFY_DMA_BUF_COUNT       (2)
+
+/* Benchmark modes, which replace the normal bridge operation of the EP 2 data path:
+   USB loopback: EP 2 OUT is connected straight to EP 2 IN by an AUTO channel, bypassing the UART.
+   UART loopback: The normal data path, with the UART block in internal loopback mode, so that the
+   UART line and the connected target are not involved.
+   Pattern: The firmware sends a counter or PRBS pattern on EP 2 IN at a selectable rate, and checks
+   the same pattern in the data received on EP 2 OUT (cyfxusbuartbench.c). */
+#define  CY_FX_BENCH_MODE_OFF             (0)       /* Normal operation. */
+#define  CY_FX_BENCH_MODE_USB_LOOPBACK    (1)
+#define  CY_FX_BENCH_MODE_UART_LOOPBACK   (2)
+#define  CY_FX_BENCH_MODE_PATTERN         (3)
+#define  CY_FX_BENCH_PATTERN_COUNTER      (0)       /* Each word is the previous word plus one. */
+#define  CY_FX_BENCH_PATTERN_PRBS         (1)       /* 32-bit PRBS. */
+
+/* Persistent channel mode (make PERSIST=1): All DMA channels are created once at init time, before the
+   connection speed is known, and are sized for CY_FX_USBUART_PERSIST_SPEED. They are not re-sized when
+   SET_CONFIGURATION reports the actual speed, as that would mean re-creating the UART to USB channel and
+   dropping the data it holds for the host. By default the channels are sized for a SuperSpeed
+   connection. Their buffers are multiples of the packet size at every speed, so they serve any
+   connection, at the cost of the buffer memory a High-Speed or Full-Speed connection does not need.
+   With CY_FX_USBUART_PERSIST_HS (make PERSIST=1 PERSIST_HS=1), they are sized for High-Speed instead, and
+   the device connects with SuperSpeed disabled, because the smaller buffers cannot take SuperSpeed
+   packets and bursts. A USB reset or disconnect only flushes the endpoints and resets the USB to UART
+   and debug channels, and a SET_CONFIGURATION re-arms them. The UART to USB channel is left running, so
+   that its buffers act as the holding area for the data received while the host is away. Once these are
+   full, the UART receiver stalls; data is lost from then on unless RTS/CTS flow control is enabled. The
+   number of buffers is raised so that the holding area covers about 100 ms or more at any baud rate. */
+#ifdef CY_FX_USBUART_PERSISTENT_CHANNELS
+#define  CY_FX_UART_RX_HOLD_BUF_COUNT     (128)
+#define  CY_FX_UART_RX_HOLD_BUDGET        (32768)
+#ifdef CY_FX_USBUART_PERSIST_HS
+#define  CY_FX_USBUART_PERSIST_SPEED      (CY_U3P_HIGH_SPEED)
+#else
+#define  CY_FX_USBUART_PERSIST_SPEED      (CY_U3P_SUPER_SPEED)
+#endif
+#elif defined (CY_FX_USBUART_PERSIST_HS)
+#error "CY_FX_USBUART_PERSIST_HS needs CY_FX_USBUART_PERSISTENT_CHANNELS (make PERSIST=1)."
+#endif
+
+/* Hardware RTS/CTS flow control on the UART. When enabled, the UART transmitter stops while the target
+   de-asserts CTS. The USB to UART channel is an AUTO channel, so its buffers then fill up and EP 2 OUT
+   NAKs the host until the target is ready again; no data is dropped. The setting can be changed at
+   runtime through a vendor request. While flow control is disabled, the RTS line follows the RTS bit
+   of the CDC SET_CONTROL_LINE_STATE request. */
+#define  CY_FX_UART_FLOW_CTRL_DEFAULT     (CyFalse)
+
+/* Error recovery (cyfxusbuartrecover.c): Each error is counted by class. A DMA error re-arms the
+   affected channel by resetting and restarting it, which drops the data in its buffers but does not
+   re-create it. A failed API call restarts the application, as a SET_CONFIGURATION would. Once
+   CY_FX_RECOVER_RESTART_THRESHOLD of these errors have been seen within CY_FX_RECOVER_WINDOW_MS, the
+   application is restarted as well. EP0 errors are only counted, and never lead to a restart. If more
+   than CY_FX_RECOVER_MAX_RESTARTS restarts follow each other, with less than CY_FX_RECOVER_WINDOW_MS in
+   between, the device is reset. */
+#define  CY_FX_ERR_USBTOUART              (0)       /* DMA error on the USB to UART channel. */
+#define  CY_FX_ERR_UARTTOUSB              (1)       /* DMA error on the UART to USB channel(s). */
+#define  CY_FX_ERR_PORT2                  (2)       /* DMA error on the second port channel. */
+#define  CY_FX_ERR_EP0                    (3)       /* Control request that could not be completed. */
+#define  CY_FX_ERR_API                    (4)       /* Failed API call (CyFxAppErrorHandler). */
+#define  CY_FX_ERR_CLASS_COUNT            (5)
+#define  CY_FX_RECOVER_WINDOW_MS          (1000)
+#define  CY_FX_RECOVER_RESTART_THRESHOLD  (8)
+#define  CY_FX_RECOVER_MAX_RESTARTS       (3)
+#define  CY_FX_RECOVER_ACT_REARM          (1)       /* Trace: a channel was re-armed. */
+#define  CY_FX_RECOVER_ACT_RESTART        (2)       /* Trace: the application was restarted. */
+#define  CY_FX_RECOVER_ACT_RESET          (3)       /* Trace: the device is reset. */
+
+/* Debug console: Messages are queued in a ring buffer of CY_FX_DEBUG_RING_SIZE bytes (a power of two)
+   and sent on the debug interface by a low priority thread once every CY_FX_DEBUG_FLUSH_INTERVAL ms.
+   Messages that do not fit in the ring are dropped and counted. */
+#define  CY_FX_DEBUG_RING_SIZE            (4096)
+#if ((CY_FX_DEBUG_RING_SIZE & (CY_FX_DEBUG_RING_SIZE - 1)) != 0)
+#error "CY_FX_DEBUG_RING_SIZE should be a power of two."
+#endif
+#define  CY_FX_DEBUG_FLUSH_INTERVAL       (10)
+#define  CY_FX_DEBUG_THREAD_STACK         (512)
+#define  CY_FX_DEBUG_THREAD_PRIORITY      (15)
+
+/* Output format of the debug console. In text mode only the messages sent through CyFxUsbUartDebugPrint are
+   output, as plain strings. In trace mode, compact binary trace records are logged from the data path as
+   well, and messages are wrapped in CY_FX_TRACE_EVT_TEXT records. The host side decoder is
+   python_scripts/fx3_trace_decode.py. The mode can be changed at runtime through a vendor request. */
+#define  CY_FX_DEBUG_MODE_TEXT            (0)
+#define  CY_FX_DEBUG_MODE_TRACE           (1)
+#ifndef CY_FX_DEBUG_MODE_DEFAULT
+#define  CY_FX_DEBUG_MODE_DEFAULT         (CY_FX_DEBUG_MODE_TRACE)
+#endif
+
+/* Trace record definitions. See cyfxusbuartdebug.c for the record format. Setting CY_FX_TRACE_ENABLE to 0
+   removes the trace records from the data path; the CY_FX_TRACE* macros then compile to nothing, and
+   only text messages are sent in trace mode. */
+#ifndef CY_FX_TRACE_ENABLE
+#define  CY_FX_TRACE_ENABLE               (1)
+#endif
+#define  CY_FX_TRACE_SYNC                 (0xA5)
+#define  CY_FX_TRACE_MAX_TEXT             (255)
+#define  CY_FX_TRACE_TIMESTAMP()          (CyU3PGetTime ())
+
+#define  CY_FX_TRACE_EVT_TEXT             (0x01)    /* Text message. */
+#define  CY_FX_TRACE_EVT_USB_EVENT        (0x02)    /* arg0: USB event type, arg1: event data. */
+#define  CY_FX_TRACE_EVT_LINE_CODING      (0x03)    /* arg0: baud rate, arg1: stop bits, arg2: parity. */
+#define  CY_FX_TRACE_EVT_FLOW_CTRL        (0x04)    /* arg0: flow control enabled. */
+#define  CY_FX_TRACE_EVT_RX_COMMIT        (0x10)    /* arg0: byte count of the committed buffer. */
+#define  CY_FX_TRACE_EVT_RX_WRAPUP        (0x11)    /* arg0: wrap-up status. */
+#define  CY_FX_TRACE_EVT_RX_RECONFIG      (0x12)    /* arg0: buffer size, arg1: buffer count, arg2: DMA type. */
+#define  CY_FX_TRACE_EVT_RX_REPRIME       (0x13)    /* arg0: UART_RX_BYTE_COUNT before re-priming. */
+#define  CY_FX_TRACE_EVT_FLOW_STALL       (0x14)    /* arg0: 1 - stall start, 0 - stall end, arg1: stall count. */
+#define  CY_FX_TRACE_EVT_BENCH_MODE       (0x15)    /* arg0: CY_FX_BENCH_MODE_*, arg1: pattern, arg2: rate in KB/s. */
+#define  CY_FX_TRACE_EVT_ERROR            (0x16)    /* arg0: CY_FX_ERR_* class, arg1: error code or DMA callback type. */
+#define  CY_FX_TRACE_EVT_RECOVER          (0x17)    /* arg0: CY_FX_RECOVER_ACT_*, arg1: CY_FX_ERR_* class re-armed, or
+                                                       restarts in a row, arg2: time in ms. */
+#define  CY_FX_TRACE_EVT_LPM              (0x18)    /* arg0: 1 if U1/U2 is now allowed, 0 if disabled, arg1: link state. */
+#define  CY_FX_TRACE_EVT_STARTUP          (0x19)    /* arg0: CY_FX_STARTUP_* milestone, arg1: time in ms, arg2: bus speed. */
+#define  CY_FX_TRACE_EVT_RX_RECONFIG_LOST (0x1A)    /* arg0: bytes dropped, arg1: time waited for the host in ms. */
+#define  CY_FX_TRACE_EVT_DMA_CB           (0x20)    /* arg0: DMA callback type. */
+#define  CY_FX_TRACE_EVT_MEM_BENCH        (0x30)    /* arg0: CY_FX_MEM_BENCH_* path, arg1: bytes, arg2: timer ticks. */
+#define  CY_FX_TRACE_EVT_BUF_BENCH        (0x31)    /* arg0: bytes, arg1: alloc timer ticks, arg2: free timer ticks. */
+
+#if (CY_FX_TRACE_ENABLE != 0)
+#define  CY_FX_TRACE0(id)                 CyFxUsbUartTraceLog ((id), 0, 0, 0, 0)
+#define  CY_FX_TRACE1(id,a0)              CyFxUsbUartTraceLog ((id), 1, (uint32_t)(a0), 0, 0)
+#define  CY_FX_TRACE2(id,a0,a1)           CyFxUsbUartTraceLog ((id), 2, (uint32_t)(a0), (uint32_t)(a1), 0)
+#define  CY_FX_TRACE3(id,a0,a1,a2)        CyFxUsbUartTraceLog ((id), 3, (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2))
+#else
+#define  CY_FX_TRACE0(id)
+#define  CY_FX_TRACE1(id,a0)
+#define  CY_FX_TRACE2(id,a0,a1)
+#define  CY_FX_TRACE3(id,a0,a1,a2)
+#endif
+
+/* Statistics block: Counters for each of the DMA channels, the UART error counts and a histogram of the
+   RX latency. The latency is measured from the first byte of a burst of received data until the buffer
+   holding it is committed to EP 2 IN; in the benchmark pattern mode, it is the time from the commit of
+   a generated buffer until the host has read it. Histogram bucket n counts latencies in the
+   [2^(n-1), 2^n) ms range, with bucket 0 holding latencies below 1 ms and the last bucket holding
+   all larger values. The block is read by the host through a vendor request on the debug interface. */
+#define  CY_FX_STATS_VERSION              (12)
+#define  CY_FX_STATS_CH_USBTOUART         (0)
+#define  CY_FX_STATS_CH_UARTTOUSB         (1)
+#define  CY_FX_STATS_CH_DEBUG             (2)
+#define  CY_FX_STATS_CH_PORT2             (3)
+#define  CY_FX_STATS_CH_COUNT             (4)
+#define  CY_FX_STATS_LAT_BUCKETS          (8)
+
+/* Per-channel counters. All fields are 32-bit, and are sent to the host in this order. */
+typedef struct CyFxUsbUartChStats_t
+{
+    uint32_t bytes;             /* Number of bytes transferred. */
+    uint32_t buffers;           /* Number of buffers committed by the firmware. */
+    uint32_t wrapUps;           /* Number of partial buffers wrapped up. */
+    uint32_t errors;            /* Number of DMA error notifications. */
+    uint32_t aborts;            /* Number of DMA abort notifications. */
+    uint32_t prodSusp;          /* Number of producer socket suspend notifications. */
+    uint32_t consSusp;          /* Number of consumer socket suspend notifications. */
+} CyFxUsbUartChStats_t;
+
+typedef struct CyFxUsbUartStats_t
+{
+    CyFxUsbUartChStats_t ch[CY_FX_STATS_CH_COUNT];         /* Counters for each DMA channel. */
+    uint32_t rxLatency[CY_FX_STATS_LAT_BUCKETS];            /* RX latency histogram. */
+    uint32_t uartParityErr;     /* Number of UART parity errors. */
+    uint32_t uartRxOverflow;    /* Number of UART receive FIFO overflows. */
+    uint32_t uartTxOverflow;    /* Number of UART transmit FIFO overflows. */
+    uint32_t uartOtherErr;      /* Number of other UART errors. */
+    uint32_t debugDropped;      /* Number of debug console bytes dropped. */
+    uint32_t streamFrameCommits;    /* Stream mode: Buffers committed at the end of a short frame. */
+    uint32_t streamBulkCommits;     /* Stream mode: Buffers committed when full. */
+    uint32_t streamIdleCommits;     /* Stream mode: Buffers committed when the UART receiver went idle. */
+    uint32_t streamStalls;          /* Stream mode: Times no EP 2 IN buffer was free for received data. */
+    uint32_t benchMode;             /* Benchmark mode in use (CY_FX_BENCH_MODE_*). */
+    uint32_t benchWords;            /* Benchmark pattern mode: Words received and checked. */
+    uint32_t benchErrors;           /* Benchmark pattern mode: Words that did not follow the pattern. */
+    uint32_t lineCodingChanges;     /* Number of line coding changes applied to the UART. */
+    uint32_t lineCodingSkipped;     /* Number of SET_LINE_CODING requests that changed nothing. */
+    uint32_t lineCodingDeadMs;      /* Total time the UART was unavailable for line coding changes, in ms. */
+    uint32_t lineCodingDeadMaxMs;   /* Longest time the UART was unavailable for a line coding change, in ms. */
+    uint32_t notifySent;            /* Number of SERIAL_STATE notifications sent. */
+    uint32_t errors[CY_FX_ERR_CLASS_COUNT]; /* Number of errors seen, for each CY_FX_ERR_* class. */
+    uint32_t recoverRearms;         /* Number of channels re-armed after an error. */
+    uint32_t recoverRestarts;       /* Number of application restarts done by the error recovery. */
+    uint32_t recoverMaxMs;          /* Longest time taken by a recovery action, in ms. */
+    uint32_t coalescePackets;       /* Coalescing mode: USB side buffers copied and freed. */
+    uint32_t coalesceCommits;       /* Coalescing mode: UART side buffers sent. */
+    uint32_t coalesceStalls;        /* Coalescing mode: Times no UART side buffer was free for USB data. */
+    uint32_t lpmEnables;            /* LPM: Times U1/U2 was allowed after an idle period. */
+    uint32_t lpmU0Ticks;            /* LPM: Idle timer ticks (ms) with the link seen in U0. */
+    uint32_t lpmU1Ticks;            /* LPM: Idle timer ticks (ms) with the link seen in U1. */
+    uint32_t lpmU2Ticks;            /* LPM: Idle timer ticks (ms) with the link seen in U2. */
+    uint32_t lpmU1Exits;            /* LPM: Times the link was seen back in U0 after U1. */
+    uint32_t lpmU2Exits;            /* LPM: Times the link was seen back in U0 after U2. */
+    uint32_t lpmWakeMaxMs;          /* LPM: Longest time from UART activity until the link was seen in U0, in ms. */
+    uint32_t lpmRejected;           /* LPM: U1/U2 entry requests refused while the link was kept in U0. */
+    uint32_t rxReconfigTimeouts;    /* UART to USB channel re-created before the host had read all data. */
+    uint32_t rxReconfigLostBytes;   /* Bytes dropped when the UART to USB channel was re-created. */
+    uint32_t dmaCbUnknown;          /* DMA callbacks for a channel that is not a data channel. */
+    /* The allocator usage fields are filled in from cyfxtx.c when the block is packed. */
+    uint32_t memCurBytes;           /* Heap: Bytes allocated by CyU3PMemAlloc, including block overhead. */
+    uint32_t memPeakBytes;          /* Heap: High-water mark. */
+    uint32_t memFailures;           /* Heap: Allocations that failed. */
+    uint32_t bufCurBytes;           /* DMA buffers: Bytes allocated by CyU3PDmaBufferAlloc. */
+    uint32_t bufPeakBytes;          /* DMA buffers: High-water mark. */
+    uint32_t bufFailures;           /* DMA buffers: Allocations that found no free run. */
+    uint32_t bufFreeBytes;          /* DMA buffers: Free bytes. */
+    uint32_t bufLargestFree;        /* DMA buffers: Longest free run in bytes (one cache line more than the
+                                       largest buffer that can be allocated). */
+    uint32_t bufFragPct;            /* DMA buffers: Fragmentation, 100 - (100 * longest free run / free bytes). */
+} CyFxUsbUartStats_t;
+
+/* Size of the statistics block sent to the host: A 4 byte header, the time stamp and the counters. */
+#define  CY_FX_STATS_BLOCK_SIZE           (8 + sizeof (CyFxUsbUartStats_t))
+
+/* Execution time profiler: When CY_FX_PROFILE_ENABLE is defined (make PROFILE=1), the DMA callback, the RX
+   wrap-up sequence and the EP0 request handler are timed using a free-running complex GPIO timer. The
+   minimum, maximum, average and a histogram of the execution times are kept for each site, and are read
+   by the host through a vendor request on the debug interface. Histogram bucket n counts execution times
+   in the [2^(n+SHIFT-1), 2^(n+SHIFT)) tick range, with bucket 0 holding all shorter times and the last
+   bucket all longer ones. When the profiler is disabled, the CY_FX_PROF_* macros compile to nothing. */
+#define  CY_FX_PROF_SITE_DMA_CB           (0)       /* CyFxUSBUARTDmaCallback. */
+#define  CY_FX_PROF_SITE_RX_WRAPUP        (1)       /* RX idle wrap-up sequence in the data thread. */
+#define  CY_FX_PROF_SITE_EP0              (2)       /* CyFxUSBUARTAppUSBSetupCB. */
+#define  CY_FX_PROF_SITE_LINE_CODING      (3)       /* UART dead time of a line coding change. */
+#define  CY_FX_PROF_SITE_COUNT            (4)
+
+#ifdef CY_FX_PROFILE_ENABLE
+
+#define  CY_FX_PROF_VERSION               (1)
+#define  CY_FX_PROF_TIMER_GPIO            (50)      /* Complex GPIO used as the profiling timer. Not used by the UART. */
+#define  CY_FX_PROF_TICK_HZ               (201600000)   /* Nominal timer rate: SYS_CLK (403.2 MHz) / 2. */
+#define  CY_FX_PROF_HIST_BUCKETS          (8)
+#define  CY_FX_PROF_HIST_SHIFT            (8)
+#define  CY_FX_PROF_BLOCK_SIZE            (8 + (CY_FX_PROF_SITE_COUNT * (4 + CY_FX_PROF_HIST_BUCKETS) * 4))
+
+/* Paths timed by the memory function benchmark (CY_FX_TRACE_EVT_MEM_BENCH). */
+#define  CY_FX_MEM_BENCH_SET                    (0)     /* CyU3PMemSet, aligned. */
+#define  CY_FX_MEM_BENCH_SET_UNALIGNED          (1)     /* CyU3PMemSet, unaligned. */
+#define  CY_FX_MEM_BENCH_COPY_FWD               (2)     /* CyU3PMemCopy forward, same alignment. */
+#define  CY_FX_MEM_BENCH_COPY_FWD_UNALIGNED     (3)     /* CyU3PMemCopy forward, different alignment. */
+#define  CY_FX_MEM_BENCH_COPY_BACK              (4)     /* CyU3PMemCopy backward, same alignment. */
+#define  CY_FX_MEM_BENCH_COPY_BACK_UNALIGNED    (5)     /* CyU3PMemCopy backward, different alignment. */
+#define  CY_FX_MEM_BENCH_PATH_COUNT             (6)
+
+#define  CY_FX_PROF_DECLARE(v)            uint32_t v
+#define  CY_FX_PROF_ENTER(v)              ((v) = CyFxUsbUartProfTime ())
+#define  CY_FX_PROF_EXIT(site,v)          CyFxUsbUartProfRecord ((site), (v))
+
+#else
+
+#define  CY_FX_PROF_DECLARE(v)
+#define  CY_FX_PROF_ENTER(v)
+#define  CY_FX_PROF_EXIT(site,v)
+
+#endif /* CY_FX_PROFILE_ENABLE */
+
+/* Size of the buffer used for EP0 data transfers. This has to hold the statistics block. */
+#define  CY_FX_EP0_BUFFER_SIZE            (512)
+
 /* Endpoint and socket definitions for the USB-UART application */
 
 #define CY_FX_EP_PRODUCER               0x02                             /* EP 2 OUT */
@@ -40,7 +597,7 @@
 #define CY_FX_EP_INTERRUPT              0x81                             /* EP 1 INTR */
 #define CY_FX_EP_DEBUG_INTERRUPT        0x83                             /* EP 3 INTR - Debug Comm */
 #define CY_FX_EP_DEBUG_CONSUMER         0x84                             /* EP 4 IN - Debug Data */
-#define CY_FX_EP_DEBUG_PRODUCER         0x04                             /* EP 4 OUT - Debug Data (Dummy) */
+#define CY_FX_EP_DEBUG_PRODUCER         0x04                             /* EP 4 OUT - Second port data */
 
 #define CY_FX_EP_PRODUCER1_SOCKET        CY_U3P_UIB_SOCKET_PROD_2
 #define CY_FX_EP_CONSUMER1_SOCKET        CY_U3P_LPP_SOCKET_UART_CONS    
@@ -49,6 +606,7 @@
 #define CY_FX_EP_INTR_CONSUMER1_SOCKET   CY_U3P_UIB_SOCKET_CONS_1
 #define CY_FX_EP_DEBUG_INTR_SOCKET       CY_U3P_UIB_SOCKET_CONS_3
 #define CY_FX_EP_DEBUG_CONS_SOCKET       CY_U3P_UIB_SOCKET_CONS_4
+#define CY_FX_EP_DEBUG_PROD_SOCKET       CY_U3P_UIB_SOCKET_PROD_4
 
 /* Descriptor Types */
 #define CY_FX_BOS_DSCR_TYPE             15
@@ -73,11 +631,360 @@ extern const uint8_t CyFxUSBStringLangIDDscr[];
 extern const uint8_t CyFxUSBManufactureDscr[];
 extern const uint8_t CyFxUSBProductDscr[];
 
+/* Descriptors to be registered with CyU3PUsbSetDesc, with the descriptor type (CY_U3P_USB_SET_*) and
+   index of each one. */
+typedef struct CyFxUsbUartDscr_t
+{
+    uint8_t        type;
+    uint8_t        index;
+    const uint8_t *desc;
+} CyFxUsbUartDscr_t;
+
+extern const CyFxUsbUartDscr_t CyFxUSBDscrTable[];
+extern const uint8_t           CyFxUSBDscrCount;
+
+/* Debug console functions (cyfxusbuartdebug.c). */
+extern CyU3PReturnStatus_t
+CyFxUsbUartDebugInit (
+        void);
+
+extern CyU3PReturnStatus_t
+CyFxUsbUartDebugWrite (
+        const uint8_t *data,
+        uint16_t       length);
+
 extern CyU3PReturnStatus_t
 CyFxUsbUartDebugPrint (
         const char *debugMsg
         );
 
+extern void
+CyFxUsbUartTraceLog (
+        uint8_t  eventId,
+        uint8_t  argc,
+        uint32_t arg0,
+        uint32_t arg1,
+        uint32_t arg2);
+
+extern void
+CyFxUsbUartDebugSetMode (
+        uint8_t mode);
+
+extern uint8_t
+CyFxUsbUartDebugGetMode (
+        void);
+
+extern void
+CyFxUsbUartDebugGetStats (
+        uint32_t *pending_p,
+        uint32_t *dropped_p);
+
+/* Statistics functions (cyfxusbuartstats.c). Counters are updated directly through glUsbUartStats. */
+extern CyFxUsbUartStats_t glUsbUartStats;
+
+extern void
+CyFxUsbUartStatsRxLatency (
+        uint32_t latency);
+
+extern uint16_t
+CyFxUsbUartStatsPack (
+        uint8_t        *buffer,
+        const uint32_t *liveBytes);
+
+extern void
+CyFxUsbUartStatsClear (
+        const uint32_t *liveBytes);
+
+/* Usage counters of the heap and DMA buffer allocators (cyfxtx.c). */
+extern void
+CyU3PMemGetUsage (
+        uint32_t *curBytes_p,
+        uint32_t *peakBytes_p,
+        uint32_t *failCnt_p);
+
+extern void
+CyU3PMemResetUsage (
+        void);
+
+extern void
+CyU3PBufGetUsage (
+        uint32_t *curBytes_p,
+        uint32_t *peakBytes_p,
+        uint32_t *failCnt_p);
+
+extern void
+CyU3PBufGetFreeRuns (
+        uint32_t *freeBytes_p,
+        uint32_t *largestBytes_p);
+
+extern void
+CyU3PBufResetUsage (
+        void);
+
+/* Stream mode functions (cyfxusbuartstream.c). */
+extern CyU3PReturnStatus_t
+CyFxUsbUartStreamInit (
+        void);
+
+extern void
+CyFxUsbUartStreamStart (
+        const CyFxUsbUartStreamCfg_t *cfg_p);
+
+extern CyU3PReturnStatus_t
+CyFxUsbUartStreamWrapUp (
+        CyBool_t idle);
+
+extern void
+CyFxUsbUartStreamPump (
+        void);
+
+extern CyBool_t
+CyFxUsbUartStreamFlush (
+        void);
+
+extern void
+CyFxUsbUartStreamDmaCallback (
+        CyU3PDmaChannel   *chHandle,
+        CyU3PDmaCbType_t   type,
+        CyU3PDmaCBInput_t *input);
+
+/* Second port functions (cyfxusbuartport2.c). */
+extern CyFxUsbUartLineCoding_t *
+CyFxUsbUartPort2LineCoding (
+        void);
+
+extern void
+CyFxUsbUartPort2SetSink (
+        uint8_t sink);
+
+extern void
+CyFxUsbUartPort2DmaCallback (
+        CyU3PDmaChannel   *chHandle,
+        CyU3PDmaCbType_t   type,
+        CyU3PDmaCBInput_t *input);
+
+/* Coalescing mode functions (cyfxusbuartcoalesce.c). */
+extern CyU3PReturnStatus_t
+CyFxUsbUartCoalesceChannelsCreate (
+        uint16_t bufSize);
+
+extern void
+CyFxUsbUartCoalesceStart (
+        void);
+
+/* Multiplexed mode functions (cyfxusbuartmux.c). */
+extern CyU3PReturnStatus_t
+CyFxUsbUartMuxInit (
+        void);
+
+extern CyU3PReturnStatus_t
+CyFxUsbUartMuxChannelsCreate (
+        uint16_t bufSize);
+
+extern void
+CyFxUsbUartMuxStop (
+        void);
+
+extern void
+CyFxUsbUartMuxService (
+        void);
+
+extern void
+CyFxUsbUartMuxPump (
+        void);
+
+extern void
+CyFxUsbUartMuxSetBaud (
+        uint8_t  port,
+        uint32_t baudRate);
+
+extern uint16_t
+CyFxUsbUartMuxStatus (
+        uint8_t *buffer);
+
+/* Timestamped RX stream functions (cyfxusbuartts.c). */
+extern CyU3PReturnStatus_t
+CyFxUsbUartTsInit (
+        void);
+
+extern uint32_t
+CyFxUsbUartTsTime (
+        void);
+
+extern void
+CyFxUsbUartTsSetCharTime (
+        uint32_t baudRate,
+        uint32_t bitsPerChar);
+
+extern void
+CyFxUsbUartTsStart (
+        uint32_t rxUsed);
+
+extern void
+CyFxUsbUartTsReprime (
+        uint32_t rxUsed);
+
+extern void
+CyFxUsbUartTsSample (
+        uint32_t rxUsed);
+
+extern uint16_t
+CyFxUsbUartTsFill (
+        uint8_t  *buffer,
+        uint16_t  count,
+        CyBool_t  idleEnd,
+        uint32_t  rxUsed);
+
+/* SERIAL_STATE notification functions (cyfxusbuartnotify.c). */
+extern void
+CyFxUsbUartNotifyEvent (
+        uint16_t state);
+
+extern CyBool_t
+CyFxUsbUartNotifyPending (
+        void);
+
+extern void
+CyFxUsbUartNotifySetCarrier (
+        CyBool_t active);
+
+extern void
+CyFxUsbUartNotifySetFlags (
+        uint8_t flags);
+
+extern void
+CyFxUsbUartNotifySend (
+        void);
+
+/* Link power management functions (cyfxusbuartlpm.c). */
+extern void
+CyFxUsbUartLpmStart (
+        CyBool_t superSpeed);
+
+extern void
+CyFxUsbUartLpmStop (
+        void);
+
+extern void
+CyFxUsbUartLpmSetIdle (
+        uint16_t idleMs);
+
+extern void
+CyFxUsbUartLpmActivity (
+        void);
+
+extern void
+CyFxUsbUartLpmPoll (
+        void);
+
+extern void
+CyFxUsbUartLpmApply (
+        void);
+
+extern void
+CyFxUsbUartLpmTick (
+        void);
+
+extern CyBool_t
+CyFxUsbUartLpmAccept (
+        void);
+
+/* Startup time functions (cyfxusbuartstartup.c). */
+extern void
+CyFxUsbUartStartupMark (
+        uint8_t milestone);
+
+extern void
+CyFxUsbUartStartupReport (
+        void);
+
+/* Error recovery functions (cyfxusbuartrecover.c). */
+extern void
+CyFxUsbUartRecoverStart (
+        void);
+
+extern void
+CyFxUsbUartRecoverReport (
+        uint8_t  errClass,
+        uint32_t info);
+
+extern CyBool_t
+CyFxUsbUartRecoverIsActive (
+        void);
+
+extern void
+CyFxUsbUartRecoverRun (
+        void);
+
+extern void
+CyFxUsbUartWatchdogStart (
+        void);
+
+extern void
+CyFxUsbUartWatchdogClear (
+        void);
+
+/* Benchmark pattern mode functions (cyfxusbuartbench.c). */
+extern CyU3PReturnStatus_t
+CyFxUsbUartBenchChannelsCreate (
+        uint16_t bufSize,
+        uint16_t bufCount,
+        uint8_t  pattern,
+        uint16_t rateKBps);
+
+extern void
+CyFxUsbUartBenchTick (
+        void);
+
+/* DMA callback for the data channels (cyfxusbuart.c). */
+extern void
+CyFxUSBUARTDmaCallback (
+        CyU3PDmaChannel   *chHandle,
+        CyU3PDmaCbType_t   type,
+        CyU3PDmaCBInput_t *input);
+
+extern void
+CyFxUsbUartRxLatencySample (
+        void);
+
+/* Recovery actions (cyfxusbuart.c). */
+extern CyU3PReturnStatus_t
+CyFxUsbUartChannelRearm (
+        uint8_t errClass);
+
+extern void
+CyFxUsbUartAppRestart (
+        void);
+
+#ifdef CY_FX_PROFILE_ENABLE
+/* Profiler functions (cyfxusbuartprof.c). */
+extern CyU3PReturnStatus_t
+CyFxUsbUartProfInit (
+        void);
+
+extern uint32_t
+CyFxUsbUartProfTime (
+        void);
+
+extern void
+CyFxUsbUartProfRecord (
+        uint8_t  site,
+        uint32_t start);
+
+extern void
+CyFxUsbUartMemBenchmark (
+        void);
+
+extern void
+CyFxUsbUartBufBenchmark (
+        void);
+
+extern uint16_t
+CyFxUsbUartProfPack (
+        uint8_t  *buffer,
+        CyBool_t  clear);
+#endif
+
 #include "cyu3externcend.h"
 
 #endif /* _INCLUDED_CYFXUSBUART_H_ */
@@ -0,0 +1,339 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartbench.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the pattern generator and checker of the benchmark mode (CY_FX_BENCH_MODE_PATTERN).
+   The data endpoints are connected to the CPU instead of the UART: a MANUAL_OUT channel carries the
+   generated pattern to EP 2 IN, and a MANUAL_IN channel receives the data written by the host to
+   EP 2 OUT, which is checked against the same pattern.
+
+   The pattern is a sequence of 32-bit little endian words, where each word is a fixed function of the
+   previous one: a counter, or a 32-bit Galois LFSR (PRBS). This lets the checker lock on to the data
+   from any word, and count each word that does not follow from the one before it as an error. The host
+   does not have to write whole words: bytes after the last complete word of a buffer are kept, and
+   completed by the start of the next one.
+
+   The generator commits full buffers only. The commit time of each buffer is kept until the host has
+   read it, and the time in between is added to the RX latency histogram of the statistics block. With a rate limit set, the idle timer tick adds credit at
+   the selected rate, and a buffer is only sent once enough credit has built up. Without a rate limit,
+   a buffer is filled and sent whenever the host frees one. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3dma.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+/* Feedback taps of the 32-bit PRBS: x^32 + x^22 + x^2 + x + 1. */
+#define CY_FX_BENCH_PRBS_TAPS           (0x80200003UL)
+
+/* Start value of the generated pattern. */
+#define CY_FX_BENCH_SEED                (0x00000001UL)
+
+extern CyU3PDmaChannel glChHandleUsbtoUart;     /* DMA MANUAL_IN (USB to CPU) channel handle. */
+extern CyU3PDmaChannel glChHandleUarttoUsb;     /* DMA MANUAL_OUT (CPU to USB) channel handle. */
+
+static volatile CyBool_t glBenchBusy  = CyFalse; /* Whether the generator is running. */
+static volatile CyBool_t glBenchAgain = CyFalse; /* Whether it is to run again once done. */
+static uint8_t    glBenchPattern   = CY_FX_BENCH_PATTERN_COUNTER;   /* Pattern in use. */
+static uint32_t   glBenchRate      = 0;         /* Generator rate in bytes per ms, 0 for no limit. */
+static uint32_t   glBenchCredit    = 0;         /* Number of bytes the generator may send. */
+static uint32_t   glBenchCreditMax = 0;         /* Largest credit that can be built up. */
+static uint32_t   glBenchLastTime  = 0;         /* Time of the last credit update. */
+static uint32_t   glBenchTxWord    = 0;         /* Last word generated. */
+static uint32_t   glBenchRxWord    = 0;         /* Last word received. */
+static CyBool_t   glBenchRxLocked  = CyFalse;   /* Whether glBenchRxWord is valid. */
+static uint32_t   glBenchRxPart    = 0;         /* Bytes of a word split across host transfers. */
+static uint8_t    glBenchRxPartLen = 0;         /* Number of bytes in glBenchRxPart. */
+
+/* Commit times of the generated buffers the host has not read yet. The channel has at most
+   CY_FX_USBUART_DMA_BUF_COUNT buffers, so that many slots are enough. */
+static uint32_t          glBenchTxTime[CY_FX_USBUART_DMA_BUF_COUNT];
+static volatile uint32_t glBenchTxHead = 0;     /* Number of buffers committed. */
+static volatile uint32_t glBenchTxTail = 0;     /* Number of buffers read by the host. */
+
+/* Get the pattern word that follows the given one. */
+static uint32_t
+CyFxUsbUartBenchNext (
+        uint32_t word)
+{
+    if (glBenchPattern == CY_FX_BENCH_PATTERN_PRBS)
+    {
+        return (word >> 1) ^ ((word & 1) ? CY_FX_BENCH_PRBS_TAPS : 0);
+    }
+
+    return (word + 1);
+}
+
+/* Fill and send as many pattern buffers as the free buffers and the rate limit allow. */
+static void
+CyFxUsbUartBenchFill (
+        void)
+{
+    CyU3PDmaBuffer_t dmaBuf;
+    uint32_t *word_p;
+    uint32_t  now, word;
+    uint16_t  i;
+
+    if (glBenchRate != 0)
+    {
+        now = CyU3PGetTime ();
+        glBenchCredit   = CY_U3P_MIN (glBenchCredit + (now - glBenchLastTime) * glBenchRate, glBenchCreditMax);
+        glBenchLastTime = now;
+    }
+
+    while (CyU3PDmaChannelGetBuffer (&glChHandleUarttoUsb, &dmaBuf, CYU3P_NO_WAIT) == CY_U3P_SUCCESS)
+    {
+        /* The buffer stays with the firmware until the rate limit allows it to be sent. */
+        if ((glBenchRate != 0) && (glBenchCredit < dmaBuf.size))
+        {
+            break;
+        }
+
+        word_p = (uint32_t *)dmaBuf.buffer;
+        word   = glBenchTxWord;
+        for (i = 0; i < (dmaBuf.size / sizeof (uint32_t)); i++)
+        {
+            word      = CyFxUsbUartBenchNext (word);
+            word_p[i] = word;
+        }
+        glBenchTxWord = word;
+
+        /* The slot is taken before the commit, as the host may read the buffer before this returns. */
+        glBenchTxTime[glBenchTxHead % CY_FX_USBUART_DMA_BUF_COUNT] = CyU3PGetTime ();
+        glBenchTxHead++;
+        if (CyU3PDmaChannelCommitBuffer (&glChHandleUarttoUsb, dmaBuf.size, 0) != CY_U3P_SUCCESS)
+        {
+            glBenchTxHead--;
+            glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].errors++;
+            break;
+        }
+
+        glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].bytes += dmaBuf.size;
+        glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].buffers++;
+        if (glBenchRate != 0)
+        {
+            glBenchCredit -= dmaBuf.size;
+        }
+    }
+}
+
+/* Run the generator. This is called from the DMA callback, which runs in interrupt context, and from
+   the idle timer and the application thread, so no lock can be waited for. A caller that finds the
+   generator running leaves the work to it, and has it run once more when done, so that no freed buffer
+   is missed. */
+static void
+CyFxUsbUartBenchGenerate (
+        void)
+{
+    uint32_t intMask;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    if (glBenchBusy)
+    {
+        glBenchAgain = CyTrue;
+        CyU3PVicEnableInterrupts (intMask);
+        return;
+    }
+    glBenchBusy = CyTrue;
+    CyU3PVicEnableInterrupts (intMask);
+
+    for (;;)
+    {
+        glBenchAgain = CyFalse;
+        CyFxUsbUartBenchFill ();
+
+        intMask = CyU3PVicDisableAllInterrupts ();
+        if (!glBenchAgain)
+        {
+            glBenchBusy = CyFalse;
+            CyU3PVicEnableInterrupts (intMask);
+            break;
+        }
+        CyU3PVicEnableInterrupts (intMask);
+    }
+}
+
+/* Check one word received from the host against the pattern. */
+static void
+CyFxUsbUartBenchCheckWord (
+        uint32_t word)
+{
+    if ((glBenchRxLocked) && (word != CyFxUsbUartBenchNext (glBenchRxWord)))
+    {
+        glUsbUartStats.benchErrors++;
+    }
+    glBenchRxWord   = word;
+    glBenchRxLocked = CyTrue;
+    glUsbUartStats.benchWords++;
+}
+
+/* Check a buffer received from the host against the pattern. A word left incomplete by the previous
+   buffer is completed first. The DMA buffers are word aligned, so the words that follow are read
+   directly if the buffer starts on a word boundary of the pattern, and assembled from bytes
+   otherwise. */
+static void
+CyFxUsbUartBenchCheck (
+        const CyU3PDmaBuffer_t *buf_p)
+{
+    const uint8_t *data_p = buf_p->buffer;
+    uint16_t count = buf_p->count;
+    uint16_t i = 0;
+
+    while ((glBenchRxPartLen != 0) && (i < count))
+    {
+        glBenchRxPart |= (uint32_t)data_p[i++] << (8 * glBenchRxPartLen);
+        if (++glBenchRxPartLen == sizeof (uint32_t))
+        {
+            CyFxUsbUartBenchCheckWord (glBenchRxPart);
+            glBenchRxPart    = 0;
+            glBenchRxPartLen = 0;
+        }
+    }
+
+    if ((i % sizeof (uint32_t)) == 0)
+    {
+        for (; (i + sizeof (uint32_t)) <= count; i += sizeof (uint32_t))
+        {
+            CyFxUsbUartBenchCheckWord (*(const uint32_t *)(data_p + i));
+        }
+    }
+    else
+    {
+        for (; (i + sizeof (uint32_t)) <= count; i += sizeof (uint32_t))
+        {
+            CyFxUsbUartBenchCheckWord ((uint32_t)data_p[i] | ((uint32_t)data_p[i + 1] << 8) |
+                    ((uint32_t)data_p[i + 2] << 16) | ((uint32_t)data_p[i + 3] << 24));
+        }
+    }
+
+    while (i < count)
+    {
+        glBenchRxPart |= (uint32_t)data_p[i++] << (8 * glBenchRxPartLen);
+        glBenchRxPartLen++;
+    }
+
+    glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].bytes += buf_p->count;
+    glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].buffers++;
+}
+
+/* DMA callback for both pattern mode channels. */
+static void
+CyFxUsbUartBenchDmaCallback (
+        CyU3PDmaChannel   *chHandle,
+        CyU3PDmaCbType_t   type,
+        CyU3PDmaCBInput_t *input)
+{
+    switch (type)
+    {
+        case CY_U3P_DMA_CB_PROD_EVENT:
+            CyFxUsbUartBenchCheck (&input->buffer_p);
+            CyU3PDmaChannelDiscardBuffer (chHandle);
+            break;
+
+        case CY_U3P_DMA_CB_CONS_EVENT:
+            /* The host has read the oldest buffer committed. */
+            if (glBenchTxTail != glBenchTxHead)
+            {
+                CyFxUsbUartStatsRxLatency (CyU3PGetTime () - glBenchTxTime[glBenchTxTail % CY_FX_USBUART_DMA_BUF_COUNT]);
+                glBenchTxTail++;
+            }
+            CyFxUsbUartBenchGenerate ();
+            break;
+
+        default:
+            CyFxUSBUARTDmaCallback (chHandle, type, input);
+            break;
+    }
+}
+
+/* Create and start the pattern mode channels. Both use the given buffer geometry. rateKBps is the
+   generator rate in KB/s, 0 for no limit. */
+CyU3PReturnStatus_t
+CyFxUsbUartBenchChannelsCreate (
+        uint16_t bufSize,
+        uint16_t bufCount,
+        uint8_t  pattern,
+        uint16_t rateKBps)
+{
+    CyU3PDmaChannelConfig_t dmaCfg;
+    CyU3PReturnStatus_t apiRetStatus;
+
+    glBenchPattern   = pattern;
+    glBenchRate      = ((uint32_t)rateKBps * 1024) / 1000;
+    glBenchCreditMax = (uint32_t)bufSize * bufCount;
+    glBenchCredit    = 0;
+    glBenchLastTime  = CyU3PGetTime ();
+    glBenchTxWord    = CY_FX_BENCH_SEED;
+    glBenchRxLocked  = CyFalse;
+    glBenchRxPart    = 0;
+    glBenchRxPartLen = 0;
+    glBenchTxHead    = 0;
+    glBenchTxTail    = 0;
+
+    CyU3PMemSet ((uint8_t *)&dmaCfg, 0, sizeof (dmaCfg));
+    dmaCfg.size         = bufSize;
+    dmaCfg.count        = bufCount;
+    dmaCfg.prodSckId    = CY_FX_EP_PRODUCER1_SOCKET;
+    dmaCfg.consSckId    = CY_U3P_CPU_SOCKET_CONS;
+    dmaCfg.dmaMode      = CY_U3P_DMA_MODE_BYTE;
+    dmaCfg.notification = CY_U3P_DMA_CB_PROD_EVENT | CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    dmaCfg.cb           = CyFxUsbUartBenchDmaCallback;
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUsbtoUart, CY_U3P_DMA_TYPE_MANUAL_IN, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        return apiRetStatus;
+    }
+
+    dmaCfg.prodSckId    = CY_U3P_CPU_SOCKET_PROD;
+    dmaCfg.consSckId    = CY_FX_EP_CONSUMER2_SOCKET;
+    dmaCfg.notification = CY_U3P_DMA_CB_CONS_EVENT | CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUarttoUsb, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
+        return apiRetStatus;
+    }
+
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUarttoUsb, 0);
+    if (apiRetStatus == CY_U3P_SUCCESS)
+    {
+        CyFxUsbUartBenchGenerate ();
+    }
+
+    return apiRetStatus;
+}
+
+/* Called on every idle timer tick while the pattern mode is active, to send the data allowed by the
+   rate limit. */
+void
+CyFxUsbUartBenchTick (
+        void)
+{
+    if (glBenchRate != 0)
+    {
+        CyFxUsbUartBenchGenerate ();
+    }
+}
+
+/*[]*/
+
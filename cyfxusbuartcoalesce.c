@@ -0,0 +1,272 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartcoalesce.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the coalescing mode of the USB to UART path. The host fills the buffers of a
+   MANUAL_IN channel (glChHandleUsbtoUart), one USB packet (or burst) per buffer however little data it
+   holds. The data is packed into the buffers of a MANUAL_OUT channel to the UART (glChHandleCoalesceOut),
+   and the USB side buffer is handed back to the host right away, so that a stream of small writes does
+   not run the endpoint out of buffers while the UART is still busy with earlier data.
+
+   A UART side buffer is committed:
+     - when it is full, or
+     - when the UART has no other buffer to send, so that data written while the UART is idle goes out
+       without delay.
+   Data that arrives while the UART is busy thus collects in one buffer, and goes out as soon as the UART
+   is done with the buffers before it. If no UART side buffer is free, the USB side buffers are left in
+   place until the UART has sent some data, and the endpoint is flow controlled once all of them are full.
+
+   The copy runs in the DMA callback of either channel, which runs in interrupt context. The callbacks
+   of the two channels come from different interrupts, and one can nest in the other, so the copy
+   engine is claimed through glCoalesceBusy with interrupts masked. A callback that finds it busy only
+   counts the freed UART side buffer and has the copy run again once the one in progress is done. The
+   recovery path in the application thread resets both channels before it re-initializes the copy
+   engine, with interrupts masked. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3dma.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+extern CyU3PDmaChannel glChHandleUsbtoUart;     /* DMA MANUAL_IN (USB to CPU) channel handle. */
+extern CyU3PDmaChannel glChHandleCoalesceOut;   /* DMA MANUAL_OUT (CPU to UART) channel handle. */
+
+/* State of the copy engine. */
+static CyU3PDmaBuffer_t glCoalesceOutBuf;           /* UART side buffer being filled. */
+static CyBool_t         glCoalesceOutValid = CyFalse; /* Whether glCoalesceOutBuf holds a buffer. */
+static uint16_t         glCoalesceOutFill  = 0;     /* Number of bytes in glCoalesceOutBuf. */
+static uint16_t         glCoalesceInOffset = 0;     /* Bytes already copied from the current USB side buffer. */
+static volatile uint16_t glCoalesceInFlight = 0;    /* UART side buffers committed and not yet sent. */
+static CyBool_t         glCoalesceStalled  = CyFalse; /* Whether the copy is waiting for a UART side buffer. */
+static volatile CyBool_t glCoalesceBusy    = CyFalse; /* Whether a callback is running the copy. */
+static volatile CyBool_t glCoalesceAgain   = CyFalse; /* Whether the copy is to run again once done. */
+
+/* Commit the UART side buffer being filled. The in-flight count is taken before the commit, as the
+   buffer may be sent, and counted down by a nested callback, before the commit returns. */
+static void
+CyFxUsbUartCoalesceCommit (
+        void)
+{
+    uint32_t intMask;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glCoalesceInFlight++;
+    CyU3PVicEnableInterrupts (intMask);
+
+    if (CyU3PDmaChannelCommitBuffer (&glChHandleCoalesceOut, glCoalesceOutFill, 0) == CY_U3P_SUCCESS)
+    {
+        glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].buffers++;
+        glUsbUartStats.coalesceCommits++;
+    }
+    else
+    {
+        intMask = CyU3PVicDisableAllInterrupts ();
+        glCoalesceInFlight--;
+        CyU3PVicEnableInterrupts (intMask);
+        glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].errors++;
+    }
+
+    glCoalesceOutValid = CyFalse;
+    glCoalesceOutFill  = 0;
+}
+
+/* Copy the rest of a USB side buffer into UART side buffers. Returns CyFalse if no UART side buffer was
+   free; the position reached is kept in glCoalesceInOffset. */
+static CyBool_t
+CyFxUsbUartCoalesceCopy (
+        const CyU3PDmaBuffer_t *in_p)
+{
+    uint16_t length;
+
+    while (glCoalesceInOffset < in_p->count)
+    {
+        if (!glCoalesceOutValid)
+        {
+            if (CyU3PDmaChannelGetBuffer (&glChHandleCoalesceOut, &glCoalesceOutBuf, CYU3P_NO_WAIT) != CY_U3P_SUCCESS)
+            {
+                return CyFalse;
+            }
+            glCoalesceOutValid = CyTrue;
+            glCoalesceOutFill  = 0;
+        }
+
+        length = CY_U3P_MIN (in_p->count - glCoalesceInOffset, glCoalesceOutBuf.size - glCoalesceOutFill);
+        CyU3PMemCopy (glCoalesceOutBuf.buffer + glCoalesceOutFill, in_p->buffer + glCoalesceInOffset, length);
+        glCoalesceOutFill  += length;
+        glCoalesceInOffset += length;
+
+        if (glCoalesceOutFill == glCoalesceOutBuf.size)
+        {
+            CyFxUsbUartCoalesceCommit ();
+        }
+    }
+
+    return CyTrue;
+}
+
+/* Process all USB side buffers that have been filled, oldest first, and start the UART on the data
+   collected if it has nothing else to send. */
+static void
+CyFxUsbUartCoalescePump (
+        void)
+{
+    CyU3PDmaBuffer_t inBuf;
+
+    while (CyU3PDmaChannelGetBuffer (&glChHandleUsbtoUart, &inBuf, CYU3P_NO_WAIT) == CY_U3P_SUCCESS)
+    {
+        if (!CyFxUsbUartCoalesceCopy (&inBuf))
+        {
+            if (!glCoalesceStalled)
+            {
+                glCoalesceStalled = CyTrue;
+                glUsbUartStats.coalesceStalls++;
+            }
+            break;
+        }
+
+        glCoalesceStalled  = CyFalse;
+        glCoalesceInOffset = 0;
+        glUsbUartStats.coalescePackets++;
+        CyU3PDmaChannelDiscardBuffer (&glChHandleUsbtoUart);
+    }
+
+    if ((glCoalesceInFlight == 0) && (glCoalesceOutValid) && (glCoalesceOutFill != 0))
+    {
+        CyFxUsbUartCoalesceCommit ();
+    }
+}
+
+/* Initialize the copy engine before the coalescing mode channels are (re-)started. */
+void
+CyFxUsbUartCoalesceStart (
+        void)
+{
+    uint32_t intMask;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glCoalesceOutValid = CyFalse;
+    glCoalesceOutFill  = 0;
+    glCoalesceInOffset = 0;
+    glCoalesceInFlight = 0;
+    glCoalesceStalled  = CyFalse;
+    glCoalesceBusy     = CyFalse;
+    glCoalesceAgain    = CyFalse;
+    CyU3PVicEnableInterrupts (intMask);
+}
+
+/* DMA callback for both coalescing mode channels. New USB side data and UART side buffers being freed up
+   both let the copy engine make progress. All other notifications are handled as for the other data
+   channels. */
+static void
+CyFxUsbUartCoalesceDmaCallback (
+        CyU3PDmaChannel   *chHandle,
+        CyU3PDmaCbType_t   type,
+        CyU3PDmaCBInput_t *input)
+{
+    uint32_t intMask;
+    CY_FX_PROF_DECLARE (profStart);
+
+    if ((type == CY_U3P_DMA_CB_PROD_EVENT) || (type == CY_U3P_DMA_CB_CONS_EVENT))
+    {
+        CY_FX_PROF_ENTER (profStart);
+        intMask = CyU3PVicDisableAllInterrupts ();
+        if ((type == CY_U3P_DMA_CB_CONS_EVENT) && (glCoalesceInFlight != 0))
+        {
+            glCoalesceInFlight--;
+        }
+        if (glCoalesceBusy)
+        {
+            glCoalesceAgain = CyTrue;
+            CyU3PVicEnableInterrupts (intMask);
+            return;
+        }
+        glCoalesceBusy = CyTrue;
+        CyU3PVicEnableInterrupts (intMask);
+
+        for (;;)
+        {
+            glCoalesceAgain = CyFalse;
+            CyFxUsbUartCoalescePump ();
+
+            intMask = CyU3PVicDisableAllInterrupts ();
+            if (!glCoalesceAgain)
+            {
+                glCoalesceBusy = CyFalse;
+                CyU3PVicEnableInterrupts (intMask);
+                break;
+            }
+            CyU3PVicEnableInterrupts (intMask);
+        }
+        CY_FX_PROF_EXIT (CY_FX_PROF_SITE_DMA_CB, profStart);
+        return;
+    }
+
+    CyFxUSBUARTDmaCallback (chHandle, type, input);
+}
+
+/* Create the coalescing mode channels. The USB side buffers have the given size, which holds one packet or
+   burst, and as many of them are used as the USB to UART memory budget allows. The UART side channel is
+   started right away, the USB side channel is started by the caller. */
+CyU3PReturnStatus_t
+CyFxUsbUartCoalesceChannelsCreate (
+        uint16_t bufSize)
+{
+    CyU3PDmaChannelConfig_t dmaCfg;
+    CyU3PReturnStatus_t apiRetStatus;
+
+    CyFxUsbUartCoalesceStart ();
+
+    CyU3PMemSet ((uint8_t *)&dmaCfg, 0, sizeof (dmaCfg));
+    dmaCfg.size         = bufSize;
+    dmaCfg.count        = (uint16_t)CY_U3P_MAX (2, CY_U3P_MIN (CY_FX_COALESCE_USB_BUF_COUNT,
+                (CY_FX_USBTOUART_DMA_BUDGET - CY_FX_COALESCE_UART_BUF_SIZE * CY_FX_COALESCE_UART_BUF_COUNT) / bufSize));
+    dmaCfg.prodSckId    = CY_FX_EP_PRODUCER1_SOCKET;
+    dmaCfg.consSckId    = CY_U3P_CPU_SOCKET_CONS;
+    dmaCfg.dmaMode      = CY_U3P_DMA_MODE_BYTE;
+    dmaCfg.notification = CY_U3P_DMA_CB_PROD_EVENT | CY_U3P_DMA_CB_PROD_SUSP |
+                          CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    dmaCfg.cb           = CyFxUsbUartCoalesceDmaCallback;
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUsbtoUart, CY_U3P_DMA_TYPE_MANUAL_IN, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        return apiRetStatus;
+    }
+
+    dmaCfg.size         = CY_FX_COALESCE_UART_BUF_SIZE;
+    dmaCfg.count        = CY_FX_COALESCE_UART_BUF_COUNT;
+    dmaCfg.prodSckId    = CY_U3P_CPU_SOCKET_PROD;
+    dmaCfg.consSckId    = CY_FX_EP_CONSUMER1_SOCKET;
+    dmaCfg.notification = CY_U3P_DMA_CB_CONS_EVENT | CY_U3P_DMA_CB_CONS_SUSP |
+                          CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleCoalesceOut, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
+        return apiRetStatus;
+    }
+
+    return CyU3PDmaChannelSetXfer (&glChHandleCoalesceOut, 0);
+}
+
+/*[]*/
+
@@ -0,0 +1,319 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartdebug.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the debug console of the usb-uart application. Messages and binary trace
+   records are written into a ring buffer without blocking, and a low priority thread packs them
+   into the DMA buffers of the debug interface (EP 4 IN).
+
+   Trace record format (all fields little endian):
+     Byte  0     : CY_FX_TRACE_SYNC
+     Byte  1     : Event ID (CY_FX_TRACE_EVT_*)
+     Byte  2     : Payload length in bytes
+     Byte  3     : Reserved (0)
+     Bytes 4 - 7 : Timestamp in ms (CY_FX_TRACE_TIMESTAMP)
+     Bytes 8 -   : Payload. Up to three 32-bit arguments, or the message text for CY_FX_TRACE_EVT_TEXT.
+   python_scripts/fx3_trace_decode.py decodes this format on the host. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3dma.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+extern CyU3PDmaChannel glChHandleDebug;         /* DMA MANUAL_OUT (Debug console) channel handle. */
+extern CyU3PMutex      glAppLock;               /* Lock used to serialize channel create/destroy operations. */
+extern CyBool_t        glIsApplnActive;         /* Whether the application is active or not. */
+
+#define CY_FX_DEBUG_RING_MASK   (CY_FX_DEBUG_RING_SIZE - 1)
+
+static CyU3PThread glDebugThread;               /* Thread which drains the debug ring buffer. */
+
+/* Debug ring buffer. The indices are free running, and are reduced modulo the ring size on access.
+   Writers reserve space by advancing glDbgHead, and copy their data in afterwards. glDbgCommit
+   marks the end of the data that has been completely written, and is only moved forward once all
+   writers that were in progress have finished. As writers can only pre-empt each other (thread,
+   callback or interrupt context on the same core), the last one to finish always sees all of the
+   reserved data complete. glDbgTail is only updated by the drain thread. Bytes that are dropped
+   because the ring is full are counted in glUsbUartStats.debugDropped. */
+static uint8_t           glDbgRing[CY_FX_DEBUG_RING_SIZE];
+static volatile uint32_t glDbgHead    = 0;      /* End of the reserved space. */
+static volatile uint32_t glDbgCommit  = 0;      /* End of the data available to the drain thread. */
+static volatile uint32_t glDbgTail    = 0;      /* Start of the data not yet sent to the host. */
+static volatile uint32_t glDbgWriters = 0;      /* Number of writers in progress. */
+
+static uint8_t           glDebugMode  = CY_FX_DEBUG_MODE_DEFAULT;   /* Output format of the console. */
+
+/* Copy data into the ring buffer, starting at the free running index pos. */
+static void
+CyFxUsbUartDebugRingCopy (
+        uint32_t       pos,
+        const uint8_t *data,
+        uint16_t       length)
+{
+    uint32_t offset = pos & CY_FX_DEBUG_RING_MASK;
+    uint32_t first  = CY_U3P_MIN (length, CY_FX_DEBUG_RING_SIZE - offset);
+
+    CyU3PMemCopy (glDbgRing + offset, (uint8_t *)data, first);
+    if (first < length)
+    {
+        CyU3PMemCopy (glDbgRing, (uint8_t *)data + first, length - first);
+    }
+}
+
+/* Put a record made up of a header and a data block into the ring buffer as one contiguous block.
+   This never blocks, and can be called from any context including interrupt handlers. If there is
+   not enough space in the ring buffer, the whole record is dropped and counted. */
+static CyU3PReturnStatus_t
+CyFxUsbUartDebugRingPut (
+        const uint8_t *hdr,
+        uint16_t       hdrLen,
+        const uint8_t *data,
+        uint16_t       dataLen)
+{
+    uint32_t intMask, pos, length;
+
+    length = (uint32_t)hdrLen + dataLen;
+    if (length == 0)
+    {
+        return CY_U3P_SUCCESS;
+    }
+
+    /* Reserve space in the ring. Only the index update is done with interrupts disabled; the ARM926
+       core has no exclusive load/store instructions to do this without masking. */
+    intMask = CyU3PVicDisableAllInterrupts ();
+    if ((CY_FX_DEBUG_RING_SIZE - (glDbgHead - glDbgTail)) < length)
+    {
+        glUsbUartStats.debugDropped += length;
+        CyU3PVicEnableInterrupts (intMask);
+        return CY_U3P_ERROR_QUEUE_FULL;
+    }
+    pos = glDbgHead;
+    glDbgHead = pos + length;
+    glDbgWriters++;
+    CyU3PVicEnableInterrupts (intMask);
+
+    if (hdrLen != 0)
+    {
+        CyFxUsbUartDebugRingCopy (pos, hdr, hdrLen);
+    }
+    if (dataLen != 0)
+    {
+        CyFxUsbUartDebugRingCopy (pos + hdrLen, data, dataLen);
+    }
+
+    /* Publish the data once no other writer is part-way through its block. */
+    intMask = CyU3PVicDisableAllInterrupts ();
+    if (--glDbgWriters == 0)
+    {
+        glDbgCommit = glDbgHead;
+    }
+    CyU3PVicEnableInterrupts (intMask);
+
+    return CY_U3P_SUCCESS;
+}
+
+/* Write a block of raw data to the debug console. */
+CyU3PReturnStatus_t
+CyFxUsbUartDebugWrite (
+        const uint8_t *data,
+        uint16_t       length)
+{
+    return CyFxUsbUartDebugRingPut (NULL, 0, data, length);
+}
+
+/* Function to send debug strings over the second CDC interface. In trace mode, the string is sent
+   as a CY_FX_TRACE_EVT_TEXT record, so that it can be told apart from the binary records. */
+CyU3PReturnStatus_t
+CyFxUsbUartDebugPrint (
+        const char *debugMsg
+        )
+{
+    uint32_t hdr[2];
+    uint16_t length = 0;
+
+    /* Calculate length */
+    while (debugMsg[length] != '\0')
+    {
+        length++;
+    }
+
+    if (glDebugMode == CY_FX_DEBUG_MODE_TEXT)
+    {
+        return CyFxUsbUartDebugWrite ((const uint8_t *)debugMsg, length);
+    }
+
+    length = CY_U3P_MIN (length, CY_FX_TRACE_MAX_TEXT);
+    hdr[0] = CY_FX_TRACE_SYNC | (CY_FX_TRACE_EVT_TEXT << 8) | ((uint32_t)length << 16);
+    hdr[1] = CY_FX_TRACE_TIMESTAMP ();
+    return CyFxUsbUartDebugRingPut ((const uint8_t *)hdr, sizeof (hdr), (const uint8_t *)debugMsg, length);
+}
+
+/* Log a binary trace record with up to three integer arguments. The record is only written in
+   trace mode. This is cheap enough to be used from the data path: the record is built in place
+   and copied into the ring buffer, and all formatting is left to the host side decoder. */
+void
+CyFxUsbUartTraceLog (
+        uint8_t  eventId,
+        uint8_t  argc,
+        uint32_t arg0,
+        uint32_t arg1,
+        uint32_t arg2)
+{
+    uint32_t rec[5];
+
+    if (glDebugMode != CY_FX_DEBUG_MODE_TRACE)
+    {
+        return;
+    }
+
+    rec[0] = CY_FX_TRACE_SYNC | ((uint32_t)eventId << 8) | ((uint32_t)(argc * 4) << 16);
+    rec[1] = CY_FX_TRACE_TIMESTAMP ();
+    rec[2] = arg0;
+    rec[3] = arg1;
+    rec[4] = arg2;
+    CyFxUsbUartDebugRingPut ((const uint8_t *)rec, 8 + (argc * 4), NULL, 0);
+}
+
+/* Select the debug console output format: CY_FX_DEBUG_MODE_TEXT or CY_FX_DEBUG_MODE_TRACE. */
+void
+CyFxUsbUartDebugSetMode (
+        uint8_t mode)
+{
+    glDebugMode = mode;
+}
+
+/* Get the debug console output format. */
+uint8_t
+CyFxUsbUartDebugGetMode (
+        void)
+{
+    return glDebugMode;
+}
+
+/* Get the number of bytes waiting to be sent and the number of bytes dropped so far. */
+void
+CyFxUsbUartDebugGetStats (
+        uint32_t *pending_p,
+        uint32_t *dropped_p)
+{
+    *pending_p = glDbgHead - glDbgTail;
+    *dropped_p = glUsbUartStats.debugDropped;
+}
+
+/* Move as much pending data as fits into one debug channel DMA buffer. Returns CyFalse if there
+   was nothing to send or the data could not be sent right now. */
+static CyBool_t
+CyFxUsbUartDebugDrainBuffer (
+        void)
+{
+    CyU3PDmaBuffer_t    dmaInfo;
+    CyU3PReturnStatus_t status;
+    uint32_t tail, offset, length, first;
+    CyBool_t sent = CyFalse;
+
+    if ((!glIsApplnActive) || (glDbgCommit == glDbgTail))
+    {
+        return CyFalse;
+    }
+
+    /* The lock keeps the channel from being destroyed while a buffer is being filled. The buffer is
+       not waited for, so that the lock is not held while the host is not reading. */
+    CyU3PMutexGet (&glAppLock, CYU3P_WAIT_FOREVER);
+    if (glIsApplnActive)
+    {
+        status = CyU3PDmaChannelGetBuffer (&glChHandleDebug, &dmaInfo, CYU3P_NO_WAIT);
+        if (status == CY_U3P_SUCCESS)
+        {
+            tail   = glDbgTail;
+            length = CY_U3P_MIN (glDbgCommit - tail, dmaInfo.size);
+            offset = tail & CY_FX_DEBUG_RING_MASK;
+            first  = CY_U3P_MIN (length, CY_FX_DEBUG_RING_SIZE - offset);
+
+            CyU3PMemCopy (dmaInfo.buffer, glDbgRing + offset, first);
+            if (first < length)
+            {
+                CyU3PMemCopy (dmaInfo.buffer + first, glDbgRing, length - first);
+            }
+
+            status = CyU3PDmaChannelCommitBuffer (&glChHandleDebug, length, 0);
+            if (status == CY_U3P_SUCCESS)
+            {
+                glDbgTail = tail + length;
+                glUsbUartStats.ch[CY_FX_STATS_CH_DEBUG].bytes += length;
+                glUsbUartStats.ch[CY_FX_STATS_CH_DEBUG].buffers++;
+                sent = CyTrue;
+            }
+            else
+            {
+                glUsbUartStats.ch[CY_FX_STATS_CH_DEBUG].errors++;
+            }
+        }
+    }
+    CyU3PMutexPut (&glAppLock);
+
+    return sent;
+}
+
+/* Entry function for the debug console drain thread. Messages are collected for
+   CY_FX_DEBUG_FLUSH_INTERVAL, and then sent in as few DMA buffers as possible. */
+static void
+CyFxUsbUartDebugThread_Entry (
+        uint32_t input)
+{
+    for (;;)
+    {
+        CyU3PThreadSleep (CY_FX_DEBUG_FLUSH_INTERVAL);
+
+        while (CyFxUsbUartDebugDrainBuffer ())
+            ;
+    }
+}
+
+/* Create the debug console drain thread. */
+CyU3PReturnStatus_t
+CyFxUsbUartDebugInit (
+        void)
+{
+    void *ptr = NULL;
+
+    ptr = CyU3PMemAlloc (CY_FX_DEBUG_THREAD_STACK);
+    if (ptr == NULL)
+    {
+        return CY_U3P_ERROR_MEMORY_ERROR;
+    }
+
+    return CyU3PThreadCreate (&glDebugThread,      /* Debug console thread structure */
+            "22:USBUART_debug",                     /* Thread ID and Thread name */
+            CyFxUsbUartDebugThread_Entry,           /* Debug console thread entry function */
+            0,                                      /* No input parameter to thread */
+            ptr,                                    /* Pointer to the allocated thread stack */
+            CY_FX_DEBUG_THREAD_STACK,               /* Debug console thread stack size */
+            CY_FX_DEBUG_THREAD_PRIORITY,            /* Debug console thread priority */
+            CY_FX_DEBUG_THREAD_PRIORITY,            /* Debug console thread priority */
+            CYU3P_NO_TIME_SLICE,                    /* No time slice for the thread */
+            CYU3P_AUTO_START                        /* Start the Thread immediately */
+            );
+}
+
+/*[]*/
+
@@ -204,7 +204,7 @@ const uint8_t CyFxUSBSSConfigDscr[] __attribute__ ((aligned (32))) =
     /* Super speed endpoint companion descriptor for producer ep */
     0x06,                           /* Descriptor size */
     CY_U3P_SS_EP_COMPN_DESCR,       /* SS endpoint companion descriptor type */
-    0x00,                           /* Max no. of packets in a burst : 1 */
+    (CY_FX_EP_BURST_LENGTH - 1),    /* Max no. of packets in a burst : CY_FX_EP_BURST_LENGTH */
     0x00,                           /* Mult.: Max number of packets : 1 */
     0x00,0x00,                      /* Bytes per interval : 1024 */
 
@@ -219,7 +219,7 @@ const uint8_t CyFxUSBSSConfigDscr[] __attribute__ ((aligned (32))) =
     /* Super speed endpoint companion descriptor for consumer ep */
     0x06,                           /* Descriptor size */
     CY_U3P_SS_EP_COMPN_DESCR,       /* SS endpoint companion descriptor type */
-    0x00,                           /* Max no. of packets in a burst : 1 */
+    (CY_FX_EP_BURST_LENGTH - 1),    /* Max no. of packets in a burst : CY_FX_EP_BURST_LENGTH */
     0x00,                           /* Mult.: Max number of packets : 1 */
     0x00,0x00,                      /* Bytes per interval : 1024 */
 
@@ -312,7 +312,7 @@ const uint8_t CyFxUSBSSConfigDscr[] __attribute__ ((aligned (32))) =
     0x00,                           /* Mult.: Max number of packets : 1 */
     0x00,0x00,                      /* Bytes per interval : 1024 */
 
-    /* Endpoint Descriptor(BULK-PRODUCER) (Debug Dummy) */
+    /* Endpoint Descriptor(BULK-PRODUCER) (Second port data) */
     0x07,                           /* Descriptor size */
     CY_U3P_USB_ENDPNT_DESCR,        /* Endpoint descriptor type */
     0x04,                           /* Endpoint address (EP4 OUT) */
@@ -501,7 +501,7 @@ const uint8_t CyFxUSBHSConfigDscr[] __attribute__ ((aligned (32))) =
     0x00,0x02,                      /* Max packet size = 512 bytes */
     0x00,                           /* Servicing interval */
 
-    /* Endpoint Descriptor(BULK-PRODUCER) (Debug Dummy) */
+    /* Endpoint Descriptor(BULK-PRODUCER) (Second port data) */
     0x07,                           /* Descriptor size */
     CY_U3P_USB_ENDPNT_DESCR,        /* Endpoint descriptor type */
     0x04,                           /* Endpoint address (EP4 OUT) */
@@ -724,4 +724,21 @@ const uint8_t CyFxUSBProductDscr[] __attribute__ ((aligned (32))) =
     '3',0x00
 };
 
+/* Descriptors registered at init time. */
+const CyFxUsbUartDscr_t CyFxUSBDscrTable[] =
+{
+    {CY_U3P_USB_SET_SS_DEVICE_DESCR, 0, CyFxUSB30DeviceDscr},
+    {CY_U3P_USB_SET_HS_DEVICE_DESCR, 0, CyFxUSB20DeviceDscr},
+    {CY_U3P_USB_SET_SS_BOS_DESCR,    0, CyFxUSBBOSDscr},
+    {CY_U3P_USB_SET_DEVQUAL_DESCR,   0, CyFxUSBDeviceQualDscr},
+    {CY_U3P_USB_SET_SS_CONFIG_DESCR, 0, CyFxUSBSSConfigDscr},
+    {CY_U3P_USB_SET_HS_CONFIG_DESCR, 0, CyFxUSBHSConfigDscr},
+    {CY_U3P_USB_SET_FS_CONFIG_DESCR, 0, CyFxUSBFSConfigDscr},
+    {CY_U3P_USB_SET_STRING_DESCR,    0, CyFxUSBStringLangIDDscr},
+    {CY_U3P_USB_SET_STRING_DESCR,    1, CyFxUSBManufactureDscr},
+    {CY_U3P_USB_SET_STRING_DESCR,    2, CyFxUSBProductDscr}
+};
+
+const uint8_t CyFxUSBDscrCount = sizeof (CyFxUSBDscrTable) / sizeof (CyFxUSBDscrTable[0]);
+
 /*[]*/
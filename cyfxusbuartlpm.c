@@ -0,0 +1,256 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartlpm.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the adaptive link power management policy of SuperSpeed connections.
+
+   The link is kept in U0 while data is flowing, so that the first byte of a transfer does not pay the
+   U1/U2 exit latency. Once no UART or USB traffic has been seen for the idle period, U1/U2 entry
+   requests from the host are accepted, and the link can save power while the UART line is idle:
+     - The idle timer tick reports each change of the UART receive count, so that LPM is disabled as
+       soon as RX activity starts. The link is then brought back to U0 straight away.
+     - The application thread compares the byte counts of the data channels on each wake-up, which
+       also covers the data sent by the host, and allows U1/U2 once the idle period has passed.
+       Data sent by the host is therefore only noticed when the application thread wakes up, up to
+       CY_FX_USBUART_WAKE_INTERVAL (250 ms) after it started. Until then the link may still be let
+       into U1/U2, and the idle period is counted from the wake-up rather than from the last transfer,
+       so U1/U2 can be allowed up to one wake interval late.
+   The LPM setting and the link state are only changed from the data thread, which applies the latest
+   decision. The idle timer tick reads the link state (CyU3PUsbGetLinkPowerState) for the residency
+   counters; this only reads the link status and does not change it.
+
+   The link state is sampled on each idle timer tick, and the time spent in U0, U1 and U2, as well as
+   the number of exits from U1 and U2, are counted in the statistics block. The sampling misses link
+   state changes that are shorter than a tick. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3usb.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+extern CyU3PEvent glUartAppEvent;               /* Event group used to wake up the application and data threads. */
+
+static CyBool_t          glLpmActive       = CyFalse;   /* Whether the policy runs (SuperSpeed, application active). */
+static volatile CyBool_t glLpmAllowed      = CyFalse;   /* Whether U1/U2 is to be allowed. */
+static CyBool_t          glLpmApplied      = CyFalse;   /* Whether U1/U2 is allowed by the USB driver. */
+static uint32_t          glLpmIdleMs       = CY_FX_LPM_IDLE_MS;     /* Idle period before U1/U2 is allowed. */
+static volatile uint32_t glLpmLastActivity = 0;         /* Time at which traffic was last seen. */
+static CyU3PUsbLinkPowerMode glLpmLinkState = CyU3PUsbLPM_U0;       /* Link state seen at the last tick. */
+static CyBool_t          glLpmWaking       = CyFalse;   /* Whether RX activity is waiting for the link to reach U0. */
+static uint32_t          glLpmWakeStart    = 0;         /* Time at which that RX activity was seen. */
+
+/* Start the policy when the application is started. LPM stays disabled until the link has been idle
+   for the idle period. Only SuperSpeed connections are managed. */
+void
+CyFxUsbUartLpmStart (
+        CyBool_t superSpeed)
+{
+    glLpmAllowed      = CyFalse;
+    glLpmApplied      = CyFalse;
+    glLpmLinkState    = CyU3PUsbLPM_U0;
+    glLpmWaking       = CyFalse;
+    glLpmLastActivity = CyU3PGetTime ();
+
+    if (superSpeed)
+    {
+        CyU3PUsbLPMDisable ();
+    }
+    glLpmActive = superSpeed;
+}
+
+/* Stop the policy when the application is stopped. */
+void
+CyFxUsbUartLpmStop (
+        void)
+{
+    glLpmActive  = CyFalse;
+    glLpmAllowed = CyFalse;
+}
+
+/* Set the idle period (in ms) after which U1/U2 is allowed. 0 keeps LPM disabled at all times. The
+   idle period starts afresh. */
+void
+CyFxUsbUartLpmSetIdle (
+        uint16_t idleMs)
+{
+    glLpmIdleMs = idleMs;
+    CyFxUsbUartLpmActivity ();
+}
+
+/* Record UART or USB traffic. If U1/U2 is allowed, the data thread is woken up to disable it. This can
+   be called from any context. */
+void
+CyFxUsbUartLpmActivity (
+        void)
+{
+    uint32_t intMask;
+    CyBool_t wasAllowed;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glLpmLastActivity = CyU3PGetTime ();
+    wasAllowed   = glLpmAllowed;
+    glLpmAllowed = CyFalse;
+    CyU3PVicEnableInterrupts (intMask);
+
+    if (wasAllowed)
+    {
+        if ((glLpmLinkState == CyU3PUsbLPM_U1) || (glLpmLinkState == CyU3PUsbLPM_U2))
+        {
+            glLpmWaking    = CyTrue;
+            glLpmWakeStart = glLpmLastActivity;
+        }
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_LPM, CYU3P_EVENT_OR);
+    }
+}
+
+/* Allow U1/U2 if no traffic has been seen for the idle period. This is called from the application
+   thread on each wake-up. */
+void
+CyFxUsbUartLpmPoll (
+        void)
+{
+    uint32_t intMask;
+    CyBool_t allow = CyFalse;
+
+    if ((!glLpmActive) || (glLpmIdleMs == 0) || (glLpmAllowed))
+    {
+        return;
+    }
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    if ((CyU3PGetTime () - glLpmLastActivity) >= glLpmIdleMs)
+    {
+        glLpmAllowed = CyTrue;
+        allow = CyTrue;
+    }
+    CyU3PVicEnableInterrupts (intMask);
+
+    if (allow)
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_LPM, CYU3P_EVENT_OR);
+    }
+}
+
+/* Pass the latest decision on to the USB driver. This is called from the data thread. */
+void
+CyFxUsbUartLpmApply (
+        void)
+{
+    CyU3PUsbLinkPowerMode mode;
+    CyBool_t allowed = glLpmAllowed;
+
+    if ((!glLpmActive) || (allowed == glLpmApplied))
+    {
+        return;
+    }
+
+    if (allowed)
+    {
+        CyU3PUsbLPMEnable ();
+        glUsbUartStats.lpmEnables++;
+    }
+    else
+    {
+        CyU3PUsbLPMDisable ();
+
+        /* Bring the link back to U0 now, rather than when the data is ready to go. */
+        if ((CyU3PUsbGetLinkPowerState (&mode) == CY_U3P_SUCCESS) &&
+                ((mode == CyU3PUsbLPM_U1) || (mode == CyU3PUsbLPM_U2)))
+        {
+            CyU3PUsbSetLinkPowerState (CyU3PUsbLPM_U0);
+        }
+    }
+
+    glLpmApplied = allowed;
+    CY_FX_TRACE2 (CY_FX_TRACE_EVT_LPM, allowed, glLpmLinkState);
+}
+
+/* Sample the link state for the residency counters. Called from the idle timer tick. */
+void
+CyFxUsbUartLpmTick (
+        void)
+{
+    CyU3PUsbLinkPowerMode mode;
+    uint32_t wakeMs;
+
+    if ((!glLpmActive) || (CyU3PUsbGetLinkPowerState (&mode) != CY_U3P_SUCCESS))
+    {
+        return;
+    }
+
+    switch (mode)
+    {
+        case CyU3PUsbLPM_U0:
+            glUsbUartStats.lpmU0Ticks++;
+            if (glLpmLinkState == CyU3PUsbLPM_U1)
+            {
+                glUsbUartStats.lpmU1Exits++;
+            }
+            else if (glLpmLinkState == CyU3PUsbLPM_U2)
+            {
+                glUsbUartStats.lpmU2Exits++;
+            }
+
+            if (glLpmWaking)
+            {
+                glLpmWaking = CyFalse;
+                wakeMs = CyU3PGetTime () - glLpmWakeStart;
+                if (wakeMs > glUsbUartStats.lpmWakeMaxMs)
+                {
+                    glUsbUartStats.lpmWakeMaxMs = wakeMs;
+                }
+            }
+            break;
+
+        case CyU3PUsbLPM_U1:
+            glUsbUartStats.lpmU1Ticks++;
+            break;
+
+        case CyU3PUsbLPM_U2:
+            glUsbUartStats.lpmU2Ticks++;
+            break;
+
+        default:
+            break;
+    }
+
+    glLpmLinkState = mode;
+}
+
+/* Decide on a U1/U2 entry request from the host. Requests are refused while the policy keeps the link
+   in U0, which covers the time until the data thread has disabled LPM. */
+CyBool_t
+CyFxUsbUartLpmAccept (
+        void)
+{
+    if ((glLpmActive) && (!glLpmAllowed))
+    {
+        glUsbUartStats.lpmRejected++;
+        return CyFalse;
+    }
+
+    return CyTrue;
+}
+
+/*[]*/
+
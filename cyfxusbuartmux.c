@@ -0,0 +1,900 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartmux.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the multiplexed mode of the EP 2 data path, which carries the native UART and
+   the channels of an SPI attached UART bridge as chunks with a port number (see cyfxusbuart.h).
+
+   Four channels are used:
+     - glChHandleUsbtoUart   : MANUAL_IN, EP 2 OUT to CPU. Each buffer is split into chunks, whose data
+                               is put into the transmit ring of the port, and is then handed back.
+     - glChHandleCoalesceOut : MANUAL_OUT, CPU to UART. The transmit ring of port 0 is sent from here.
+     - glChHandleUarttoUsb   : MANUAL_IN, UART to CPU. The data received is put into the receive ring
+                               of port 0; the idle flush engine wraps up partial buffers as usual.
+     - glChHandleStreamOut   : MANUAL_OUT, CPU to EP 2 IN. The receive rings are packed into these
+                               buffers.
+   The DMA callbacks run in interrupt context, and only wake up the data thread, which serves the rings
+   of the native UART. The bridge is polled over SPI by the data thread on each idle timer tick, which
+   also sends partial EP 2 IN buffers once the batch period has passed. All ring and packer work is thus
+   done in the data thread; glMuxLock keeps the application thread from stopping the mode while it is
+   going on, and is not held during SPI transfers. The bridge baud rate requests come from the setup
+   callback, and are handed over with interrupts masked. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3dma.h>
+#include <cyu3spi.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+extern CyU3PDmaChannel glChHandleUsbtoUart;     /* DMA MANUAL_IN (USB to CPU) channel handle. */
+extern CyU3PDmaChannel glChHandleCoalesceOut;   /* DMA MANUAL_OUT (CPU to UART) channel handle. */
+extern CyU3PDmaChannel glChHandleUarttoUsb;     /* DMA MANUAL_IN (UART to CPU) channel handle. */
+extern CyU3PDmaChannel glChHandleStreamOut;     /* DMA MANUAL_OUT (CPU to USB) channel handle. */
+extern CyU3PEvent      glUartAppEvent;          /* Application event group. */
+
+#define CY_FX_MUX_RING_MASK             (CY_FX_MUX_RING_SIZE - 1)
+
+/* Registers of the UART bridge, and the bits used. */
+#define CY_FX_MUX_EXP_RHR               (0x00)  /* Receive FIFO (read) and transmit FIFO (write). */
+#define CY_FX_MUX_EXP_DLL               (0x00)  /* Divisor latch, while LCR bit 7 is set. */
+#define CY_FX_MUX_EXP_DLH               (0x01)
+#define CY_FX_MUX_EXP_FCR               (0x02)
+#define CY_FX_MUX_EXP_EFR               (0x02)  /* Enhanced features, while LCR is 0xBF. */
+#define CY_FX_MUX_EXP_LCR               (0x03)
+#define CY_FX_MUX_EXP_MCR               (0x04)
+#define CY_FX_MUX_EXP_TCR               (0x06)  /* RTS halt and resume levels, while MCR bit 2 is set. */
+#define CY_FX_MUX_EXP_TXLVL             (0x08)  /* Free space in the transmit FIFO. */
+#define CY_FX_MUX_EXP_RXLVL             (0x09)  /* Bytes in the receive FIFO. */
+#define CY_FX_MUX_EXP_READ              (0x80)  /* Read flag of the register address byte. */
+
+#define CY_FX_MUX_EXP_LCR_8N1           (0x03)
+#define CY_FX_MUX_EXP_LCR_DIVISOR       (0x80)
+#define CY_FX_MUX_EXP_LCR_EFR           (0xBF)
+#define CY_FX_MUX_EXP_EFR_AUTO_FLOW     (0xD0)  /* Auto CTS, auto RTS and enhanced functions. */
+#define CY_FX_MUX_EXP_MCR_TCR           (0x04)
+#define CY_FX_MUX_EXP_TCR_LEVELS        (0x8E)  /* RTS goes inactive at 56 bytes, and active again at 32. */
+#define CY_FX_MUX_EXP_FCR_RESET         (0x07)  /* FIFOs enabled, both FIFOs reset. */
+
+/* State of each port. The rings run from the tail to the head index, which count up freely. */
+typedef struct CyFxUsbUartMuxPort_t
+{
+    uint8_t  txRing[CY_FX_MUX_RING_SIZE];   /* Data from the host, to be sent on the port. */
+    uint8_t  rxRing[CY_FX_MUX_RING_SIZE];   /* Data received on the port, to be sent to the host. */
+    uint16_t txHead;
+    uint16_t txTail;
+    uint16_t rxHead;
+    uint16_t rxTail;
+    uint16_t credit;                        /* Transmit ring space freed and not yet reported. */
+    CyBool_t rxFull;                        /* Whether the port is stalled on a full receive ring. */
+    uint32_t rxBytes;                       /* Bytes received on the port. */
+    uint32_t txBytes;                       /* Bytes sent on the port. */
+    uint32_t txDropped;                     /* Bytes from the host dropped for lack of credit. */
+    uint32_t rxStalls;                      /* Times the port was stalled on a full receive ring. */
+} CyFxUsbUartMuxPort_t;
+
+static CyFxUsbUartMuxPort_t glMuxPort[CY_FX_MUX_PORT_COUNT];
+static CyU3PMutex           glMuxLock;                  /* Lock protecting the rings and the packer. */
+static CyBool_t             glMuxActive    = CyFalse;   /* Whether the multiplexed mode channels exist. */
+
+/* State of the chunk parser for the data from the host. */
+static uint8_t              glMuxInHdr[CY_FX_MUX_HDR_SIZE];
+static uint8_t              glMuxInHdrPos  = 0;         /* Header bytes seen of the current chunk. */
+static uint8_t              glMuxInPort    = 0;         /* Port of the current chunk. */
+static uint8_t              glMuxInLeft    = 0;         /* Payload bytes left in the current chunk. */
+static CyBool_t             glMuxInSkip    = CyFalse;   /* Whether the payload is to be skipped. */
+static uint16_t             glMuxUartOffset = 0;        /* Bytes already taken from the current UART buffer. */
+
+/* State of the packer. */
+static CyU3PDmaBuffer_t     glMuxOutBuf;                /* EP 2 IN buffer being filled. */
+static CyBool_t             glMuxOutValid  = CyFalse;   /* Whether glMuxOutBuf holds a buffer. */
+static uint16_t             glMuxOutFill   = 0;         /* Number of bytes in glMuxOutBuf. */
+static uint32_t             glMuxOutStart  = 0;         /* Time at which the first chunk was added. */
+static uint8_t              glMuxNextPort  = 0;         /* Port served first in the next round. */
+
+#if (CY_FX_MUX_EXP_PORTS != 0)
+static uint32_t             glMuxExpBaud[CY_FX_MUX_EXP_PORTS];     /* Baud rate of each bridge channel. */
+static volatile uint8_t     glMuxExpBaudReq = 0;       /* Bridge channels whose baud rate is to be set. */
+#endif
+
+/* Put up to length bytes into a ring, and return the number of bytes that fitted. */
+static uint16_t
+CyFxUsbUartMuxRingPut (
+        uint8_t       *ring,
+        uint16_t      *head_p,
+        uint16_t       tail,
+        const uint8_t *data,
+        uint16_t       length)
+{
+    uint16_t offset = (*head_p) & CY_FX_MUX_RING_MASK;
+    uint16_t first;
+
+    length = CY_U3P_MIN (length, CY_FX_MUX_RING_SIZE - (uint16_t)(*head_p - tail));
+    first  = CY_U3P_MIN (length, CY_FX_MUX_RING_SIZE - offset);
+    CyU3PMemCopy (ring + offset, (uint8_t *)data, first);
+    CyU3PMemCopy (ring, (uint8_t *)data + first, length - first);
+    *head_p += length;
+
+    return length;
+}
+
+/* Take up to length bytes from a ring, and return the number of bytes taken. */
+static uint16_t
+CyFxUsbUartMuxRingGet (
+        const uint8_t *ring,
+        uint16_t       head,
+        uint16_t      *tail_p,
+        uint8_t       *data,
+        uint16_t       length)
+{
+    uint16_t offset = (*tail_p) & CY_FX_MUX_RING_MASK;
+    uint16_t first;
+
+    length = CY_U3P_MIN (length, (uint16_t)(head - *tail_p));
+    first  = CY_U3P_MIN (length, CY_FX_MUX_RING_SIZE - offset);
+    CyU3PMemCopy (data, (uint8_t *)ring + offset, first);
+    CyU3PMemCopy (data + first, (uint8_t *)ring, length - first);
+    *tail_p += length;
+
+    return length;
+}
+
+#if (CY_FX_MUX_EXP_PORTS != 0)
+
+/* Read count bytes from a register of a bridge channel. */
+static CyU3PReturnStatus_t
+CyFxUsbUartMuxExpRead (
+        uint8_t  channel,
+        uint8_t  reg,
+        uint8_t *data,
+        uint16_t count)
+{
+    uint8_t addr = CY_FX_MUX_EXP_READ | (reg << 3) | (channel << 1);
+    CyU3PReturnStatus_t status;
+
+    CyU3PSpiSetSsnLine (CyFalse);
+    status = CyU3PSpiTransferWords (&addr, 1, NULL, 0);
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyU3PSpiTransferWords (NULL, 0, data, count);
+    }
+    CyU3PSpiSetSsnLine (CyTrue);
+
+    return status;
+}
+
+/* Write count bytes to a register of a bridge channel. */
+static CyU3PReturnStatus_t
+CyFxUsbUartMuxExpWrite (
+        uint8_t        channel,
+        uint8_t        reg,
+        const uint8_t *data,
+        uint16_t       count)
+{
+    uint8_t addr = (reg << 3) | (channel << 1);
+    CyU3PReturnStatus_t status;
+
+    CyU3PSpiSetSsnLine (CyFalse);
+    status = CyU3PSpiTransferWords (&addr, 1, NULL, 0);
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyU3PSpiTransferWords ((uint8_t *)data, count, NULL, 0);
+    }
+    CyU3PSpiSetSsnLine (CyTrue);
+
+    return status;
+}
+
+/* Write a single register of a bridge channel. */
+static CyU3PReturnStatus_t
+CyFxUsbUartMuxExpSet (
+        uint8_t channel,
+        uint8_t reg,
+        uint8_t value)
+{
+    return CyFxUsbUartMuxExpWrite (channel, reg, &value, 1);
+}
+
+/* Set the baud rate of a bridge channel. The line stays at 8N1. */
+static CyU3PReturnStatus_t
+CyFxUsbUartMuxExpBaud (
+        uint8_t  channel,
+        uint32_t baudRate)
+{
+    uint32_t divisor = CY_U3P_MAX (1, CY_FX_MUX_EXP_XTAL_HZ / (16 * baudRate));
+    CyU3PReturnStatus_t status;
+
+    status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_LCR, CY_FX_MUX_EXP_LCR_DIVISOR);
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_DLL, CY_U3P_GET_LSB (divisor));
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_DLH, CY_U3P_GET_MSB (divisor));
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_LCR, CY_FX_MUX_EXP_LCR_8N1);
+    }
+
+    return status;
+}
+
+/* Set up a bridge channel: baud rate, 8N1, automatic RTS/CTS flow control and the FIFOs. */
+static CyU3PReturnStatus_t
+CyFxUsbUartMuxExpSetup (
+        uint8_t channel)
+{
+    CyU3PReturnStatus_t status;
+
+    status = CyFxUsbUartMuxExpBaud (channel, glMuxExpBaud[channel]);
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_LCR, CY_FX_MUX_EXP_LCR_EFR);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_EFR, CY_FX_MUX_EXP_EFR_AUTO_FLOW);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_LCR, CY_FX_MUX_EXP_LCR_8N1);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_MCR, CY_FX_MUX_EXP_MCR_TCR);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_TCR, CY_FX_MUX_EXP_TCR_LEVELS);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_MCR, 0);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyFxUsbUartMuxExpSet (channel, CY_FX_MUX_EXP_FCR, CY_FX_MUX_EXP_FCR_RESET);
+    }
+
+    return status;
+}
+
+/* Move data between a bridge channel and the rings of its port. Called from the data thread. */
+static void
+CyFxUsbUartMuxExpService (
+        uint8_t port)
+{
+    CyFxUsbUartMuxPort_t *port_p = &glMuxPort[port];
+    uint8_t  channel = port - 1;
+    uint8_t  data[CY_FX_MUX_EXP_FIFO_SIZE];
+    uint8_t  level;
+    uint16_t count, tail;
+    uint32_t intMask, baudRate = 0;
+    CyBool_t baudReq;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    baudReq = (CyBool_t)((glMuxExpBaudReq & (1 << channel)) != 0);
+    if (baudReq)
+    {
+        glMuxExpBaudReq &= ~(1 << channel);
+        baudRate = glMuxExpBaud[channel];
+    }
+    CyU3PVicEnableInterrupts (intMask);
+
+    if (baudReq)
+    {
+        CyFxUsbUartMuxExpBaud (channel, baudRate);
+    }
+
+    /* Receive: Only take what fits into the ring. The rest stays in the FIFO, where it stalls the
+       sender through RTS once the FIFO fills up. */
+    if (CyFxUsbUartMuxExpRead (channel, CY_FX_MUX_EXP_RXLVL, &level, 1) == CY_U3P_SUCCESS)
+    {
+        CyU3PMutexGet (&glMuxLock, CYU3P_WAIT_FOREVER);
+        count = CY_FX_MUX_RING_SIZE - (uint16_t)(port_p->rxHead - port_p->rxTail);
+        if ((level > count) && (!port_p->rxFull))
+        {
+            port_p->rxFull = CyTrue;
+            port_p->rxStalls++;
+        }
+        else if (level <= count)
+        {
+            port_p->rxFull = CyFalse;
+        }
+        CyU3PMutexPut (&glMuxLock);
+
+        count = CY_U3P_MIN (CY_U3P_MIN (count, level), CY_FX_MUX_EXP_FIFO_SIZE);
+        if ((count != 0) && (CyFxUsbUartMuxExpRead (channel, CY_FX_MUX_EXP_RHR, data, count) == CY_U3P_SUCCESS))
+        {
+            CyU3PMutexGet (&glMuxLock, CYU3P_WAIT_FOREVER);
+            CyFxUsbUartMuxRingPut (port_p->rxRing, &port_p->rxHead, port_p->rxTail, data, count);
+            port_p->rxBytes += count;
+            CyU3PMutexPut (&glMuxLock);
+        }
+    }
+
+    /* Transmit: Fill the free space of the FIFO from the ring. The data is only taken off the ring, and
+       the space given back to the host as credit, once the write has succeeded; after a failed write, it
+       is sent again on the next tick. */
+    if (CyFxUsbUartMuxExpRead (channel, CY_FX_MUX_EXP_TXLVL, &level, 1) == CY_U3P_SUCCESS)
+    {
+        CyU3PMutexGet (&glMuxLock, CYU3P_WAIT_FOREVER);
+        tail  = port_p->txTail;
+        count = CyFxUsbUartMuxRingGet (port_p->txRing, port_p->txHead, &tail, data,
+                CY_U3P_MIN (level, CY_FX_MUX_EXP_FIFO_SIZE));
+        CyU3PMutexPut (&glMuxLock);
+
+        if (count != 0)
+        {
+            if (CyFxUsbUartMuxExpWrite (channel, CY_FX_MUX_EXP_RHR, data, count) == CY_U3P_SUCCESS)
+            {
+                CyU3PMutexGet (&glMuxLock, CYU3P_WAIT_FOREVER);
+                port_p->txTail   = tail;
+                port_p->credit  += count;
+                port_p->txBytes += count;
+                CyU3PMutexPut (&glMuxLock);
+            }
+            else
+            {
+                glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].errors++;
+            }
+        }
+    }
+}
+
+#endif
+
+/* Split a buffer from the host into chunks, and put their data into the transmit rings. Chunks can span
+   buffers. Data for which the port has no room is dropped, as is anything that is not a DATA chunk for a
+   valid port. Called with glMuxLock held. */
+static void
+CyFxUsbUartMuxParse (
+        const CyU3PDmaBuffer_t *in_p)
+{
+    CyFxUsbUartMuxPort_t *port_p;
+    uint16_t pos = 0;
+    uint16_t count, put;
+
+    while (pos < in_p->count)
+    {
+        if ((glMuxInLeft == 0) || (glMuxInHdrPos != 0))
+        {
+            glMuxInHdr[glMuxInHdrPos++] = in_p->buffer[pos++];
+            if (glMuxInHdrPos < CY_FX_MUX_HDR_SIZE)
+            {
+                continue;
+            }
+
+            glMuxInHdrPos = 0;
+            glMuxInPort   = glMuxInHdr[0] & 0x0F;
+            glMuxInLeft   = glMuxInHdr[1];
+            glMuxInSkip   = (CyBool_t)(((glMuxInHdr[0] >> 4) != CY_FX_MUX_TYPE_DATA) ||
+                    (glMuxInPort >= CY_FX_MUX_PORT_COUNT));
+            if (glMuxInSkip)
+            {
+                glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].errors++;
+            }
+            continue;
+        }
+
+        count = CY_U3P_MIN (glMuxInLeft, in_p->count - pos);
+        if (!glMuxInSkip)
+        {
+            port_p = &glMuxPort[glMuxInPort];
+            put = CyFxUsbUartMuxRingPut (port_p->txRing, &port_p->txHead, port_p->txTail, in_p->buffer + pos, count);
+            port_p->txDropped += (count - put);
+        }
+        glMuxInLeft -= (uint8_t)count;
+        pos += count;
+    }
+}
+
+/* Send the transmit ring of port 0 to the UART, in as few buffers as the UART leaves free. Called with
+   glMuxLock held. */
+static void
+CyFxUsbUartMuxUartTx (
+        void)
+{
+    CyFxUsbUartMuxPort_t *port_p = &glMuxPort[0];
+    CyU3PDmaBuffer_t buf;
+    uint16_t count;
+
+    while (port_p->txHead != port_p->txTail)
+    {
+        if (CyU3PDmaChannelGetBuffer (&glChHandleCoalesceOut, &buf, CYU3P_NO_WAIT) != CY_U3P_SUCCESS)
+        {
+            break;
+        }
+
+        count = CyFxUsbUartMuxRingGet (port_p->txRing, port_p->txHead, &port_p->txTail, buf.buffer, buf.size);
+        if (CyU3PDmaChannelCommitBuffer (&glChHandleCoalesceOut, count, 0) == CY_U3P_SUCCESS)
+        {
+            glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].buffers++;
+        }
+        else
+        {
+            glUsbUartStats.ch[CY_FX_STATS_CH_USBTOUART].errors++;
+        }
+        port_p->credit  += count;
+        port_p->txBytes += count;
+    }
+}
+
+/* Move the data received by the UART into the receive ring of port 0. A buffer that does not fit is
+   left in place, which stalls the UART once all buffers are full. Called with glMuxLock held. */
+static void
+CyFxUsbUartMuxUartRx (
+        void)
+{
+    CyFxUsbUartMuxPort_t *port_p = &glMuxPort[0];
+    CyU3PDmaBuffer_t buf;
+    uint16_t count;
+
+    while (CyU3PDmaChannelGetBuffer (&glChHandleUarttoUsb, &buf, CYU3P_NO_WAIT) == CY_U3P_SUCCESS)
+    {
+        count = CyFxUsbUartMuxRingPut (port_p->rxRing, &port_p->rxHead, port_p->rxTail,
+                buf.buffer + glMuxUartOffset, buf.count - glMuxUartOffset);
+        glMuxUartOffset += count;
+        port_p->rxBytes += count;
+        if (glMuxUartOffset < buf.count)
+        {
+            if (!port_p->rxFull)
+            {
+                port_p->rxFull = CyTrue;
+                port_p->rxStalls++;
+            }
+            break;
+        }
+
+        port_p->rxFull  = CyFalse;
+        glMuxUartOffset = 0;
+        CyU3PDmaChannelDiscardBuffer (&glChHandleUarttoUsb);
+    }
+}
+
+/* Send the EP 2 IN buffer being filled. Called with glMuxLock held. */
+static void
+CyFxUsbUartMuxCommit (
+        void)
+{
+    if (CyU3PDmaChannelCommitBuffer (&glChHandleStreamOut, glMuxOutFill, 0) == CY_U3P_SUCCESS)
+    {
+        glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].buffers++;
+    }
+    else
+    {
+        glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].errors++;
+    }
+
+    CY_FX_TRACE1 (CY_FX_TRACE_EVT_RX_COMMIT, glMuxOutFill);
+    glMuxOutValid = CyFalse;
+    glMuxOutFill  = 0;
+}
+
+/* Get room for a chunk of at least CY_FX_MUX_HDR_SIZE + needed bytes in the EP 2 IN buffer, sending the
+   current buffer if it is too full. Returns the payload space, or 0 if no buffer is free. */
+static uint16_t
+CyFxUsbUartMuxRoom (
+        uint16_t needed)
+{
+    if ((glMuxOutValid) && ((glMuxOutBuf.size - glMuxOutFill) < (CY_FX_MUX_HDR_SIZE + needed)))
+    {
+        CyFxUsbUartMuxCommit ();
+    }
+
+    if (!glMuxOutValid)
+    {
+        if (CyU3PDmaChannelGetBuffer (&glChHandleStreamOut, &glMuxOutBuf, CYU3P_NO_WAIT) != CY_U3P_SUCCESS)
+        {
+            return 0;
+        }
+        glMuxOutValid = CyTrue;
+        glMuxOutFill  = 0;
+    }
+
+    if (glMuxOutFill == 0)
+    {
+        glMuxOutStart = CyU3PGetTime ();
+    }
+
+    return (glMuxOutBuf.size - glMuxOutFill - CY_FX_MUX_HDR_SIZE);
+}
+
+/* Add the chunk header for the given type, port and payload length to the EP 2 IN buffer. */
+static uint8_t *
+CyFxUsbUartMuxChunk (
+        uint8_t type,
+        uint8_t port,
+        uint8_t length)
+{
+    uint8_t *chunk_p = glMuxOutBuf.buffer + glMuxOutFill;
+
+    chunk_p[0] = (type << 4) | port;
+    chunk_p[1] = length;
+    glMuxOutFill += CY_FX_MUX_HDR_SIZE + length;
+
+    return (chunk_p + CY_FX_MUX_HDR_SIZE);
+}
+
+/* Pack the credits and the receive rings into EP 2 IN buffers. The ports are served in turn, a quantum at
+   a time, so that a busy port cannot keep the others waiting. Credits below CY_FX_MUX_CREDIT_MIN are only
+   sent if allCredits is set. Called with glMuxLock held. */
+static void
+CyFxUsbUartMuxPack (
+        CyBool_t allCredits)
+{
+    CyFxUsbUartMuxPort_t *port_p;
+    uint8_t *payload_p;
+    uint16_t room, count;
+    uint8_t  port, i;
+    CyBool_t progress;
+
+    for (port = 0; port < CY_FX_MUX_PORT_COUNT; port++)
+    {
+        port_p = &glMuxPort[port];
+        if ((port_p->credit == 0) || ((!allCredits) && (port_p->credit < CY_FX_MUX_CREDIT_MIN)))
+        {
+            continue;
+        }
+        if (CyFxUsbUartMuxRoom (2) == 0)
+        {
+            return;
+        }
+
+        payload_p = CyFxUsbUartMuxChunk (CY_FX_MUX_TYPE_CREDIT, port, 2);
+        payload_p[0] = CY_U3P_GET_LSB (port_p->credit);
+        payload_p[1] = CY_U3P_GET_MSB (port_p->credit);
+        port_p->credit = 0;
+    }
+
+    do
+    {
+        progress = CyFalse;
+        for (i = 0; i < CY_FX_MUX_PORT_COUNT; i++)
+        {
+            port   = (glMuxNextPort + i) % CY_FX_MUX_PORT_COUNT;
+            port_p = &glMuxPort[port];
+            count  = (uint16_t)(port_p->rxHead - port_p->rxTail);
+            if (count == 0)
+            {
+                continue;
+            }
+
+            room = CyFxUsbUartMuxRoom (1);
+            if (room == 0)
+            {
+                return;
+            }
+
+            count = CY_U3P_MIN (CY_U3P_MIN (count, room), CY_FX_MUX_QUANTUM);
+            payload_p = CyFxUsbUartMuxChunk (CY_FX_MUX_TYPE_DATA, port, (uint8_t)count);
+            CyFxUsbUartMuxRingGet (port_p->rxRing, port_p->rxHead, &port_p->rxTail, payload_p, count);
+            progress = CyTrue;
+        }
+        glMuxNextPort = (glMuxNextPort + 1) % CY_FX_MUX_PORT_COUNT;
+
+        /* Ring space freed up for port 0 lets the UART side buffers go. */
+        CyFxUsbUartMuxUartRx ();
+    } while (progress);
+
+    if ((glMuxOutValid) && (glMuxOutFill == glMuxOutBuf.size))
+    {
+        CyFxUsbUartMuxCommit ();
+    }
+}
+
+/* Create the lock of the multiplexed mode, and set up the UART bridge. */
+CyU3PReturnStatus_t
+CyFxUsbUartMuxInit (
+        void)
+{
+    CyU3PReturnStatus_t status;
+#if (CY_FX_MUX_EXP_PORTS != 0)
+    CyU3PSpiConfig_t spiConfig;
+    uint8_t channel;
+#endif
+
+    status = CyU3PMutexCreate (&glMuxLock, CYU3P_INHERIT);
+#if (CY_FX_MUX_EXP_PORTS != 0)
+    if (status == CY_U3P_SUCCESS)
+    {
+        status = CyU3PSpiInit ();
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        /* SPI mode 0, 8 bit words, with the slave select driven by the firmware around each access. */
+        CyU3PMemSet ((uint8_t *)&spiConfig, 0, sizeof (spiConfig));
+        spiConfig.isLsbFirst = CyFalse;
+        spiConfig.cpol       = CyFalse;
+        spiConfig.cpha       = CyFalse;
+        spiConfig.ssnPol     = CyFalse;
+        spiConfig.ssnCtrl    = CY_U3P_SPI_SSN_CTRL_FW;
+        spiConfig.leadTime   = CY_U3P_SPI_SSN_LAG_LEAD_HALF_CLK;
+        spiConfig.lagTime    = CY_U3P_SPI_SSN_LAG_LEAD_HALF_CLK;
+        spiConfig.clock      = CY_FX_MUX_EXP_SPI_CLOCK;
+        spiConfig.wordLen    = 8;
+        status = CyU3PSpiSetConfig (&spiConfig, NULL);
+    }
+
+    for (channel = 0; (channel < CY_FX_MUX_EXP_PORTS) && (status == CY_U3P_SUCCESS); channel++)
+    {
+        glMuxExpBaud[channel] = CY_FX_MUX_EXP_BAUD_DEFAULT;
+        status = CyFxUsbUartMuxExpSetup (channel);
+    }
+#endif
+
+    return status;
+}
+
+/* Set the baud rate of a bridge port (1 to CY_FX_MUX_EXP_PORTS). The data thread passes it on to the
+   bridge; until the mode is used, it is set when the mode is started. This is called from the setup
+   callback. */
+void
+CyFxUsbUartMuxSetBaud (
+        uint8_t  port,
+        uint32_t baudRate)
+{
+#if (CY_FX_MUX_EXP_PORTS != 0)
+    uint32_t intMask;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glMuxExpBaud[port - 1] = baudRate;
+    glMuxExpBaudReq |= (1 << (port - 1));
+    CyU3PVicEnableInterrupts (intMask);
+#endif
+}
+
+/* DMA callback for the multiplexed mode channels. Data from the host, UART buffers sent or received
+   and EP 2 IN buffers freed up all let the rings make progress, which is left to the data thread. All
+   other notifications are handled as for the other data channels. */
+static void
+CyFxUsbUartMuxDmaCallback (
+        CyU3PDmaChannel   *chHandle,
+        CyU3PDmaCbType_t   type,
+        CyU3PDmaCBInput_t *input)
+{
+    if ((type == CY_U3P_DMA_CB_PROD_EVENT) || (type == CY_U3P_DMA_CB_CONS_EVENT))
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_MUX_DATA, CYU3P_EVENT_OR);
+        return;
+    }
+
+    CyFxUSBUARTDmaCallback (chHandle, type, input);
+}
+
+/* Parse the data from the host, and move the data of the native UART between its DMA buffers and the
+   rings. Called from the data thread when one of the multiplexed mode channels has made progress. */
+void
+CyFxUsbUartMuxPump (
+        void)
+{
+    CyU3PDmaBuffer_t buf;
+
+    CyU3PMutexGet (&glMuxLock, CYU3P_WAIT_FOREVER);
+    if (glMuxActive)
+    {
+        while (CyU3PDmaChannelGetBuffer (&glChHandleUsbtoUart, &buf, CYU3P_NO_WAIT) == CY_U3P_SUCCESS)
+        {
+            CyFxUsbUartMuxParse (&buf);
+            CyU3PDmaChannelDiscardBuffer (&glChHandleUsbtoUart);
+        }
+
+        CyFxUsbUartMuxUartTx ();
+        CyFxUsbUartMuxUartRx ();
+        CyFxUsbUartMuxPack (CyFalse);
+    }
+    CyU3PMutexPut (&glMuxLock);
+}
+
+/* Serve the bridge ports, send all credits, and send a partial EP 2 IN buffer once its first chunk has
+   waited for the batch period. Called from the data thread on each idle timer tick. */
+void
+CyFxUsbUartMuxService (
+        void)
+{
+#if (CY_FX_MUX_EXP_PORTS != 0)
+    uint8_t port;
+#endif
+
+    if (!glMuxActive)
+    {
+        return;
+    }
+
+#if (CY_FX_MUX_EXP_PORTS != 0)
+    for (port = 1; port < CY_FX_MUX_PORT_COUNT; port++)
+    {
+        CyFxUsbUartMuxExpService (port);
+    }
+#endif
+
+    CyU3PMutexGet (&glMuxLock, CYU3P_WAIT_FOREVER);
+    CyFxUsbUartMuxUartTx ();
+    CyFxUsbUartMuxUartRx ();
+    CyFxUsbUartMuxPack (CyTrue);
+    if ((glMuxOutValid) && (glMuxOutFill != 0) && ((CyU3PGetTime () - glMuxOutStart) >= CY_FX_MUX_BATCH_MS))
+    {
+        CyFxUsbUartMuxCommit ();
+    }
+    CyU3PMutexPut (&glMuxLock);
+}
+
+/* Create the multiplexed mode channels. The EP 2 OUT buffers have the given size, which holds one packet
+   or burst. All rings start out empty, so the host has the full transmit ring size as credit on each
+   port. All channels but glChHandleUsbtoUart are started right away; that one is started by the
+   caller. */
+CyU3PReturnStatus_t
+CyFxUsbUartMuxChannelsCreate (
+        uint16_t bufSize)
+{
+    CyU3PDmaChannelConfig_t dmaCfg;
+    CyU3PReturnStatus_t apiRetStatus;
+#if (CY_FX_MUX_EXP_PORTS != 0)
+    uint8_t channel;
+#endif
+
+    CyU3PMemSet ((uint8_t *)glMuxPort, 0, sizeof (glMuxPort));
+    glMuxInHdrPos   = 0;
+    glMuxInLeft     = 0;
+    glMuxInSkip     = CyFalse;
+    glMuxUartOffset = 0;
+    glMuxOutValid   = CyFalse;
+    glMuxOutFill    = 0;
+    glMuxNextPort   = 0;
+
+#if (CY_FX_MUX_EXP_PORTS != 0)
+    /* Drop anything the bridge has received while the mode was not in use. */
+    glMuxExpBaudReq = 0;
+    for (channel = 0; channel < CY_FX_MUX_EXP_PORTS; channel++)
+    {
+        apiRetStatus = CyFxUsbUartMuxExpSetup (channel);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            return apiRetStatus;
+        }
+    }
+#endif
+
+    CyU3PMemSet ((uint8_t *)&dmaCfg, 0, sizeof (dmaCfg));
+    dmaCfg.size         = bufSize;
+    dmaCfg.count        = CY_FX_MUX_USB_OUT_BUF_COUNT;
+    dmaCfg.prodSckId    = CY_FX_EP_PRODUCER1_SOCKET;
+    dmaCfg.consSckId    = CY_U3P_CPU_SOCKET_CONS;
+    dmaCfg.dmaMode      = CY_U3P_DMA_MODE_BYTE;
+    dmaCfg.notification = CY_U3P_DMA_CB_PROD_EVENT | CY_U3P_DMA_CB_PROD_SUSP |
+                          CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    dmaCfg.cb           = CyFxUsbUartMuxDmaCallback;
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUsbtoUart, CY_U3P_DMA_TYPE_MANUAL_IN, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        return apiRetStatus;
+    }
+
+    dmaCfg.size         = CY_FX_COALESCE_UART_BUF_SIZE;
+    dmaCfg.count        = CY_FX_COALESCE_UART_BUF_COUNT;
+    dmaCfg.prodSckId    = CY_U3P_CPU_SOCKET_PROD;
+    dmaCfg.consSckId    = CY_FX_EP_CONSUMER1_SOCKET;
+    dmaCfg.notification = CY_U3P_DMA_CB_CONS_EVENT | CY_U3P_DMA_CB_CONS_SUSP |
+                          CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleCoalesceOut, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
+        return apiRetStatus;
+    }
+
+    dmaCfg.size         = CY_FX_MUX_UART_BUF_SIZE;
+    dmaCfg.count        = CY_FX_MUX_UART_BUF_COUNT;
+    dmaCfg.prodSckId    = CY_FX_EP_PRODUCER2_SOCKET;
+    dmaCfg.consSckId    = CY_U3P_CPU_SOCKET_CONS;
+    dmaCfg.notification = CY_U3P_DMA_CB_PROD_EVENT | CY_U3P_DMA_CB_PROD_SUSP |
+                          CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleUarttoUsb, CY_U3P_DMA_TYPE_MANUAL_IN, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyU3PDmaChannelDestroy (&glChHandleCoalesceOut);
+        CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
+        return apiRetStatus;
+    }
+
+    dmaCfg.size         = CY_FX_MUX_USB_BUF_SIZE;
+    dmaCfg.count        = CY_FX_MUX_USB_BUF_COUNT;
+    dmaCfg.prodSckId    = CY_U3P_CPU_SOCKET_PROD;
+    dmaCfg.consSckId    = CY_FX_EP_CONSUMER2_SOCKET;
+    dmaCfg.notification = CY_U3P_DMA_CB_CONS_EVENT | CY_U3P_DMA_CB_CONS_SUSP |
+                          CY_U3P_DMA_CB_ABORTED | CY_U3P_DMA_CB_ERROR;
+    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleStreamOut, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        CyU3PDmaChannelDestroy (&glChHandleUarttoUsb);
+        CyU3PDmaChannelDestroy (&glChHandleCoalesceOut);
+        CyU3PDmaChannelDestroy (&glChHandleUsbtoUart);
+        return apiRetStatus;
+    }
+
+    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleCoalesceOut, 0);
+    if (apiRetStatus == CY_U3P_SUCCESS)
+    {
+        apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleStreamOut, 0);
+    }
+    if (apiRetStatus == CY_U3P_SUCCESS)
+    {
+        apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleUarttoUsb, 0);
+    }
+
+    glMuxActive = (CyBool_t)(apiRetStatus == CY_U3P_SUCCESS);
+    return apiRetStatus;
+}
+
+/* Stop serving the ports before the multiplexed mode channels are destroyed. */
+void
+CyFxUsbUartMuxStop (
+        void)
+{
+    CyU3PMutexGet (&glMuxLock, CYU3P_WAIT_FOREVER);
+    glMuxActive   = CyFalse;
+    glMuxOutValid = CyFalse;
+    glMuxOutFill  = 0;
+    CyU3PMutexPut (&glMuxLock);
+}
+
+/* Pack the state of the ports for the GET_MUX_STATUS request, and return the number of bytes used:
+     Byte  0     : Number of ports (CY_FX_MUX_PORT_COUNT)
+     Byte  1     : 1 if the multiplexed mode is in use
+     Bytes 2 - 3 : Ring size, which is the credit of each port when the mode is started
+     Bytes 4 -   : For each port, the bytes received, bytes sent, bytes dropped for lack of credit and
+                   receive stalls, as 32-bit values. */
+uint16_t
+CyFxUsbUartMuxStatus (
+        uint8_t *buffer)
+{
+    uint32_t fields[4];
+    uint16_t len = 4;
+    uint8_t  port, i;
+
+    buffer[0] = CY_FX_MUX_PORT_COUNT;
+    buffer[1] = (glMuxActive) ? 1 : 0;
+    buffer[2] = CY_U3P_GET_LSB (CY_FX_MUX_RING_SIZE);
+    buffer[3] = CY_U3P_GET_MSB (CY_FX_MUX_RING_SIZE);
+
+    for (port = 0; port < CY_FX_MUX_PORT_COUNT; port++)
+    {
+        fields[0] = glMuxPort[port].rxBytes;
+        fields[1] = glMuxPort[port].txBytes;
+        fields[2] = glMuxPort[port].txDropped;
+        fields[3] = glMuxPort[port].rxStalls;
+        for (i = 0; i < 4; i++)
+        {
+            buffer[len++] = CY_U3P_DWORD_GET_BYTE0 (fields[i]);
+            buffer[len++] = CY_U3P_DWORD_GET_BYTE1 (fields[i]);
+            buffer[len++] = CY_U3P_DWORD_GET_BYTE2 (fields[i]);
+            buffer[len++] = CY_U3P_DWORD_GET_BYTE3 (fields[i]);
+        }
+    }
+
+    return len;
+}
+
+/*[]*/
+
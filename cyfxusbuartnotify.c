@@ -0,0 +1,148 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartnotify.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the CDC SERIAL_STATE notifications of the UART port, which are sent on the
+   interrupt endpoint (EP 1 IN) through a MANUAL_OUT channel (glChHandleNotify).
+
+   Events are collected from any context into a pending bit mask. The idle timer tick wakes up the
+   data thread when there is something to send, and the thread sends one notification holding
+   all events collected since the last one. A burst of errors thus results in at most one notification
+   per tick. If the host has not yet read the previous notification, the events are kept and sent with
+   the next one.
+
+   The carrier bits (DCD and DSR) report the state of the bridge: they are set while the application is
+   active. The error bits (framing, parity, overrun and break) are one-shot, and are cleared once
+   they have been sent. The data available hint is vendor specific, and is only set when enabled. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3dma.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+extern CyU3PDmaChannel glChHandleNotify;        /* DMA MANUAL_OUT (SERIAL_STATE notifications) channel handle. */
+
+#define CY_FX_NOTIFY_SERIAL_STATE       (0x20)  /* CDC SERIAL_STATE notification code. */
+#define CY_FX_NOTIFY_SIZE               (10)    /* Notification header and the 2 byte UART state. */
+
+static volatile uint16_t glNotifyPending = 0;   /* One-shot events not sent yet. */
+static uint16_t glNotifyCarrier = 0;            /* Current state of the carrier bits. */
+static uint16_t glNotifyLast    = 0;            /* Carrier bits in the last notification sent. */
+static uint8_t  glNotifyFlags   = CY_FX_NOTIFY_ENABLE;  /* CY_FX_NOTIFY_* enable flags. */
+
+/* Record one or more SERIAL_STATE events. This can be called from any context. */
+void
+CyFxUsbUartNotifyEvent (
+        uint16_t state)
+{
+    uint32_t intMask;
+
+    if ((state & CY_FX_SERIAL_STATE_DATA_AVAIL) && ((glNotifyFlags & CY_FX_NOTIFY_DATA_HINT) == 0))
+    {
+        state &= ~CY_FX_SERIAL_STATE_DATA_AVAIL;
+    }
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glNotifyPending |= state;
+    CyU3PVicEnableInterrupts (intMask);
+}
+
+/* Check whether a notification needs to be sent. Called from the idle timer tick. */
+CyBool_t
+CyFxUsbUartNotifyPending (
+        void)
+{
+    return (CyBool_t)(((glNotifyFlags & CY_FX_NOTIFY_ENABLE) != 0) &&
+            ((glNotifyPending != 0) || (glNotifyCarrier != glNotifyLast)));
+}
+
+/* Set the carrier bits reported to the host. */
+void
+CyFxUsbUartNotifySetCarrier (
+        CyBool_t active)
+{
+    glNotifyCarrier = (active) ? (CY_FX_SERIAL_STATE_DCD | CY_FX_SERIAL_STATE_DSR) : 0;
+    if (!active)
+    {
+        /* The channel is reset when the application stops, and the host sees the carrier bits again
+           after the next start. */
+        glNotifyLast    = 0;
+        glNotifyPending = 0;
+    }
+}
+
+/* Select which notifications are sent: a combination of the CY_FX_NOTIFY_* flags. */
+void
+CyFxUsbUartNotifySetFlags (
+        uint8_t flags)
+{
+    glNotifyFlags = flags;
+}
+
+/* Send all events collected so far in one SERIAL_STATE notification. This is called from the
+   data thread. */
+void
+CyFxUsbUartNotifySend (
+        void)
+{
+    CyU3PDmaBuffer_t dmaBuf;
+    uint32_t intMask;
+    uint16_t state;
+
+    if (!CyFxUsbUartNotifyPending ())
+    {
+        return;
+    }
+
+    /* Keep the events until the host has read the previous notification. */
+    if (CyU3PDmaChannelGetBuffer (&glChHandleNotify, &dmaBuf, CYU3P_NO_WAIT) != CY_U3P_SUCCESS)
+    {
+        return;
+    }
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    state = glNotifyPending;
+    glNotifyPending = 0;
+    CyU3PVicEnableInterrupts (intMask);
+    state |= glNotifyCarrier;
+
+    dmaBuf.buffer[0] = 0xA1;                    /* Class specific, interface, device to host. */
+    dmaBuf.buffer[1] = CY_FX_NOTIFY_SERIAL_STATE;
+    dmaBuf.buffer[2] = 0;                       /* wValue */
+    dmaBuf.buffer[3] = 0;
+    dmaBuf.buffer[4] = 0;                       /* wIndex: Communication interface of the UART port. */
+    dmaBuf.buffer[5] = 0;
+    dmaBuf.buffer[6] = 2;                       /* wLength */
+    dmaBuf.buffer[7] = 0;
+    dmaBuf.buffer[8] = CY_U3P_GET_LSB (state);
+    dmaBuf.buffer[9] = CY_U3P_GET_MSB (state);
+
+    if (CyU3PDmaChannelCommitBuffer (&glChHandleNotify, CY_FX_NOTIFY_SIZE, 0) == CY_U3P_SUCCESS)
+    {
+        glNotifyLast = glNotifyCarrier;
+        glUsbUartStats.notifySent++;
+    }
+}
+
+/*[]*/
+
@@ -0,0 +1,110 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartport2.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the data sink of the second CDC port (interfaces 2 and 3). Data written by the
+   host to EP 4 OUT is received through a MANUAL_IN channel (glChHandlePort2), counted, and then either
+   dropped or echoed back to the host through the debug console ring buffer on EP 4 IN. The echo is
+   only done while the console is in text mode, where it is interleaved with the log messages; in trace
+   mode, the raw bytes would corrupt the record stream, and the data is dropped instead. The port keeps
+   its own line coding, which is stored and reported back to the host; the FX3 has a single UART, so it
+   does not change any hardware setting. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3dma.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+extern CyU3PDmaChannel glChHandlePort2;         /* DMA MANUAL_IN (EP 4 OUT to CPU) channel handle. */
+
+static uint8_t glPort2Sink = CY_FX_PORT2_SINK_DISCARD;         /* What is done with the received data. */
+
+/* Line coding of the second port. Defaults to 115200 8N1. */
+static CyFxUsbUartLineCoding_t glPort2LineCoding __attribute__ ((aligned (32))) = {115200, 0, 0, 8};
+
+/* Get the line coding of the second port. It is only stored: SET_LINE_CODING overwrites it, and
+   GET_LINE_CODING sends it as it is. */
+CyFxUsbUartLineCoding_t *
+CyFxUsbUartPort2LineCoding (
+        void)
+{
+    return &glPort2LineCoding;
+}
+
+/* Select what is done with the data received on the second port: CY_FX_PORT2_SINK_DISCARD or
+   CY_FX_PORT2_SINK_ECHO. The caller checks that the echo is not selected in trace mode. */
+void
+CyFxUsbUartPort2SetSink (
+        uint8_t sink)
+{
+    glPort2Sink = sink;
+}
+
+/* DMA callback for the second port. Each buffer received from the host is counted and passed to the
+   selected sink, and is then handed back to the channel. */
+void
+CyFxUsbUartPort2DmaCallback (
+        CyU3PDmaChannel   *chHandle,
+        CyU3PDmaCbType_t   type,
+        CyU3PDmaCBInput_t *input)
+{
+    CyFxUsbUartChStats_t *stats_p = &glUsbUartStats.ch[CY_FX_STATS_CH_PORT2];
+
+    switch (type)
+    {
+        case CY_U3P_DMA_CB_PROD_EVENT:
+            stats_p->bytes += input->buffer_p.count;
+            stats_p->buffers++;
+
+            /* Echoed data that does not fit into the debug ring buffer is counted as dropped there. The
+               console may have been switched to trace mode since the echo was selected. */
+            if ((glPort2Sink == CY_FX_PORT2_SINK_ECHO) && (CyFxUsbUartDebugGetMode () == CY_FX_DEBUG_MODE_TEXT))
+            {
+                CyFxUsbUartDebugWrite (input->buffer_p.buffer, input->buffer_p.count);
+            }
+
+            if (CyU3PDmaChannelDiscardBuffer (chHandle) != CY_U3P_SUCCESS)
+            {
+                stats_p->errors++;
+            }
+            break;
+
+        case CY_U3P_DMA_CB_ERROR:
+            stats_p->errors++;
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
+            CyFxUsbUartRecoverReport (CY_FX_ERR_PORT2, type);
+            break;
+
+        case CY_U3P_DMA_CB_ABORTED:
+            stats_p->aborts++;
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
+            break;
+
+        default:
+            CY_FX_TRACE1 (CY_FX_TRACE_EVT_DMA_CB, type);
+            break;
+    }
+}
+
+/*[]*/
+
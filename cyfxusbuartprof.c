@@ -0,0 +1,380 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartprof.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the execution time profiler of the usb-uart application. The ARM926 core
+   has no cycle counter, so one of the complex GPIOs is configured as a free-running timer clocked
+   from the fast GPIO clock, and is sampled on entry to and exit from each instrumented site. The
+   GPIO pin itself is not driven. The profiler is only built when CY_FX_PROFILE_ENABLE is defined.
+
+   Block format (all fields little endian):
+     Byte  0     : CY_FX_PROF_VERSION
+     Byte  1     : Number of sites (CY_FX_PROF_SITE_COUNT)
+     Byte  2     : Number of histogram buckets (CY_FX_PROF_HIST_BUCKETS)
+     Byte  3     : CY_FX_PROF_HIST_SHIFT
+     Bytes 4 - 7 : Timer frequency in Hz (CY_FX_PROF_TICK_HZ)
+     Bytes 8 -   : For each site: count, min, max, average and the histogram buckets, as 32-bit
+                   values in timer ticks. */
+
+#ifdef CY_FX_PROFILE_ENABLE
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3gpio.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+/* Execution time statistics for one site. */
+typedef struct CyFxUsbUartProfSite_t
+{
+    uint32_t count;                             /* Number of samples. */
+    uint32_t min;                               /* Shortest execution time. */
+    uint32_t max;                               /* Longest execution time. */
+    uint64_t sum;                               /* Total execution time. */
+    uint32_t hist[CY_FX_PROF_HIST_BUCKETS];     /* Execution time histogram. */
+} CyFxUsbUartProfSite_t;
+
+static CyFxUsbUartProfSite_t glProfSite[CY_FX_PROF_SITE_COUNT];
+static uint32_t              glProfOverhead = 0;    /* Cost of one pair of timer samples. */
+static CyBool_t              glProfReady    = CyFalse;
+
+/* Reset the statistics for all sites. */
+static void
+CyFxUsbUartProfReset (
+        void)
+{
+    uint8_t i;
+
+    CyU3PMemSet ((uint8_t *)glProfSite, 0, sizeof (glProfSite));
+    for (i = 0; i < CY_FX_PROF_SITE_COUNT; i++)
+    {
+        glProfSite[i].min = 0xFFFFFFFF;
+    }
+}
+
+/* Get the current value of the profiling timer. */
+uint32_t
+CyFxUsbUartProfTime (
+        void)
+{
+    uint32_t value = 0;
+
+    CyU3PGpioComplexSampleNow (CY_FX_PROF_TIMER_GPIO, &value);
+    return value;
+}
+
+/* Record the execution time of a site, given the timer value sampled on entry. */
+void
+CyFxUsbUartProfRecord (
+        uint8_t  site,
+        uint32_t start)
+{
+    CyFxUsbUartProfSite_t *site_p = &glProfSite[site];
+    uint32_t ticks, bucket;
+
+    if (!glProfReady)
+    {
+        return;
+    }
+
+    /* The timer counts up and wraps around, so the unsigned difference is always correct. */
+    ticks = CyFxUsbUartProfTime () - start;
+    ticks = (ticks > glProfOverhead) ? (ticks - glProfOverhead) : 0;
+
+    site_p->count++;
+    site_p->sum += ticks;
+    if (ticks < site_p->min)
+    {
+        site_p->min = ticks;
+    }
+    if (ticks > site_p->max)
+    {
+        site_p->max = ticks;
+    }
+
+    bucket = 0;
+    ticks >>= (CY_FX_PROF_HIST_SHIFT - 1);
+    while ((ticks > 1) && (bucket < (CY_FX_PROF_HIST_BUCKETS - 1)))
+    {
+        ticks >>= 1;
+        bucket++;
+    }
+    site_p->hist[bucket]++;
+}
+
+/* Pack the profiling results into the buffer provided, and return the number of bytes used.
+   The results are cleared after reading if clear is set. */
+uint16_t
+CyFxUsbUartProfPack (
+        uint8_t  *buffer,
+        CyBool_t  clear)
+{
+    CyFxUsbUartProfSite_t *site_p;
+    uint32_t values[4 + CY_FX_PROF_HIST_BUCKETS];
+    uint8_t  i, j;
+
+    buffer[0] = CY_FX_PROF_VERSION;
+    buffer[1] = CY_FX_PROF_SITE_COUNT;
+    buffer[2] = CY_FX_PROF_HIST_BUCKETS;
+    buffer[3] = CY_FX_PROF_HIST_SHIFT;
+    buffer[4] = CY_U3P_DWORD_GET_BYTE0 (CY_FX_PROF_TICK_HZ);
+    buffer[5] = CY_U3P_DWORD_GET_BYTE1 (CY_FX_PROF_TICK_HZ);
+    buffer[6] = CY_U3P_DWORD_GET_BYTE2 (CY_FX_PROF_TICK_HZ);
+    buffer[7] = CY_U3P_DWORD_GET_BYTE3 (CY_FX_PROF_TICK_HZ);
+    buffer += 8;
+
+    for (i = 0; i < CY_FX_PROF_SITE_COUNT; i++)
+    {
+        site_p = &glProfSite[i];
+        values[0] = site_p->count;
+        values[1] = (site_p->count != 0) ? site_p->min : 0;
+        values[2] = site_p->max;
+        values[3] = (site_p->count != 0) ? (uint32_t)(site_p->sum / site_p->count) : 0;
+        CyU3PMemCopy ((uint8_t *)&values[4], (uint8_t *)site_p->hist, sizeof (site_p->hist));
+
+        for (j = 0; j < (4 + CY_FX_PROF_HIST_BUCKETS); j++)
+        {
+            buffer[0] = CY_U3P_DWORD_GET_BYTE0 (values[j]);
+            buffer[1] = CY_U3P_DWORD_GET_BYTE1 (values[j]);
+            buffer[2] = CY_U3P_DWORD_GET_BYTE2 (values[j]);
+            buffer[3] = CY_U3P_DWORD_GET_BYTE3 (values[j]);
+            buffer += 4;
+        }
+    }
+
+    if (clear)
+    {
+        CyFxUsbUartProfReset ();
+    }
+
+    return CY_FX_PROF_BLOCK_SIZE;
+}
+
+/* Start the profiling timer, and measure the cost of taking the timer samples so that it can be
+   subtracted from each measurement. */
+CyU3PReturnStatus_t
+CyFxUsbUartProfInit (
+        void)
+{
+    CyU3PGpioClock_t         gpioClock;
+    CyU3PGpioComplexConfig_t gpioConfig;
+    CyU3PReturnStatus_t      apiRetStatus;
+    uint32_t start, ticks;
+    uint8_t  i;
+
+    /* Fast GPIO clock = SYS_CLK / 2, which runs at the CPU clock rate. The slow GPIO clock drives the
+       timestamp timer (cyfxusbuartts.c), which leaves the GPIO clock set up to the profiler. */
+    CyU3PMemSet ((uint8_t *)&gpioClock, 0, sizeof (gpioClock));
+    gpioClock.fastClkDiv = 2;
+    gpioClock.slowClkDiv = CY_FX_RX_TS_SLOW_CLK_DIV;
+    gpioClock.simpleDiv  = CY_U3P_GPIO_SIMPLE_DIV_BY_2;
+    gpioClock.clkSrc     = CY_U3P_SYS_CLK;
+    gpioClock.halfDiv    = 0;
+
+    apiRetStatus = CyU3PGpioInit (&gpioClock, NULL);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        return apiRetStatus;
+    }
+
+    CyU3PMemSet ((uint8_t *)&gpioConfig, 0, sizeof (gpioConfig));
+    gpioConfig.outValue    = CyFalse;
+    gpioConfig.inputEn     = CyFalse;
+    gpioConfig.driveLowEn  = CyFalse;
+    gpioConfig.driveHighEn = CyFalse;
+    gpioConfig.pinMode     = CY_U3P_GPIO_MODE_STATIC;
+    gpioConfig.intrMode    = CY_U3P_GPIO_NO_INTR;
+    gpioConfig.timerMode   = CY_U3P_GPIO_TIMER_HIGH_FREQ;
+    gpioConfig.timer       = 0;
+    gpioConfig.period      = 0xFFFFFFFF;
+    gpioConfig.threshold   = 0xFFFFFFFF;
+
+    apiRetStatus = CyU3PGpioSetComplexConfig (CY_FX_PROF_TIMER_GPIO, &gpioConfig);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        return apiRetStatus;
+    }
+
+    /* Use the smallest cost seen over a few back to back samples. */
+    glProfOverhead = 0xFFFFFFFF;
+    for (i = 0; i < 8; i++)
+    {
+        start = CyFxUsbUartProfTime ();
+        ticks = CyFxUsbUartProfTime () - start;
+        if (ticks < glProfOverhead)
+        {
+            glProfOverhead = ticks;
+        }
+    }
+
+    CyFxUsbUartProfReset ();
+    glProfReady = CyTrue;
+
+    return CY_U3P_SUCCESS;
+}
+
+/* Benchmark of the CyU3PMemSet and CyU3PMemCopy paths in cyfxtx.c. Each path is timed for a few
+   block sizes, and the best of CY_FX_MEM_BENCH_RUNS runs is logged as a CY_FX_TRACE_EVT_MEM_BENCH
+   trace record. The timer runs at the CPU clock rate, so the host decoder reports the results
+   directly as cycles per byte. */
+#define CY_FX_MEM_BENCH_MAX_SIZE        (1024)
+#define CY_FX_MEM_BENCH_RUNS            (4)
+
+static const uint16_t glMemBenchSize[] = {16, 64, 256, CY_FX_MEM_BENCH_MAX_SIZE};
+
+void
+CyFxUsbUartMemBenchmark (
+        void)
+{
+    uint8_t  *buf_p, *src_p, *dst_p;
+    uint32_t  start, ticks, best;
+    uint16_t  size;
+    uint8_t   path, i, run;
+
+    /* Two blocks of the maximum size, with some slack for the unaligned cases. */
+    buf_p = (uint8_t *)CyU3PMemAlloc ((2 * CY_FX_MEM_BENCH_MAX_SIZE) + 16);
+    if (buf_p == NULL)
+    {
+        return;
+    }
+
+    for (path = 0; path < CY_FX_MEM_BENCH_PATH_COUNT; path++)
+    {
+        for (i = 0; i < (sizeof (glMemBenchSize) / sizeof (glMemBenchSize[0])); i++)
+        {
+            size = glMemBenchSize[i];
+            best = 0xFFFFFFFF;
+
+            /* CyU3PMemCopy copies backward when the destination is above the source. The forward
+               copies therefore have the destination in the lower block and the source in the upper
+               block, and the backward copies the other way round. The unaligned cases offset the
+               destination by one byte. */
+            src_p = buf_p;
+            dst_p = buf_p + CY_FX_MEM_BENCH_MAX_SIZE + 8;
+            if ((path == CY_FX_MEM_BENCH_COPY_FWD) || (path == CY_FX_MEM_BENCH_COPY_FWD_UNALIGNED))
+            {
+                src_p = dst_p;
+                dst_p = buf_p;
+            }
+            if ((path == CY_FX_MEM_BENCH_SET_UNALIGNED) || (path == CY_FX_MEM_BENCH_COPY_FWD_UNALIGNED) ||
+                    (path == CY_FX_MEM_BENCH_COPY_BACK_UNALIGNED))
+            {
+                dst_p++;
+            }
+
+            for (run = 0; run < CY_FX_MEM_BENCH_RUNS; run++)
+            {
+                start = CyFxUsbUartProfTime ();
+                if ((path == CY_FX_MEM_BENCH_SET) || (path == CY_FX_MEM_BENCH_SET_UNALIGNED))
+                {
+                    CyU3PMemSet (dst_p, 0x5A, size);
+                }
+                else
+                {
+                    CyU3PMemCopy (dst_p, src_p, size);
+                }
+                ticks = CyFxUsbUartProfTime () - start;
+                ticks = (ticks > glProfOverhead) ? (ticks - glProfOverhead) : 0;
+                best  = CY_U3P_MIN (best, ticks);
+            }
+
+            CY_FX_TRACE3 (CY_FX_TRACE_EVT_MEM_BENCH, path, size, best);
+        }
+    }
+
+    CyU3PMemFree (buf_p);
+}
+
+/* Benchmark of the CyU3PDmaBufferAlloc and CyU3PDmaBufferFree paths in cyfxtx.c. The start of the
+   buffer heap is first fragmented with small buffers of which every other one is freed, so that the
+   allocator has to search past a run of holes that are too small for the request. The best of
+   CY_FX_MEM_BENCH_RUNS runs for each size is logged as a CY_FX_TRACE_EVT_BUF_BENCH trace record. */
+#define CY_FX_BUF_BENCH_FILL_COUNT      (128)
+#define CY_FX_BUF_BENCH_FILL_SIZE       (32)
+
+static const uint16_t glBufBenchSize[] = {32, 128, 512, 1024};
+static void          *glBufBenchFill[CY_FX_BUF_BENCH_FILL_COUNT];
+
+void
+CyFxUsbUartBufBenchmark (
+        void)
+{
+    uint8_t  *buf_p;
+    uint32_t  start, ticks, bestAlloc, bestFree;
+    uint16_t  i;
+    uint8_t   run;
+
+    /* Fragment the heap. */
+    for (i = 0; i < CY_FX_BUF_BENCH_FILL_COUNT; i++)
+    {
+        glBufBenchFill[i] = CyU3PDmaBufferAlloc (CY_FX_BUF_BENCH_FILL_SIZE);
+    }
+    for (i = 0; i < CY_FX_BUF_BENCH_FILL_COUNT; i += 2)
+    {
+        if (glBufBenchFill[i] != NULL)
+        {
+            CyU3PDmaBufferFree (glBufBenchFill[i]);
+            glBufBenchFill[i] = NULL;
+        }
+    }
+
+    for (i = 0; i < (sizeof (glBufBenchSize) / sizeof (glBufBenchSize[0])); i++)
+    {
+        bestAlloc = 0xFFFFFFFF;
+        bestFree  = 0xFFFFFFFF;
+
+        for (run = 0; run < CY_FX_MEM_BENCH_RUNS; run++)
+        {
+            start = CyFxUsbUartProfTime ();
+            buf_p = (uint8_t *)CyU3PDmaBufferAlloc (glBufBenchSize[i]);
+            ticks = CyFxUsbUartProfTime () - start;
+            if (buf_p == NULL)
+            {
+                break;
+            }
+            ticks     = (ticks > glProfOverhead) ? (ticks - glProfOverhead) : 0;
+            bestAlloc = CY_U3P_MIN (bestAlloc, ticks);
+
+            start = CyFxUsbUartProfTime ();
+            CyU3PDmaBufferFree (buf_p);
+            ticks    = CyFxUsbUartProfTime () - start;
+            ticks    = (ticks > glProfOverhead) ? (ticks - glProfOverhead) : 0;
+            bestFree = CY_U3P_MIN (bestFree, ticks);
+        }
+
+        CY_FX_TRACE3 (CY_FX_TRACE_EVT_BUF_BENCH, glBufBenchSize[i], bestAlloc, bestFree);
+    }
+
+    for (i = 1; i < CY_FX_BUF_BENCH_FILL_COUNT; i += 2)
+    {
+        if (glBufBenchFill[i] != NULL)
+        {
+            CyU3PDmaBufferFree (glBufBenchFill[i]);
+            glBufBenchFill[i] = NULL;
+        }
+    }
+}
+
+#endif /* CY_FX_PROFILE_ENABLE */
+
+/*[]*/
+
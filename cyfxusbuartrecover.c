@@ -0,0 +1,230 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartrecover.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the error recovery engine and the watchdog of the application thread.
+
+   Errors are reported from the DMA callbacks, the EP0 handler and CyFxAppErrorHandler, and are counted
+   by class in the statistics block. The report only records the recovery action needed, and wakes up
+   the application thread, which carries it out:
+     - A DMA error re-arms the channel it was seen on (CyFxUsbUartChannelRearm). The other channels
+       keep running.
+     - A failed API call restarts the application (CyFxUsbUartAppRestart).
+     - An EP0 error needs no action, the request is stalled and the next SETUP packet starts afresh.
+   The DMA and API errors count towards the restart threshold, so that a channel that keeps failing
+   leads to a restart of the application. Restarts that follow each other too quickly lead to a device
+   reset. EP0 errors are mostly caused by the host, with bad or aborted requests, which a restart would
+   not cure; they are only counted in the statistics block, so that a host cannot get the device reset
+   by sending bad requests.
+
+   Before the application thread is running, there is nothing to recover with. CyFxAppErrorHandler then
+   stops as before, and the watchdog resets the device. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3dma.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+extern CyU3PEvent glUartAppEvent;               /* Event group used to wake up the application and data threads. */
+
+/* Pending recovery actions: Bit n re-arms the channel of error class n. */
+#define CY_FX_RECOVER_PEND_RESTART      (1UL << 31)
+
+static CyBool_t          glRecoverActive      = CyFalse;    /* Whether the application thread runs. */
+static volatile uint32_t glRecoverPending     = 0;          /* Recovery actions to be carried out. */
+static uint32_t          glRecoverWindowStart = 0;          /* Start of the current error window. */
+static uint16_t          glRecoverWindowCnt   = 0;          /* Errors seen in the current window. */
+static uint32_t          glRecoverLastRestart = 0;          /* Time of the last restart. */
+static uint16_t          glRecoverRestartCnt  = 0;          /* Restarts that followed each other quickly. */
+
+/* Called by the application thread once it is ready to carry out recovery actions. */
+void
+CyFxUsbUartRecoverStart (
+        void)
+{
+    glRecoverWindowStart = CyU3PGetTime ();
+    glRecoverActive      = CyTrue;
+}
+
+/* Check whether errors can be recovered from. */
+CyBool_t
+CyFxUsbUartRecoverIsActive (
+        void)
+{
+    return glRecoverActive;
+}
+
+/* Count an error of the given CY_FX_ERR_* class, and request the recovery action it needs. info is the
+   error code or DMA callback type, and is only traced. This can be called from any context. */
+void
+CyFxUsbUartRecoverReport (
+        uint8_t  errClass,
+        uint32_t info)
+{
+    uint32_t intMask, now;
+    uint32_t action = 0;
+
+    glUsbUartStats.errors[errClass]++;
+    CY_FX_TRACE2 (CY_FX_TRACE_EVT_ERROR, errClass, info);
+
+    if (errClass == CY_FX_ERR_EP0)
+    {
+        return;
+    }
+
+    if (errClass <= CY_FX_ERR_PORT2)
+    {
+        action = (1UL << errClass);
+    }
+    else if (errClass == CY_FX_ERR_API)
+    {
+        action = CY_FX_RECOVER_PEND_RESTART;
+    }
+
+    now = CyU3PGetTime ();
+    intMask = CyU3PVicDisableAllInterrupts ();
+    if ((now - glRecoverWindowStart) >= CY_FX_RECOVER_WINDOW_MS)
+    {
+        glRecoverWindowStart = now;
+        glRecoverWindowCnt   = 0;
+    }
+    if (++glRecoverWindowCnt >= CY_FX_RECOVER_RESTART_THRESHOLD)
+    {
+        action |= CY_FX_RECOVER_PEND_RESTART;
+    }
+    glRecoverPending |= action;
+    CyU3PVicEnableInterrupts (intMask);
+
+    if ((action != 0) && (glRecoverActive))
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_RECOVER, CYU3P_EVENT_OR);
+    }
+}
+
+/* Restart the application, or reset the device if the restarts are not helping. */
+static void
+CyFxUsbUartRecoverRestart (
+        void)
+{
+    uint32_t now = CyU3PGetTime ();
+    uint32_t intMask;
+
+    if ((now - glRecoverLastRestart) < CY_FX_RECOVER_WINDOW_MS)
+    {
+        glRecoverRestartCnt++;
+    }
+    else
+    {
+        glRecoverRestartCnt = 1;
+    }
+    glRecoverLastRestart = now;
+
+    if (glRecoverRestartCnt > CY_FX_RECOVER_MAX_RESTARTS)
+    {
+        CY_FX_TRACE3 (CY_FX_TRACE_EVT_RECOVER, CY_FX_RECOVER_ACT_RESET, glRecoverRestartCnt, 0);
+        CyFxUsbUartDebugPrint ("Error recovery failed, resetting the device\r\n");
+        CyU3PThreadSleep (CY_FX_DEBUG_FLUSH_INTERVAL * 2);
+        CyU3PDeviceReset (CyFalse);
+    }
+
+    CyFxUsbUartAppRestart ();
+    glUsbUartStats.recoverRestarts++;
+
+    /* Any error seen while restarting has been taken care of by the restart. */
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glRecoverPending     = 0;
+    glRecoverWindowStart = CyU3PGetTime ();
+    glRecoverWindowCnt   = 0;
+    CyU3PVicEnableInterrupts (intMask);
+}
+
+/* Carry out the pending recovery actions. This is called from the application thread. */
+void
+CyFxUsbUartRecoverRun (
+        void)
+{
+    uint32_t intMask, pending, start, elapsed;
+    uint8_t  errClass;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    pending = glRecoverPending;
+    glRecoverPending = 0;
+    CyU3PVicEnableInterrupts (intMask);
+
+    start = CyU3PGetTime ();
+    if ((pending & CY_FX_RECOVER_PEND_RESTART) == 0)
+    {
+        for (errClass = CY_FX_ERR_USBTOUART; errClass <= CY_FX_ERR_PORT2; errClass++)
+        {
+            if ((pending & (1UL << errClass)) == 0)
+            {
+                continue;
+            }
+
+            if (CyFxUsbUartChannelRearm (errClass) != CY_U3P_SUCCESS)
+            {
+                pending |= CY_FX_RECOVER_PEND_RESTART;
+                break;
+            }
+
+            glUsbUartStats.recoverRearms++;
+            CY_FX_TRACE3 (CY_FX_TRACE_EVT_RECOVER, CY_FX_RECOVER_ACT_REARM, errClass, CyU3PGetTime () - start);
+        }
+    }
+
+    if ((pending & CY_FX_RECOVER_PEND_RESTART) != 0)
+    {
+        CyFxUsbUartRecoverRestart ();
+        CY_FX_TRACE3 (CY_FX_TRACE_EVT_RECOVER, CY_FX_RECOVER_ACT_RESTART, glRecoverRestartCnt,
+                CyU3PGetTime () - start);
+    }
+
+    elapsed = CyU3PGetTime () - start;
+    if (elapsed > glUsbUartStats.recoverMaxMs)
+    {
+        glUsbUartStats.recoverMaxMs = elapsed;
+    }
+}
+
+/* Start the watchdog. It is cleared by the application thread each time it wakes up. */
+void
+CyFxUsbUartWatchdogStart (
+        void)
+{
+#if (CY_FX_WATCHDOG_PERIOD_MS != 0)
+    CyU3PSysWatchDogConfigure (CyTrue, CY_FX_WATCHDOG_PERIOD_MS);
+#endif
+}
+
+/* Clear the watchdog, to show that the application thread is still running. */
+void
+CyFxUsbUartWatchdogClear (
+        void)
+{
+#if (CY_FX_WATCHDOG_PERIOD_MS != 0)
+    CyU3PSysWatchDogClear ();
+#endif
+}
+
+/*[]*/
+
@@ -0,0 +1,105 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartstartup.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file measures the time from power-on to the first received byte.
+
+   Each milestone of the startup sequence (CY_FX_STARTUP_*) records the RTOS time at which it is first
+   reached. The time base starts with the RTOS kernel, so the time spent in the boot loader and in
+   CyU3PDeviceInit before that is not included. Later USB resets and re-enumerations do not move the
+   milestones: they describe the startup after power-on only.
+
+   Once the first UART byte has been seen, the application thread sends the results on the debug port as
+   one line of text. In trace mode, this is preceded by one CY_FX_TRACE_EVT_STARTUP record per milestone. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3usb.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+static uint32_t glStartupMs[CY_FX_STARTUP_COUNT];       /* Time of each milestone, in ms since the RTOS start. */
+static volatile uint32_t glStartupSeen = 0;             /* Milestones reached so far, one bit each. */
+static CyBool_t glStartupReported = CyFalse;            /* Whether the results have been sent. */
+static uint8_t  glStartupSpeed    = 0;                  /* Bus speed at the first SET_CONFIGURATION. */
+
+/* Record a milestone, unless it has been reached before. This can be called from any context. */
+void
+CyFxUsbUartStartupMark (
+        uint8_t milestone)
+{
+    uint32_t intMask;
+    uint32_t now;
+
+    if ((glStartupSeen & (1 << milestone)) != 0)
+    {
+        return;
+    }
+
+    now = CyU3PGetTime ();
+    intMask = CyU3PVicDisableAllInterrupts ();
+    if ((glStartupSeen & (1 << milestone)) == 0)
+    {
+        glStartupMs[milestone] = now;
+        glStartupSeen |= (1 << milestone);
+    }
+    CyU3PVicEnableInterrupts (intMask);
+
+    if (milestone == CY_FX_STARTUP_SETCONF)
+    {
+        glStartupSpeed = (uint8_t)CyU3PUsbGetSpeed ();
+    }
+}
+
+/* Send the results on the debug port once the first byte has been received. This is called from the
+   application thread on each wake-up. */
+void
+CyFxUsbUartStartupReport (
+        void)
+{
+    uint8_t text[128];
+    uint8_t i;
+
+    if ((glStartupReported) || ((glStartupSeen & (1 << CY_FX_STARTUP_FIRST_RX)) == 0))
+    {
+        return;
+    }
+    glStartupReported = CyTrue;
+
+    for (i = 0; i < CY_FX_STARTUP_COUNT; i++)
+    {
+        CY_FX_TRACE3 (CY_FX_TRACE_EVT_STARTUP, i, glStartupMs[i], glStartupSpeed);
+    }
+
+    if (CyU3PDebugStringPrint (text, sizeof (text),
+                "Startup (%s): connect %d ms, init %d ms, reset %d ms, setconf %d ms, start %d ms, first rx %d ms\r\n",
+                (glStartupSpeed == CY_U3P_SUPER_SPEED) ? "SS" : ((glStartupSpeed == CY_U3P_HIGH_SPEED) ? "HS" : "FS"),
+                glStartupMs[CY_FX_STARTUP_CONNECT], glStartupMs[CY_FX_STARTUP_INIT_DONE],
+                glStartupMs[CY_FX_STARTUP_USB_RESET], glStartupMs[CY_FX_STARTUP_SETCONF],
+                glStartupMs[CY_FX_STARTUP_APP_START], glStartupMs[CY_FX_STARTUP_FIRST_RX]) == CY_U3P_SUCCESS)
+    {
+        CyFxUsbUartDebugPrint ((const char *)text);
+    }
+}
+
+/*[]*/
+
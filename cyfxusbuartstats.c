@@ -0,0 +1,126 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartstats.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the statistics block of the usb-uart application. The counters are plain
+   32-bit variables that are incremented in place from the data path, so that updates cost no more
+   than a load and a store. The block is packed into a byte stream when the host reads it.
+
+   Block format (all fields little endian):
+     Byte  0     : CY_FX_STATS_VERSION
+     Byte  1     : Number of channels (CY_FX_STATS_CH_COUNT)
+     Byte  2     : Number of latency histogram buckets (CY_FX_STATS_LAT_BUCKETS)
+     Byte  3     : Reserved (0)
+     Bytes 4 - 7 : Time stamp in ms
+     Bytes 8 -   : The fields of CyFxUsbUartStats_t, as 32-bit values.
+
+   The allocator usage fields at the end of the block are not counted here. They are read from the
+   allocators when the block is packed. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+CyFxUsbUartStats_t glUsbUartStats;              /* Statistics block. */
+
+/* Add an RX latency sample (in ms) to the latency histogram. */
+void
+CyFxUsbUartStatsRxLatency (
+        uint32_t latency)
+{
+    uint32_t bucket = 0;
+
+    while ((latency != 0) && (bucket < (CY_FX_STATS_LAT_BUCKETS - 1)))
+    {
+        latency >>= 1;
+        bucket++;
+    }
+
+    glUsbUartStats.rxLatency[bucket]++;
+}
+
+/* Pack the statistics block into the buffer provided, and return the number of bytes used. The
+   byte counts of the channels that are currently active are only known to the DMA hardware, and
+   are passed in through liveBytes. */
+uint16_t
+CyFxUsbUartStatsPack (
+        uint8_t        *buffer,
+        const uint32_t *liveBytes)
+{
+    CyFxUsbUartStats_t stats;
+    uint32_t *field_p = (uint32_t *)&stats;
+    uint32_t  now = CyU3PGetTime ();
+    uint16_t  i;
+
+    CyU3PMemCopy ((uint8_t *)&stats, (uint8_t *)&glUsbUartStats, sizeof (stats));
+    for (i = 0; i < CY_FX_STATS_CH_COUNT; i++)
+    {
+        stats.ch[i].bytes += liveBytes[i];
+    }
+
+    CyU3PMemGetUsage (&stats.memCurBytes, &stats.memPeakBytes, &stats.memFailures);
+    CyU3PBufGetUsage (&stats.bufCurBytes, &stats.bufPeakBytes, &stats.bufFailures);
+    CyU3PBufGetFreeRuns (&stats.bufFreeBytes, &stats.bufLargestFree);
+    stats.bufFragPct = (stats.bufFreeBytes != 0) ? (100 - ((100 * stats.bufLargestFree) / stats.bufFreeBytes)) : 0;
+
+    buffer[0] = CY_FX_STATS_VERSION;
+    buffer[1] = CY_FX_STATS_CH_COUNT;
+    buffer[2] = CY_FX_STATS_LAT_BUCKETS;
+    buffer[3] = 0;
+    buffer[4] = CY_U3P_DWORD_GET_BYTE0 (now);
+    buffer[5] = CY_U3P_DWORD_GET_BYTE1 (now);
+    buffer[6] = CY_U3P_DWORD_GET_BYTE2 (now);
+    buffer[7] = CY_U3P_DWORD_GET_BYTE3 (now);
+    buffer += 8;
+
+    for (i = 0; i < (sizeof (stats) / sizeof (uint32_t)); i++)
+    {
+        buffer[0] = CY_U3P_DWORD_GET_BYTE0 (field_p[i]);
+        buffer[1] = CY_U3P_DWORD_GET_BYTE1 (field_p[i]);
+        buffer[2] = CY_U3P_DWORD_GET_BYTE2 (field_p[i]);
+        buffer[3] = CY_U3P_DWORD_GET_BYTE3 (field_p[i]);
+        buffer += 4;
+    }
+
+    return CY_FX_STATS_BLOCK_SIZE;
+}
+
+/* Clear all counters. The byte counts are set so that the current values of liveBytes read as zero. The
+   allocator high-water marks restart from the current usage. */
+void
+CyFxUsbUartStatsClear (
+        const uint32_t *liveBytes)
+{
+    uint16_t i;
+
+    CyU3PMemSet ((uint8_t *)&glUsbUartStats, 0, sizeof (glUsbUartStats));
+    for (i = 0; i < CY_FX_STATS_CH_COUNT; i++)
+    {
+        glUsbUartStats.ch[i].bytes = 0 - liveBytes[i];
+    }
+
+    CyU3PMemResetUsage ();
+    CyU3PBufResetUsage ();
+}
+
+/*[]*/
+
@@ -0,0 +1,398 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartstream.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the stream mode of the UART to USB path. The UART fills the small buffers of a
+   MANUAL_IN channel (glChHandleUarttoUsb), so that received data reaches the firmware soon after it
+   arrives. The data is copied into the large buffers of a MANUAL_OUT channel (glChHandleStreamOut) to
+   EP 2 IN, and frame boundaries are tracked while copying. A buffer is committed to the host:
+     - at the end of a frame of up to shortMax bytes (latency lane),
+     - when it is full (throughput lane), or
+     - when the UART receiver goes idle, which the idle flush engine reports by wrapping up a
+       partial UART side buffer.
+   If no USB side buffer is free, the UART side buffers are left in place until the host reads some
+   data, and the UART is stalled once all of them are full.
+
+   The DMA callback runs in interrupt context, and only wakes up the data thread, which does the copy.
+   If the last UART side buffer before an idle period was full, there is nothing left to wrap up, and the
+   data thread flushes the USB side buffer instead. The wrap-ups for a line coding change or a channel
+   re-configuration are issued from the application thread; glStreamLock keeps them from working on the
+   copy engine state at the same time.
+
+   With CY_FX_STREAM_FLAG_TICK, partial UART side buffers are also produced by the wrap-ups done on each
+   tick for the frame scanner, which must not end a USB side buffer. The wrap-ups are counted, so that
+   the buffer is only committed once the UART side buffer of the idle wrap-up has been copied. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3dma.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+extern CyU3PDmaChannel glChHandleUarttoUsb;     /* DMA MANUAL_IN (UART to CPU) channel handle. */
+extern CyU3PDmaChannel glChHandleStreamOut;     /* DMA MANUAL_OUT (CPU to USB) channel handle. */
+extern CyU3PEvent      glUartAppEvent;          /* Application event group. */
+
+static CyFxUsbUartStreamCfg_t glStreamCfg;      /* Frame detection settings in use. */
+static CyU3PMutex             glStreamLock;     /* Lock protecting the copy engine state. */
+
+/* State of the copy engine. */
+static CyU3PDmaBuffer_t glStreamOutBuf;         /* USB side buffer being filled. */
+static CyBool_t         glStreamOutValid = CyFalse; /* Whether glStreamOutBuf holds a buffer. */
+static uint16_t         glStreamOutFill  = 0;   /* Number of bytes in glStreamOutBuf. */
+static uint16_t         glStreamInOffset = 0;   /* Bytes already copied from the current UART side buffer. */
+static CyBool_t         glStreamStalled  = CyFalse; /* Whether the copy is waiting for a USB side buffer. */
+
+/* State of the frame parser. */
+static uint32_t         glStreamFramePos = 0;   /* Number of bytes of the current frame seen so far. */
+static uint32_t         glStreamFrameLen = 0;   /* Length of the current frame, 0 if not known yet. */
+static uint8_t          glStreamMatchLen = 0;   /* Number of pattern bytes matched so far. */
+static uint8_t          glStreamMatchNext[CY_FX_STREAM_PATTERN_MAX];    /* Bytes still matched after a mismatch
+                                                                           following each prefix length. */
+
+/* Wrap-ups of the UART side buffer. The counters wrap around, and are compared as differences. */
+static uint8_t          glStreamWrapsIssued = 0;    /* Wrap-ups done by CyFxUsbUartStreamWrapUp. */
+static uint8_t          glStreamWrapsSeen   = 0;    /* Partial UART side buffers copied. */
+static uint8_t          glStreamIdleWrap    = 0;    /* Value of glStreamWrapsIssued for the idle wrap-up. */
+static CyBool_t         glStreamIdleWait    = CyFalse;  /* Whether the idle wrap-up is still to be copied. */
+
+/* Create the lock used by the stream mode copy engine. */
+CyU3PReturnStatus_t
+CyFxUsbUartStreamInit (
+        void)
+{
+    return CyU3PMutexCreate (&glStreamLock, CYU3P_NO_INHERIT);
+}
+
+/* Initialize the copy engine and frame parser before the stream mode channels are started. */
+void
+CyFxUsbUartStreamStart (
+        const CyFxUsbUartStreamCfg_t *cfg_p)
+{
+    uint8_t i, k = 0;
+
+    glStreamCfg      = *cfg_p;
+    glStreamOutValid = CyFalse;
+    glStreamOutFill  = 0;
+    glStreamInOffset = 0;
+    glStreamStalled  = CyFalse;
+    glStreamFramePos = 0;
+    glStreamFrameLen = 0;
+    glStreamMatchLen = 0;
+    glStreamWrapsIssued = 0;
+    glStreamWrapsSeen   = 0;
+    glStreamIdleWait    = CyFalse;
+
+    /* Prefix table of the pattern: after a mismatch following i + 1 matched bytes, the longest proper
+       prefix of the pattern that is also a suffix of those bytes is still matched. */
+    if (glStreamCfg.mode == CY_FX_STREAM_MODE_PATTERN)
+    {
+        glStreamMatchNext[0] = 0;
+        for (i = 1; i < glStreamCfg.patternLen; i++)
+        {
+            while ((k != 0) && (glStreamCfg.pattern[i] != glStreamCfg.pattern[k]))
+            {
+                k = glStreamMatchNext[k - 1];
+            }
+            if (glStreamCfg.pattern[i] == glStreamCfg.pattern[k])
+            {
+                k++;
+            }
+            glStreamMatchNext[i] = k;
+        }
+    }
+}
+
+/* Find the end of the current frame in a block of received data. Returns the number of bytes up to and
+   including the end of the frame, or length if the frame does not end within the block. *isShort_p is
+   set if a frame ends, and it is short enough for the latency lane. */
+static uint16_t
+CyFxUsbUartStreamScan (
+        const uint8_t *data,
+        uint16_t       length,
+        CyBool_t      *isShort_p)
+{
+    uint32_t frameLen;
+    uint16_t i;
+
+    *isShort_p = CyFalse;
+
+    if (glStreamCfg.mode == CY_FX_STREAM_MODE_DELIMITER)
+    {
+        for (i = 0; i < length; i++)
+        {
+            glStreamFramePos++;
+            if (data[i] == glStreamCfg.param)
+            {
+                *isShort_p       = (CyBool_t)(glStreamFramePos <= glStreamCfg.shortMax);
+                glStreamFramePos = 0;
+                return (i + 1);
+            }
+        }
+
+        return length;
+    }
+
+    /* Byte sequences are matched across buffer boundaries, a byte at a time. */
+    if (glStreamCfg.mode == CY_FX_STREAM_MODE_PATTERN)
+    {
+        for (i = 0; i < length; i++)
+        {
+            glStreamFramePos++;
+            while ((glStreamMatchLen != 0) && (data[i] != glStreamCfg.pattern[glStreamMatchLen]))
+            {
+                glStreamMatchLen = glStreamMatchNext[glStreamMatchLen - 1];
+            }
+            if (data[i] == glStreamCfg.pattern[glStreamMatchLen])
+            {
+                glStreamMatchLen++;
+            }
+
+            if (glStreamMatchLen == glStreamCfg.patternLen)
+            {
+                *isShort_p       = (CyBool_t)(glStreamFramePos <= glStreamCfg.shortMax);
+                glStreamFramePos = 0;
+                glStreamMatchLen = 0;
+                return (i + 1);
+            }
+        }
+
+        return length;
+    }
+
+    /* Length prefixed frames. Only the length byte itself needs to be looked at; the rest of the frame
+       is skipped in one step. */
+    i = 0;
+    while (i < length)
+    {
+        if (glStreamFrameLen == 0)
+        {
+            if (glStreamFramePos == glStreamCfg.param)
+            {
+                glStreamFrameLen = glStreamCfg.param + 1 + data[i];
+            }
+            glStreamFramePos++;
+            i++;
+        }
+        else
+        {
+            frameLen = CY_U3P_MIN (glStreamFrameLen - glStreamFramePos, (uint32_t)(length - i));
+            glStreamFramePos += frameLen;
+            i += (uint16_t)frameLen;
+        }
+
+        if ((glStreamFrameLen != 0) && (glStreamFramePos == glStreamFrameLen))
+        {
+            *isShort_p       = (CyBool_t)(glStreamFrameLen <= glStreamCfg.shortMax);
+            glStreamFramePos = 0;
+            glStreamFrameLen = 0;
+            return i;
+        }
+    }
+
+    return length;
+}
+
+/* Commit the USB side buffer being filled, and count it against the lane given. */
+static void
+CyFxUsbUartStreamCommit (
+        uint32_t *lane_p)
+{
+    if (CyU3PDmaChannelCommitBuffer (&glChHandleStreamOut, glStreamOutFill, 0) == CY_U3P_SUCCESS)
+    {
+        glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].buffers++;
+        (*lane_p)++;
+        CyFxUsbUartRxLatencySample ();
+    }
+    else
+    {
+        glUsbUartStats.ch[CY_FX_STATS_CH_UARTTOUSB].errors++;
+    }
+
+    CY_FX_TRACE1 (CY_FX_TRACE_EVT_RX_COMMIT, glStreamOutFill);
+    glStreamOutValid = CyFalse;
+    glStreamOutFill  = 0;
+}
+
+/* Copy the rest of a UART side buffer into USB side buffers. Returns CyFalse if no USB side buffer was
+   free; the position reached is kept in glStreamInOffset. */
+static CyBool_t
+CyFxUsbUartStreamCopy (
+        const CyU3PDmaBuffer_t *in_p)
+{
+    uint16_t length;
+    CyBool_t isShort;
+
+    while (glStreamInOffset < in_p->count)
+    {
+        if (!glStreamOutValid)
+        {
+            if (CyU3PDmaChannelGetBuffer (&glChHandleStreamOut, &glStreamOutBuf, CYU3P_NO_WAIT) != CY_U3P_SUCCESS)
+            {
+                return CyFalse;
+            }
+            glStreamOutValid = CyTrue;
+            glStreamOutFill  = 0;
+        }
+
+        length = CY_U3P_MIN (in_p->count - glStreamInOffset, glStreamOutBuf.size - glStreamOutFill);
+        length = CyFxUsbUartStreamScan (in_p->buffer + glStreamInOffset, length, &isShort);
+
+        CyU3PMemCopy (glStreamOutBuf.buffer + glStreamOutFill, in_p->buffer + glStreamInOffset, length);
+        glStreamOutFill  += length;
+        glStreamInOffset += length;
+
+        if (isShort)
+        {
+            CyFxUsbUartStreamCommit (&glUsbUartStats.streamFrameCommits);
+        }
+        else if (glStreamOutFill == glStreamOutBuf.size)
+        {
+            CyFxUsbUartStreamCommit (&glUsbUartStats.streamBulkCommits);
+        }
+    }
+
+    /* A partial UART side buffer is produced by a wrap-up. Unless the scanner wraps up each tick, this
+       is done once the receiver has gone idle. */
+    if (in_p->count < in_p->size)
+    {
+        glStreamWrapsSeen++;
+        if (((glStreamCfg.flags & CY_FX_STREAM_FLAG_TICK) == 0) ||
+                ((glStreamIdleWait) && ((int8_t)(glStreamWrapsSeen - glStreamIdleWrap) >= 0)))
+        {
+            glStreamIdleWait = CyFalse;
+            if ((glStreamOutValid) && (glStreamOutFill != 0))
+            {
+                CyFxUsbUartStreamCommit (&glUsbUartStats.streamIdleCommits);
+            }
+        }
+    }
+
+    return CyTrue;
+}
+
+/* Process all UART side buffers that have been filled, oldest first. This is called from the data
+   thread. */
+void
+CyFxUsbUartStreamPump (
+        void)
+{
+    CyU3PDmaBuffer_t inBuf;
+
+    CyU3PMutexGet (&glStreamLock, CYU3P_WAIT_FOREVER);
+    while (CyU3PDmaChannelGetBuffer (&glChHandleUarttoUsb, &inBuf, CYU3P_NO_WAIT) == CY_U3P_SUCCESS)
+    {
+        if (!CyFxUsbUartStreamCopy (&inBuf))
+        {
+            if (!glStreamStalled)
+            {
+                glStreamStalled = CyTrue;
+                glUsbUartStats.streamStalls++;
+            }
+            break;
+        }
+
+        glStreamStalled  = CyFalse;
+        glStreamInOffset = 0;
+        CyU3PDmaChannelDiscardBuffer (&glChHandleUarttoUsb);
+    }
+    CyU3PMutexPut (&glStreamLock);
+}
+
+/* Wrap up the UART side buffer, so that the data received so far is scanned. For the idle wrap-up
+   (idle set), the USB side buffer is committed once that data has been copied, or right away if there
+   is nothing left to copy. This is called from the data thread, and from the application thread. */
+CyU3PReturnStatus_t
+CyFxUsbUartStreamWrapUp (
+        CyBool_t idle)
+{
+    CyU3PReturnStatus_t status;
+
+    /* The lock keeps the data thread from copying the new buffer before it has been counted. */
+    CyU3PMutexGet (&glStreamLock, CYU3P_WAIT_FOREVER);
+    status = CyU3PDmaChannelSetWrapUp (&glChHandleUarttoUsb);
+    if (status == CY_U3P_SUCCESS)
+    {
+        glStreamWrapsIssued++;
+    }
+
+    if (idle)
+    {
+        if ((int8_t)(glStreamWrapsIssued - glStreamWrapsSeen) > 0)
+        {
+            glStreamIdleWrap = glStreamWrapsIssued;
+            glStreamIdleWait = CyTrue;
+        }
+        else if ((glStreamOutValid) && (glStreamOutFill != 0))
+        {
+            /* The data received before the idle period is already in the USB side buffer. */
+            CyFxUsbUartStreamCommit (&glUsbUartStats.streamIdleCommits);
+        }
+    }
+    CyU3PMutexPut (&glStreamLock);
+
+    return status;
+}
+
+/* Copy what the UART side has produced, and commit the partial USB side buffer once all wrap-ups have
+   been copied. Returns CyTrue once the copy engine holds no data any more. This is called from the
+   application thread, before the stream mode channels are torn down. */
+CyBool_t
+CyFxUsbUartStreamFlush (
+        void)
+{
+    CyBool_t done;
+
+    CyFxUsbUartStreamPump ();
+
+    CyU3PMutexGet (&glStreamLock, CYU3P_WAIT_FOREVER);
+    done = (CyBool_t)((glStreamWrapsSeen == glStreamWrapsIssued) && (!glStreamStalled));
+    if ((done) && (glStreamOutValid) && (glStreamOutFill != 0))
+    {
+        glStreamIdleWait = CyFalse;
+        CyFxUsbUartStreamCommit (&glUsbUartStats.streamIdleCommits);
+    }
+    CyU3PMutexPut (&glStreamLock);
+
+    return done;
+}
+
+/* DMA callback for both stream mode channels. New UART side data and USB side buffers being freed up
+   both let the copy engine make progress, which is left to the data thread. All other notifications are
+   handled as for the other data channels. */
+void
+CyFxUsbUartStreamDmaCallback (
+        CyU3PDmaChannel   *chHandle,
+        CyU3PDmaCbType_t   type,
+        CyU3PDmaCBInput_t *input)
+{
+    if ((type == CY_U3P_DMA_CB_PROD_EVENT) || (type == CY_U3P_DMA_CB_CONS_EVENT))
+    {
+        CyU3PEventSet (&glUartAppEvent, CY_FX_USBUART_EVT_STREAM, CYU3P_EVENT_OR);
+        return;
+    }
+
+    CyFxUSBUARTDmaCallback (chHandle, type, input);
+}
+
+/*[]*/
+
@@ -0,0 +1,316 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxusbuartts.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2023,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file implements the timestamped RX stream: the header that is placed in front of the data of each
+   UART to USB buffer, and the time base used for it.
+
+   The time base is a complex GPIO configured as a free-running timer, clocked from the slow GPIO clock
+   (CY_FX_RX_TS_TICK_HZ). The UART byte count and the timer are sampled together on every idle timer
+   tick that saw new data, and again when a buffer is committed. A byte is taken to have been received
+   at the time of the first sample that counts it, less the character times of the bytes counted after
+   it, but not before the sample that came before. This is exact for bytes that arrive back to back,
+   and is within one tick period otherwise.
+
+   Samples are kept in a ring. While the line is fully busy, the samples add no information, and the
+   newest one is overwritten instead of adding another, so that long bursts take up only a couple of
+   entries. If the first byte of a buffer is older than the oldest sample, its time is extrapolated
+   from that sample, and the header is flagged with CY_FX_RX_TS_FLAG_APPROX. */
+
+#include <cyu3system.h>
+#include <cyu3os.h>
+#include <cyu3error.h>
+#include <cyu3gpio.h>
+#include <cyu3utils.h>
+#include "cyfxusbuart.h"
+
+/* One sample of the UART byte count and the timer. */
+typedef struct CyFxUsbUartTsSample_t
+{
+    uint32_t bytes;                 /* Number of bytes received so far. */
+    uint32_t time;                  /* Timer value. */
+    CyBool_t busy;                  /* Whether the line was fully busy since the previous sample. */
+} CyFxUsbUartTsSample_t;
+
+static CyFxUsbUartTsSample_t glTsSample[CY_FX_RX_TS_SAMPLES];
+static uint16_t glTsSampleHead  = 0;        /* Index of the newest sample. */
+static uint16_t glTsSampleCnt   = 0;        /* Number of valid samples. */
+static CyBool_t glTsSampleLost  = CyFalse;  /* Whether older samples have been overwritten. */
+static uint32_t glTsRxBase      = 0;        /* Offset between the UART byte count and the byte index. */
+static uint32_t glTsCharQ8      = 0;        /* Character time in 1/256 timer ticks. */
+static uint32_t glTsCommitted   = 0;        /* Index of the first byte of the next buffer. */
+static uint32_t glTsSeq         = 0;        /* Sequence number of the next buffer. */
+static uint32_t glTsLastTime    = 0;        /* Time of the last byte of the previous buffer. */
+static CyBool_t glTsFirst       = CyTrue;   /* Whether no buffer has been sent since the start. */
+
+/* Get the current value of the timestamp timer. */
+uint32_t
+CyFxUsbUartTsTime (
+        void)
+{
+    uint32_t value = 0;
+
+    CyU3PGpioComplexSampleNow (CY_FX_RX_TS_TIMER_GPIO, &value);
+    return value;
+}
+
+/* Start the timestamp timer. */
+CyU3PReturnStatus_t
+CyFxUsbUartTsInit (
+        void)
+{
+    CyU3PGpioComplexConfig_t gpioConfig;
+    CyU3PReturnStatus_t      apiRetStatus;
+#ifndef CY_FX_PROFILE_ENABLE
+    CyU3PGpioClock_t         gpioClock;
+
+    /* The profiler sets up the GPIO clock the same way when it is enabled. */
+    CyU3PMemSet ((uint8_t *)&gpioClock, 0, sizeof (gpioClock));
+    gpioClock.fastClkDiv = 2;
+    gpioClock.slowClkDiv = CY_FX_RX_TS_SLOW_CLK_DIV;
+    gpioClock.simpleDiv  = CY_U3P_GPIO_SIMPLE_DIV_BY_2;
+    gpioClock.clkSrc     = CY_U3P_SYS_CLK;
+    gpioClock.halfDiv    = 0;
+
+    apiRetStatus = CyU3PGpioInit (&gpioClock, NULL);
+    if (apiRetStatus != CY_U3P_SUCCESS)
+    {
+        return apiRetStatus;
+    }
+#endif
+
+    CyU3PMemSet ((uint8_t *)&gpioConfig, 0, sizeof (gpioConfig));
+    gpioConfig.outValue    = CyFalse;
+    gpioConfig.inputEn     = CyFalse;
+    gpioConfig.driveLowEn  = CyFalse;
+    gpioConfig.driveHighEn = CyFalse;
+    gpioConfig.pinMode     = CY_U3P_GPIO_MODE_STATIC;
+    gpioConfig.intrMode    = CY_U3P_GPIO_NO_INTR;
+    gpioConfig.timerMode   = CY_U3P_GPIO_TIMER_LOW_FREQ;
+    gpioConfig.timer       = 0;
+    gpioConfig.period      = 0xFFFFFFFF;
+    gpioConfig.threshold   = 0xFFFFFFFF;
+
+    apiRetStatus = CyU3PGpioSetComplexConfig (CY_FX_RX_TS_TIMER_GPIO, &gpioConfig);
+    return apiRetStatus;
+}
+
+/* Set the character time used to place the bytes between two samples. */
+void
+CyFxUsbUartTsSetCharTime (
+        uint32_t baudRate,
+        uint32_t bitsPerChar)
+{
+    if (baudRate != 0)
+    {
+        glTsCharQ8 = (uint32_t)(((uint64_t)CY_FX_RX_TS_TICK_HZ * bitsPerChar * 256) / baudRate);
+    }
+}
+
+/* Restart the byte index and the buffer sequence, when the UART to USB channel is (re-)created. rxUsed is
+   the number of bytes UART_RX_BYTE_COUNT has counted down since it was last initialized. */
+void
+CyFxUsbUartTsStart (
+        uint32_t rxUsed)
+{
+    uint32_t intMask;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    glTsRxBase     = 0 - rxUsed;
+    glTsSampleHead = 0;
+    glTsSampleCnt  = 0;
+    glTsSampleLost = CyFalse;
+    glTsCommitted  = 0;
+    glTsSeq        = 0;
+    glTsFirst      = CyTrue;
+    CyU3PVicEnableInterrupts (intMask);
+}
+
+/* Account for UART_RX_BYTE_COUNT being re-initialized, after it had counted down rxUsed bytes. This is
+   called with interrupts disabled. */
+void
+CyFxUsbUartTsReprime (
+        uint32_t rxUsed)
+{
+    glTsRxBase += rxUsed;
+}
+
+/* Add a sample of the UART byte count. rxUsed is as for CyFxUsbUartTsStart. */
+void
+CyFxUsbUartTsSample (
+        uint32_t rxUsed)
+{
+    CyFxUsbUartTsSample_t *last_p;
+    uint32_t intMask, now, bytes, elapsed, busyQ8;
+    CyBool_t busy;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    now   = CyFxUsbUartTsTime ();
+    bytes = glTsRxBase + rxUsed;
+
+    if (glTsSampleCnt != 0)
+    {
+        last_p = &glTsSample[glTsSampleHead];
+        if (bytes == last_p->bytes)
+        {
+            CyU3PVicEnableInterrupts (intMask);
+            return;
+        }
+
+        /* The line was fully busy if the bytes received fill the time elapsed, give or take a character
+           and the baud rate error. */
+        elapsed = now - last_p->time;
+        busyQ8  = (uint32_t)CY_U3P_MIN ((uint64_t)(bytes - last_p->bytes + 1) * glTsCharQ8, 0xFFFFFFFFUL);
+        busy    = (CyBool_t)((busyQ8 >> 8) >= (elapsed - (elapsed >> 5)));
+
+        if ((busy) && (last_p->busy))
+        {
+            last_p->bytes = bytes;
+            last_p->time  = now;
+            CyU3PVicEnableInterrupts (intMask);
+            return;
+        }
+
+        glTsSampleHead = (glTsSampleHead + 1) % CY_FX_RX_TS_SAMPLES;
+    }
+    else
+    {
+        busy = CyFalse;
+    }
+
+    glTsSample[glTsSampleHead].bytes = bytes;
+    glTsSample[glTsSampleHead].time  = now;
+    glTsSample[glTsSampleHead].busy  = busy;
+    if (glTsSampleCnt < CY_FX_RX_TS_SAMPLES)
+    {
+        glTsSampleCnt++;
+    }
+    else
+    {
+        glTsSampleLost = CyTrue;
+    }
+    CyU3PVicEnableInterrupts (intMask);
+}
+
+/* Get the time at which the byte with the given index was received. Returns CyFalse if the time had to
+   be extrapolated. This is called with interrupts disabled. */
+static CyBool_t
+CyFxUsbUartTsLookup (
+        uint32_t  index,
+        uint32_t *time_p)
+{
+    CyFxUsbUartTsSample_t *s_p, *prev_p = NULL;
+    uint16_t i, pos;
+    uint32_t time;
+
+    pos = (glTsSampleHead + CY_FX_RX_TS_SAMPLES + 1 - glTsSampleCnt) % CY_FX_RX_TS_SAMPLES;
+    for (i = 0; i < glTsSampleCnt; i++)
+    {
+        s_p = &glTsSample[pos];
+        if ((int32_t)(s_p->bytes - index) > 0)
+        {
+            time = s_p->time - (uint32_t)(((uint64_t)(s_p->bytes - 1 - index) * glTsCharQ8) >> 8);
+            if ((prev_p != NULL) && ((int32_t)(time - prev_p->time) < 0))
+            {
+                time = prev_p->time;
+            }
+
+            *time_p = time;
+            return (CyBool_t)((prev_p != NULL) || (!glTsSampleLost));
+        }
+
+        prev_p = s_p;
+        pos    = (pos + 1) % CY_FX_RX_TS_SAMPLES;
+    }
+
+    /* Not counted yet; it can only just have arrived. */
+    *time_p = CyFxUsbUartTsTime ();
+    return CyFalse;
+}
+
+/* Write the timestamp header of a buffer that holds count bytes of received data. The header space is
+   at the start of the buffer. idleEnd is set for a buffer that was wrapped up after the line went idle.
+   rxUsed is as for CyFxUsbUartTsStart. Returns the number of bytes to commit. */
+uint16_t
+CyFxUsbUartTsFill (
+        uint8_t  *buffer,
+        uint16_t  count,
+        CyBool_t  idleEnd,
+        uint32_t  rxUsed)
+{
+    uint32_t intMask, first, firstTime, lastTime, gap;
+    uint8_t  flags = 0;
+
+    CyFxUsbUartTsSample (rxUsed);
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    first = glTsCommitted;
+    if (!CyFxUsbUartTsLookup (first, &firstTime))
+    {
+        flags |= CY_FX_RX_TS_FLAG_APPROX;
+    }
+    CyFxUsbUartTsLookup (first + ((count != 0) ? (count - 1) : 0), &lastTime);
+    glTsCommitted += count;
+
+    if (glTsFirst)
+    {
+        flags    |= CY_FX_RX_TS_FLAG_START;
+        gap       = 0xFFFFFFFF;
+        glTsFirst = CyFalse;
+    }
+    else
+    {
+        /* The time between the two bytes, less the time taken by the second one. Gaps longer than half
+           the timer period are lost; the host has to go by its own clock for these. */
+        gap = firstTime - glTsLastTime;
+        gap = ((int32_t)gap > (int32_t)(glTsCharQ8 >> 8)) ? (gap - (glTsCharQ8 >> 8)) : 0;
+    }
+    glTsLastTime = lastTime;
+    CyU3PVicEnableInterrupts (intMask);
+
+    if (idleEnd)
+    {
+        flags |= CY_FX_RX_TS_FLAG_IDLE;
+    }
+
+    buffer[0]  = CY_FX_RX_TS_SYNC;
+    buffer[1]  = flags;
+    buffer[2]  = CY_U3P_GET_LSB (count);
+    buffer[3]  = CY_U3P_GET_MSB (count);
+    buffer[4]  = CY_U3P_DWORD_GET_BYTE0 (glTsSeq);
+    buffer[5]  = CY_U3P_DWORD_GET_BYTE1 (glTsSeq);
+    buffer[6]  = CY_U3P_DWORD_GET_BYTE2 (glTsSeq);
+    buffer[7]  = CY_U3P_DWORD_GET_BYTE3 (glTsSeq);
+    buffer[8]  = CY_U3P_DWORD_GET_BYTE0 (firstTime);
+    buffer[9]  = CY_U3P_DWORD_GET_BYTE1 (firstTime);
+    buffer[10] = CY_U3P_DWORD_GET_BYTE2 (firstTime);
+    buffer[11] = CY_U3P_DWORD_GET_BYTE3 (firstTime);
+    buffer[12] = CY_U3P_DWORD_GET_BYTE0 (gap);
+    buffer[13] = CY_U3P_DWORD_GET_BYTE1 (gap);
+    buffer[14] = CY_U3P_DWORD_GET_BYTE2 (gap);
+    buffer[15] = CY_U3P_DWORD_GET_BYTE3 (gap);
+    glTsSeq++;
+
+    return (CY_FX_RX_TS_HDR_SIZE + count);
+}
+
+/*[]*/
+
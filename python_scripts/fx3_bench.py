@@ -0,0 +1,371 @@
+import serial
+import struct
+import time
+import argparse
+import csv
+import threading
+from datetime import datetime
+
+# --- SETTINGS ---
+# Default settings (can be overridden by command line args)
+DEFAULT_PORT = "COM17"      # Data interface of the FX3 USB-UART bridge
+DEFAULT_BAUDS = "115200"
+DEFAULT_SIZES = "16"
+DEFAULT_WINDOW = 8          # Frames in flight
+DEFAULT_DURATION = 10.0     # Seconds per sweep point
+DEFAULT_TIMEOUT = 1.0       # Time after which a frame counts as lost
+SUMMARY_CSV = "fx3_bench_summary.csv"
+
+# Frame layout (all fields little endian):
+#   sync (0xA6), sequence number (uint32), payload length (uint16), payload, checksum (uint16)
+# The payload is derived from the sequence number, so that the receiver can check it.
+FRAME_SYNC = 0xA6
+FRAME_HEADER = struct.Struct("<BIH")
+FRAME_CRC = struct.Struct("<H")
+
+# USB IDs and vendor requests of the firmware (see cyfxusbuart.c).
+USB_VID = 0x04B4
+USB_PID = 0x0008
+RQT_GET_STATS = 0xB9
+RQT_SET_BENCH_MODE = 0xBE
+DEBUG_INTERFACE = 2
+
+BENCH_MODES = {"off": 0, "usb_loop": 1, "uart_loop": 2}
+
+# Statistics block layout (CyFxUsbUartStats_t in cyfxusbuart.h), after the 8 byte header.
+STATS_CH_NAMES = ("usb2uart", "uart2usb", "debug", "port2")
+STATS_CH_FIELDS = ("bytes", "buffers", "wrapups", "errors", "aborts", "prod_susp", "cons_susp")
+STATS_TAIL_FIELDS = ("uart_parity_err", "uart_rx_overflow", "uart_tx_overflow", "uart_other_err",
+                     "debug_dropped", "stream_frame_commits", "stream_bulk_commits",
+                     "stream_idle_commits", "stream_stalls", "bench_mode", "bench_words",
+                     "bench_errors", "line_coding_changes", "line_coding_skipped",
+                     "line_coding_dead_ms", "line_coding_dead_max_ms", "notify_sent",
+                     "err_usb_to_uart", "err_uart_to_usb", "err_port2", "err_ep0", "err_api",
+                     "recover_rearms", "recover_restarts", "recover_max_ms", "coalesce_packets",
+                     "coalesce_commits", "coalesce_stalls", "lpm_enables", "lpm_u0_ticks",
+                     "lpm_u1_ticks", "lpm_u2_ticks", "lpm_u1_exits", "lpm_u2_exits", "lpm_wake_max_ms",
+                     "lpm_rejected", "rx_reconfig_timeouts", "rx_reconfig_lost_bytes", "dma_cb_unknown",
+                     "mem_cur_bytes", "mem_peak_bytes", "mem_failures",
+                     "buf_cur_bytes", "buf_peak_bytes", "buf_failures", "buf_free_bytes",
+                     "buf_largest_free", "buf_frag_pct")
+
+
+def parse_list(text, conv=int):
+    return [conv(v) for v in text.split(",") if v]
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser(description="Windowed throughput and latency benchmark for the FX3 USB-UART bridge")
+    parser.add_argument("-p", "--port", type=str, default=DEFAULT_PORT,
+                        help=f"Data serial port to use (default: {DEFAULT_PORT})")
+    parser.add_argument("-b", "--bauds", type=str, default=DEFAULT_BAUDS,
+                        help=f"Comma separated baud rates to sweep (default: {DEFAULT_BAUDS})")
+    parser.add_argument("-s", "--sizes", type=str, default=DEFAULT_SIZES,
+                        help=f"Comma separated payload sizes in bytes to sweep (default: {DEFAULT_SIZES})")
+    parser.add_argument("-w", "--window", type=int, default=DEFAULT_WINDOW,
+                        help=f"Number of frames in flight (default: {DEFAULT_WINDOW})")
+    parser.add_argument("-d", "--duration", type=float, default=DEFAULT_DURATION,
+                        help=f"Seconds to run each sweep point (default: {DEFAULT_DURATION})")
+    parser.add_argument("-t", "--timeout", type=float, default=DEFAULT_TIMEOUT,
+                        help=f"Seconds after which a frame is counted as lost (default: {DEFAULT_TIMEOUT})")
+    parser.add_argument("-o", "--out", type=str, default=SUMMARY_CSV,
+                        help=f"Summary CSV file, one row per sweep point (default: {SUMMARY_CSV})")
+    parser.add_argument("-f", "--frames", type=str, default=None,
+                        help="Also write one CSV row per frame to this file")
+    parser.add_argument("--parquet", type=str, default=None,
+                        help="Also write the per-frame records to this Parquet file (needs pandas and pyarrow)")
+    parser.add_argument("--usb", action="store_true",
+                        help="Read the firmware statistics for each sweep point (needs pyusb)")
+    parser.add_argument("--bench-mode", type=str, default=None, choices=sorted(BENCH_MODES),
+                        help="Select a firmware benchmark mode before the run (implies --usb)")
+    parser.add_argument("--bench-rate", type=int, default=0,
+                        help="Pattern rate of the benchmark mode in KB/s, 0 for no limit (default: 0)")
+    return parser.parse_args()
+
+
+def checksum(data):
+    return sum(data) & 0xFFFF
+
+
+def payload_for(seq, size):
+    return bytes(((seq + i) & 0xFF) for i in range(size))
+
+
+def build_frame(seq, size):
+    body = FRAME_HEADER.pack(FRAME_SYNC, seq, size) + payload_for(seq, size)
+    return body + FRAME_CRC.pack(checksum(body))
+
+
+def percentile(sorted_values, pct):
+    if not sorted_values:
+        return float("nan")
+    idx = min(len(sorted_values) - 1, int(round(pct / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[idx]
+
+
+class FirmwareStats:
+    """Access to the firmware statistics and benchmark mode through vendor requests on EP0."""
+
+    def __init__(self):
+        import usb.core
+        self.dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+        if self.dev is None:
+            raise RuntimeError("FX3 USB-UART bridge not found")
+
+    def set_bench_mode(self, mode, rate_kbps=0):
+        # wIndex carries the pattern rate in KB/s rather than an interface number, so the request goes to
+        # the device. The pattern (wValue bits 15:8) is left at the counter.
+        self.dev.ctrl_transfer(0x40, RQT_SET_BENCH_MODE, BENCH_MODES[mode], rate_kbps, None)
+        # The firmware re-creates the data channels from its application thread.
+        time.sleep(0.1)
+
+    def read(self, clear=False):
+        data = bytes(self.dev.ctrl_transfer(0xC1, RQT_GET_STATS, 1 if clear else 0, DEBUG_INTERFACE, 512))
+        version, ch_count, lat_buckets, _, fw_time = struct.unpack_from("<BBBBI", data, 0)
+        values = struct.unpack_from("<%dI" % ((len(data) - 8) // 4), data, 8)
+
+        stats = {"fw_stats_version": version, "fw_time_ms": fw_time}
+        pos = 0
+        for ch in range(ch_count):
+            name = STATS_CH_NAMES[ch] if ch < len(STATS_CH_NAMES) else "ch%d" % ch
+            for field in STATS_CH_FIELDS:
+                stats[f"fw_{name}_{field}"] = values[pos]
+                pos += 1
+        for bucket in range(lat_buckets):
+            stats[f"fw_rx_lat_{bucket}"] = values[pos]
+            pos += 1
+        for field in STATS_TAIL_FIELDS:
+            if pos < len(values):
+                stats[f"fw_{field}"] = values[pos]
+                pos += 1
+        return stats
+
+
+class SweepPoint:
+    """One run at a fixed baud rate and payload size, with a window of frames in flight."""
+
+    def __init__(self, ser, size, window, duration, timeout, frame_rows):
+        self.ser = ser
+        self.size = size
+        self.duration = duration
+        self.timeout = timeout
+        self.frame_rows = frame_rows
+        self.window = threading.BoundedSemaphore(window)
+        self.lock = threading.Lock()
+        self.in_flight = {}
+        self.latencies = []
+        self.sent = 0
+        self.received = 0
+        self.corrupt = 0
+        self.lost = 0
+        self.rx_bytes = 0
+        self.resync_bytes = 0
+        self.running = True
+
+    def sender(self):
+        seq = 0
+        end = time.perf_counter() + self.duration
+        while time.perf_counter() < end:
+            if not self.window.acquire(timeout=self.timeout):
+                self.expire()
+                continue
+            seq += 1
+            frame = build_frame(seq, self.size)
+            with self.lock:
+                self.in_flight[seq] = time.perf_counter()
+            self.ser.write(frame)
+            self.sent += 1
+        self.running = False
+
+    def expire(self):
+        """Count the frames that have been in flight for longer than the timeout as lost."""
+        now = time.perf_counter()
+        with self.lock:
+            old = [seq for seq, t in self.in_flight.items() if now - t > self.timeout]
+            for seq in old:
+                del self.in_flight[seq]
+                self.lost += 1
+                self.frame_rows.append((self.size, seq, "", "LOST"))
+                self.window.release()
+
+    def complete(self, seq, ok):
+        now = time.perf_counter()
+        with self.lock:
+            start = self.in_flight.pop(seq, None)
+        if start is None:
+            # Late frame that has already been counted as lost, or a corrupted sequence number.
+            self.corrupt += 1
+            return
+        rtt_us = (now - start) * 1e6
+        if ok:
+            self.received += 1
+            self.latencies.append(rtt_us)
+            self.frame_rows.append((self.size, seq, f"{rtt_us:.1f}", ""))
+        else:
+            self.corrupt += 1
+            self.frame_rows.append((self.size, seq, f"{rtt_us:.1f}", "CORRUPT"))
+        self.window.release()
+
+    def receiver(self):
+        buf = bytearray()
+        frame_len = FRAME_HEADER.size + self.size + FRAME_CRC.size
+        while self.running or (self.in_flight and not self.drained()):
+            data = self.ser.read(max(1, self.ser.in_waiting))
+            if not data:
+                continue
+            self.rx_bytes += len(data)
+            buf.extend(data)
+
+            while len(buf) >= frame_len:
+                if buf[0] != FRAME_SYNC:
+                    idx = buf.find(bytes([FRAME_SYNC]))
+                    skip = idx if idx > 0 else len(buf)
+                    self.resync_bytes += skip
+                    del buf[:skip]
+                    continue
+                sync, seq, length = FRAME_HEADER.unpack_from(buf, 0)
+                if length != self.size:
+                    self.resync_bytes += 1
+                    del buf[:1]
+                    continue
+                body = bytes(buf[:frame_len - FRAME_CRC.size])
+                (crc,) = FRAME_CRC.unpack_from(buf, frame_len - FRAME_CRC.size)
+                del buf[:frame_len]
+                ok = (crc == checksum(body)) and (body[FRAME_HEADER.size:] == payload_for(seq, self.size))
+                self.complete(seq, ok)
+
+    def drained(self):
+        # Give the frames still in flight one timeout period to arrive after the sender has stopped.
+        if not hasattr(self, "drain_end"):
+            self.drain_end = time.perf_counter() + self.timeout
+        return time.perf_counter() > self.drain_end
+
+    def run(self):
+        self.ser.reset_input_buffer()
+        start = time.perf_counter()
+        rx = threading.Thread(target=self.receiver, daemon=True)
+        rx.start()
+        self.sender()
+        rx.join()
+        elapsed = time.perf_counter() - start
+
+        # Frames still in flight after the drain period are lost, and reported like the expired ones.
+        with self.lock:
+            for seq in sorted(self.in_flight):
+                self.lost += 1
+                self.frame_rows.append((self.size, seq, "", "LOST"))
+            self.in_flight.clear()
+
+        lat = sorted(self.latencies)
+        return {
+            "payload": self.size,
+            "sent": self.sent,
+            "received": self.received,
+            "lost": self.lost,
+            "corrupt": self.corrupt,
+            "resync_bytes": self.resync_bytes,
+            "elapsed_s": f"{elapsed:.3f}",
+            "frames_per_s": f"{self.received / elapsed:.1f}",
+            "payload_bytes_per_s": f"{self.received * self.size / elapsed:.1f}",
+            "wire_bytes_per_s": f"{self.rx_bytes / elapsed:.1f}",
+            "lat_p50_us": f"{percentile(lat, 50):.1f}",
+            "lat_p99_us": f"{percentile(lat, 99):.1f}",
+            "lat_p999_us": f"{percentile(lat, 99.9):.1f}",
+            "lat_max_us": f"{lat[-1]:.1f}" if lat else "nan",
+        }
+
+
+def write_frames(args, frame_rows):
+    if args.frames:
+        with open(args.frames, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(["baud", "payload", "seq_no", "rtt_us", "error_type"])
+            writer.writerows(frame_rows)
+
+    if args.parquet:
+        try:
+            import pandas as pd
+        except ImportError:
+            print("pandas is not installed, Parquet output skipped.")
+            return
+        df = pd.DataFrame(frame_rows, columns=["baud", "payload", "seq_no", "rtt_us", "error_type"])
+        df["rtt_us"] = pd.to_numeric(df["rtt_us"], errors="coerce")
+        df.to_parquet(args.parquet)
+
+
+def main():
+    args = parse_arguments()
+    bauds = parse_list(args.bauds)
+    sizes = parse_list(args.sizes)
+
+    fw = None
+    if args.usb or args.bench_mode:
+        fw = FirmwareStats()
+        if args.bench_mode:
+            fw.set_bench_mode(args.bench_mode, args.bench_rate)
+
+    started = datetime.now().strftime("%Y-%m-%d %H:%M:%S")
+    summary = []
+    frame_rows = []
+
+    print(f"FX3 USB-UART benchmark on {args.port}, started {started}")
+    print(f"  window {args.window}, {args.duration} s per point, bench mode {args.bench_mode or 'unchanged'}")
+    print("----------------------------------------------------------------------------------")
+    print("  BAUD     | SIZE  | FRAMES/S  | PAYLOAD B/S | P50 us   | P99 us   | P99.9 us | LOST")
+    print("----------------------------------------------------------------------------------")
+
+    try:
+        ser = serial.Serial(args.port, bauds[0], timeout=0.05)
+
+        for baud in bauds:
+            ser.baudrate = baud
+            # The firmware may re-size its DMA channels after a line coding change.
+            time.sleep(0.05)
+
+            for size in sizes:
+                if fw:
+                    fw.read(clear=True)
+
+                rows = []
+                result = SweepPoint(ser, size, args.window, args.duration, args.timeout, rows).run()
+                frame_rows.extend((baud,) + r for r in rows)
+
+                row = {"started": started, "port": args.port, "bench_mode": args.bench_mode or "",
+                       "window": args.window, "baud": baud}
+                row.update(result)
+                if fw:
+                    row.update(fw.read())
+                summary.append(row)
+
+                print(f"  {baud:<8} | {size:<5} | {result['frames_per_s']:>9} | {result['payload_bytes_per_s']:>11} | "
+                      f"{result['lat_p50_us']:>8} | {result['lat_p99_us']:>8} | {result['lat_p999_us']:>8} | "
+                      f"{result['lost']}")
+
+    except KeyboardInterrupt:
+        print("\n\nBenchmark stopped by user.")
+
+    except serial.SerialException as e:
+        print(f"\n\nSerial Error: {e}")
+        print("Check if the port is correct and not open in another program.")
+
+    finally:
+        if 'ser' in locals() and ser.is_open:
+            ser.close()
+            print("Port closed.")
+
+        if summary:
+            fields = []
+            for row in summary:
+                fields.extend(k for k in row if k not in fields)
+            with open(args.out, "a", newline="") as f:
+                writer = csv.DictWriter(f, fieldnames=fields)
+                if f.tell() == 0:
+                    writer.writeheader()
+                writer.writerows(summary)
+            print(f"Summary written to {args.out}")
+
+        write_frames(args, frame_rows)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,153 @@
+import serial
+import struct
+import argparse
+import time
+
+# --- SETTINGS ---
+# Default settings (can be overridden by command line args)
+DEFAULT_PORT = "COM17"      # Data interface of the FX3 USB-UART bridge
+DEFAULT_BAUD = 115200
+TIMEOUT = 0.1
+
+# Chunk layout (see cyfxusbuart.h): type (bits 7:4) and port (bits 3:0), payload length, payload.
+# A CREDIT chunk carries the number of bytes freed in the transmit ring of the port (uint16, little
+# endian). Each port starts out with the ring size as credit.
+HDR_SIZE = 2
+TYPE_DATA = 0
+TYPE_CREDIT = 1
+MAX_PAYLOAD = 255
+
+# USB IDs and vendor requests of the firmware (see cyfxusbuart.c).
+USB_VID = 0x04B4
+USB_PID = 0x0008
+RQT_SET_MUX_MODE = 0xC3
+RQT_GET_MUX_STATUS = 0xC4
+RQT_SET_MUX_BAUD = 0xC5
+DEBUG_INTERFACE = 2
+
+STATUS_HEADER = struct.Struct("<BBH")
+STATUS_PORT = struct.Struct("<IIII")
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser(description="Talk to the ports of the FX3 USB-UART bridge in the multiplexed mode")
+    parser.add_argument("-p", "--port", type=str, default=DEFAULT_PORT,
+                        help=f"Data serial port to use (default: {DEFAULT_PORT})")
+    parser.add_argument("-b", "--baud", type=int, default=DEFAULT_BAUD,
+                        help=f"Baud rate of the native UART (default: {DEFAULT_BAUD})")
+    parser.add_argument("--send", type=str, action="append", default=[], metavar="PORT:TEXT",
+                        help="Send a line of text on a port once a second (can be repeated)")
+    parser.add_argument("--bridge-baud", type=str, action="append", default=[], metavar="PORT:BAUD",
+                        help="Set the baud rate of a bridge port before the run (can be repeated)")
+    parser.add_argument("--no-usb", action="store_true",
+                        help="Do not switch the multiplexed mode on and off (otherwise needs pyusb)")
+    return parser.parse_args()
+
+
+def find_device():
+    import usb.core
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        raise RuntimeError("FX3 USB-UART bridge not found")
+    return dev
+
+
+def set_mux(dev, enable):
+    dev.ctrl_transfer(0x41, RQT_SET_MUX_MODE, 1 if enable else 0, DEBUG_INTERFACE, None)
+
+
+def set_bridge_baud(dev, port, baud):
+    dev.ctrl_transfer(0x41, RQT_SET_MUX_BAUD, port, baud // 100, None)
+
+
+def get_status(dev):
+    data = bytes(dev.ctrl_transfer(0xC1, RQT_GET_MUX_STATUS, 0, DEBUG_INTERFACE, 512))
+    count, active, ring = STATUS_HEADER.unpack_from(data)
+    ports = [STATUS_PORT.unpack_from(data, STATUS_HEADER.size + i * STATUS_PORT.size) for i in range(count)]
+    return active, ring, ports
+
+
+def print_status(dev):
+    active, ring, ports = get_status(dev)
+    print(f"Multiplexed mode {'on' if active else 'off'}, ring size {ring}")
+    for port, (rx, tx, dropped, stalls) in enumerate(ports):
+        print(f"  port {port}: rx {rx:10d}  tx {tx:10d}  dropped {dropped:8d}  rx stalls {stalls:6d}")
+    return ring, len(ports)
+
+
+class Mux:
+    def __init__(self, ser, ring, count):
+        self.ser = ser
+        self.credit = [ring] * count
+        self.pending = [bytearray() for _ in range(count)]
+        self.data = bytearray()
+
+    def write(self, port, payload):
+        self.pending[port] += payload
+        self.flush()
+
+    def flush(self):
+        # Only send what the port has room for; the rest waits for the next CREDIT chunk.
+        out = bytearray()
+        for port, pending in enumerate(self.pending):
+            while pending and self.credit[port] > 0:
+                count = min(len(pending), self.credit[port], MAX_PAYLOAD)
+                out += bytes([(TYPE_DATA << 4) | port, count]) + pending[:count]
+                del pending[:count]
+                self.credit[port] -= count
+        if out:
+            self.ser.write(out)
+
+    def poll(self):
+        self.data += self.ser.read(4096)
+        while len(self.data) >= HDR_SIZE:
+            kind, port, length = self.data[0] >> 4, self.data[0] & 0x0F, self.data[1]
+            if len(self.data) < HDR_SIZE + length:
+                break
+
+            payload = bytes(self.data[HDR_SIZE:HDR_SIZE + length])
+            del self.data[:HDR_SIZE + length]
+            if kind == TYPE_CREDIT and length == 2 and port < len(self.credit):
+                self.credit[port] += struct.unpack("<H", payload)[0]
+            elif kind == TYPE_DATA:
+                print(f"[{port}] {payload.decode(errors='replace')}", end="", flush=True)
+            else:
+                print(f"Unknown chunk type {kind} for port {port}")
+        self.flush()
+
+
+def main():
+    args = parse_arguments()
+    dev = None
+    ring, count = 1024, 3
+    if not args.no_usb:
+        dev = find_device()
+        for item in args.bridge_baud:
+            port, baud = item.split(":", 1)
+            set_bridge_baud(dev, int(port), int(baud))
+        set_mux(dev, True)
+        time.sleep(0.1)
+        ring, count = print_status(dev)
+
+    sends = [(int(port), text.encode() + b"\r\n") for port, text in (item.split(":", 1) for item in args.send)]
+
+    try:
+        with serial.Serial(args.port, args.baud, timeout=TIMEOUT) as ser:
+            mux = Mux(ser, ring, count)
+            last = 0.0
+            while True:
+                if sends and time.time() - last >= 1.0:
+                    last = time.time()
+                    for port, payload in sends:
+                        mux.write(port, payload)
+                mux.poll()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if dev is not None:
+            print_status(dev)
+            set_mux(dev, False)
+
+
+if __name__ == "__main__":
+    main()
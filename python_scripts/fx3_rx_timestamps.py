@@ -0,0 +1,116 @@
+import serial
+import struct
+import argparse
+import csv
+
+# --- SETTINGS ---
+# Default settings (can be overridden by command line args)
+DEFAULT_PORT = "COM17"      # Data interface of the FX3 USB-UART bridge
+DEFAULT_BAUD = 115200
+TIMEOUT = 0.1
+TICK_HZ = 3150000           # CY_FX_RX_TS_TICK_HZ in cyfxusbuart.h
+
+# Buffer header layout (see cyfxusbuartts.c), all fields little endian:
+#   sync (0xA7), flags, data length (uint16), sequence number (uint32),
+#   first byte time (uint32, ticks), idle gap before the first byte (uint32, ticks)
+TS_SYNC = 0xA7
+TS_HEADER = struct.Struct("<BBHIII")
+GAP_UNKNOWN = 0xFFFFFFFF
+
+FLAG_IDLE = 0x01
+FLAG_APPROX = 0x02
+FLAG_START = 0x04
+
+# USB IDs and vendor requests of the firmware (see cyfxusbuart.c).
+USB_VID = 0x04B4
+USB_PID = 0x0008
+RQT_SET_RX_TIMESTAMP = 0xC0
+DEBUG_INTERFACE = 2
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser(description="Decode the timestamped RX stream of the FX3 USB-UART bridge")
+    parser.add_argument("-p", "--port", type=str, default=DEFAULT_PORT,
+                        help=f"Data serial port to use (default: {DEFAULT_PORT})")
+    parser.add_argument("-b", "--baud", type=int, default=DEFAULT_BAUD,
+                        help=f"UART baud rate (default: {DEFAULT_BAUD})")
+    parser.add_argument("--tick-hz", type=float, default=TICK_HZ,
+                        help=f"Timestamp timer rate (default: {TICK_HZ})")
+    parser.add_argument("-o", "--out", type=str, default=None,
+                        help="Also write one CSV row per buffer to this file")
+    parser.add_argument("--usb", action="store_true",
+                        help="Enable the timestamp header before the run and disable it afterwards (needs pyusb)")
+    return parser.parse_args()
+
+
+def set_timestamps(enable):
+    import usb.core
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        raise RuntimeError("FX3 USB-UART bridge not found")
+    dev.ctrl_transfer(0x41, RQT_SET_RX_TIMESTAMP, 1 if enable else 0, DEBUG_INTERFACE, None)
+
+
+def flag_text(flags):
+    names = [name for bit, name in ((FLAG_START, "START"), (FLAG_APPROX, "APPROX"), (FLAG_IDLE, "IDLE"))
+             if flags & bit]
+    return "|".join(names) if names else "-"
+
+
+def decode(ser, args, writer):
+    data = bytearray()
+    last_seq = None
+    while True:
+        data += ser.read(4096)
+        while len(data) >= TS_HEADER.size:
+            if data[0] != TS_SYNC:
+                # Resynchronise on the next sync byte.
+                del data[0]
+                continue
+
+            sync, flags, length, seq, first, gap = TS_HEADER.unpack_from(data)
+            if len(data) < TS_HEADER.size + length:
+                break
+
+            payload = bytes(data[TS_HEADER.size:TS_HEADER.size + length])
+            del data[:TS_HEADER.size + length]
+
+            lost = 0
+            if (last_seq is not None) and not (flags & FLAG_START):
+                lost = (seq - last_seq - 1) & 0xFFFFFFFF
+            last_seq = seq
+
+            first_ms = first * 1000.0 / args.tick_hz
+            gap_ms = None if gap == GAP_UNKNOWN else gap * 1000.0 / args.tick_hz
+            gap_text = "       -" if gap_ms is None else f"{gap_ms:8.3f}"
+            print(f"seq {seq:8d}  t {first_ms:12.3f} ms  gap {gap_text} ms  len {length:5d}  {flag_text(flags)}"
+                  + (f"  ({lost} buffers lost)" if lost else ""))
+            if writer is not None:
+                writer.writerow([seq, flags, length, first, "" if gap == GAP_UNKNOWN else gap, payload.hex()])
+
+
+def main():
+    args = parse_arguments()
+    if args.usb:
+        set_timestamps(True)
+
+    out = open(args.out, "w", newline="") if args.out else None
+    writer = None
+    if out is not None:
+        writer = csv.writer(out)
+        writer.writerow(["seq", "flags", "length", "first_ticks", "gap_ticks", "data"])
+
+    try:
+        with serial.Serial(args.port, args.baud, timeout=TIMEOUT) as ser:
+            decode(ser, args, writer)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out is not None:
+            out.close()
+        if args.usb:
+            set_timestamps(False)
+
+
+if __name__ == "__main__":
+    main()
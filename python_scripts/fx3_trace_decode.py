@@ -0,0 +1,199 @@
+import serial
+import struct
+import sys
+import argparse
+from datetime import datetime
+
+# --- SETTINGS ---
+# Default settings (can be overridden by command line args)
+DEFAULT_PORT = "COM18"      # Debug interface of the FX3 USB-UART bridge
+BAUDRATE = 115200           # Ignored by the device, the debug port is a virtual COM port
+TIMEOUT = 0.1
+
+# Trace record layout (see cyfxusbuartdebug.c):
+#   sync (0xA5), event id, payload length, reserved, timestamp (uint32, ms), payload
+TRACE_SYNC = 0xA5
+HEADER_SIZE = 8
+MAX_ARGS = 3
+
+EVT_TEXT = 0x01
+
+# Event IDs and argument names (CY_FX_TRACE_EVT_* in cyfxusbuart.h)
+EVENTS = {
+    0x02: ("USB_EVENT",   ("type", "data")),
+    0x03: ("LINE_CODING", ("baud", "stop", "parity")),
+    0x04: ("FLOW_CTRL",   ("enable",)),
+    0x10: ("RX_COMMIT",   ("count",)),
+    0x11: ("RX_WRAPUP",   ("status",)),
+    0x12: ("RX_RECONFIG", ("size", "count", "type")),
+    0x13: ("RX_REPRIME",  ("rx_count",)),
+    0x14: ("FLOW_STALL",  ("start", "stalls")),
+    0x15: ("BENCH_MODE",  ("mode", "pattern", "rate_kbps")),
+    0x16: ("ERROR",       ("class", "code")),
+    0x17: ("RECOVER",     ("action", "class_or_restarts", "ms")),
+    0x19: ("STARTUP",     ("milestone", "ms", "speed")),
+    0x1A: ("RX_RECONFIG_LOST", ("bytes", "ms")),
+    0x20: ("DMA_CB",      ("type",)),
+    0x30: ("MEM_BENCH",   ("path", "bytes", "ticks")),
+    0x31: ("BUF_BENCH",   ("bytes", "alloc_ticks", "free_ticks")),
+}
+
+USB_EVENTS = {
+    0: "CONNECT", 1: "DISCONNECT", 2: "SUSPEND", 3: "RESUME", 4: "RESET",
+    5: "SETCONF", 6: "SPEED", 7: "SETINTF", 8: "SET_SEL", 9: "SOF_ITP",
+}
+
+DMA_CB_TYPES = {
+    1 << 0: "XFER_CPLT", 1 << 1: "SEND_CPLT", 1 << 2: "RECV_CPLT", 1 << 3: "PROD_EVENT",
+    1 << 4: "CONS_EVENT", 1 << 5: "ABORTED", 1 << 6: "ERROR", 1 << 7: "PROD_SUSP",
+    1 << 8: "CONS_SUSP",
+}
+
+def parse_arguments():
+    parser = argparse.ArgumentParser(description="Decoder for the FX3 USB-UART binary debug trace")
+    parser.add_argument(
+        "-p", "--port",
+        type=str,
+        default=DEFAULT_PORT,
+        help=f"Debug serial port to read from (default: {DEFAULT_PORT})"
+    )
+    parser.add_argument(
+        "-f", "--file",
+        type=str,
+        default=None,
+        help="Decode a raw capture file instead of reading from the serial port"
+    )
+    parser.add_argument(
+        "-r", "--raw",
+        type=str,
+        default=None,
+        help="Also save the raw trace stream to this file"
+    )
+    return parser.parse_args()
+
+# CY_FX_STARTUP_* milestones, and the bus speed at the first SET_CONFIGURATION.
+STARTUP_MILESTONES = {
+    0: "CONNECT", 1: "INIT_DONE", 2: "USB_RESET", 3: "SETCONF", 4: "APP_START", 5: "FIRST_RX",
+}
+USB_SPEEDS = {0: "none", 1: "FS", 2: "HS", 3: "SS"}
+
+MEM_BENCH_PATHS = {
+    0: "MemSet", 1: "MemSet/unaligned", 2: "MemCopy/fwd", 3: "MemCopy/fwd/unaligned",
+    4: "MemCopy/back", 5: "MemCopy/back/unaligned",
+}
+
+def format_args(event_id, args):
+    if event_id not in EVENTS:
+        return "0x%02X" % event_id, " ".join("0x%08X" % a for a in args)
+
+    name, arg_names = EVENTS[event_id]
+    fields = []
+    for i, value in enumerate(args):
+        arg_name = arg_names[i] if i < len(arg_names) else "arg%d" % i
+        if event_id == 0x02 and i == 0:
+            text = USB_EVENTS.get(value, str(value))
+        elif event_id == 0x20 and i == 0:
+            text = DMA_CB_TYPES.get(value, "0x%X" % value)
+        elif event_id == 0x30 and i == 0:
+            text = MEM_BENCH_PATHS.get(value, str(value))
+        elif event_id == 0x19 and i == 0:
+            text = STARTUP_MILESTONES.get(value, str(value))
+        elif event_id == 0x19 and i == 2:
+            text = USB_SPEEDS.get(value, str(value))
+        else:
+            text = str(value)
+        fields.append(f"{arg_name}={text}")
+
+    # The profiling timer runs at the CPU clock rate, so ticks are CPU cycles.
+    if event_id == 0x30 and len(args) == 3 and args[1] != 0:
+        fields.append(f"cycles/byte={args[2] / args[1]:.2f}")
+    return name, " ".join(fields)
+
+class TraceDecoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.resync_bytes = 0
+
+    def feed(self, data):
+        """Add received data, and return the list of complete records as (timestamp, id, payload)."""
+        self.buf.extend(data)
+        records = []
+
+        while len(self.buf) >= HEADER_SIZE:
+            if self.buf[0] != TRACE_SYNC:
+                # Skip until the next sync byte.
+                idx = self.buf.find(bytes([TRACE_SYNC]))
+                skip = idx if idx > 0 else len(self.buf)
+                self.resync_bytes += skip
+                del self.buf[:skip]
+                continue
+
+            event_id, length, reserved, timestamp = struct.unpack_from("<BBBI", self.buf, 1)
+            if (reserved != 0) or ((event_id != EVT_TEXT) and ((length % 4 != 0) or (length > 4 * MAX_ARGS))):
+                # Not a valid header, this sync byte was part of the data.
+                self.resync_bytes += 1
+                del self.buf[:1]
+                continue
+
+            if len(self.buf) < HEADER_SIZE + length:
+                break
+
+            payload = bytes(self.buf[HEADER_SIZE:HEADER_SIZE + length])
+            del self.buf[:HEADER_SIZE + length]
+            records.append((timestamp, event_id, payload))
+
+        return records
+
+def print_record(timestamp, event_id, payload):
+    if event_id == EVT_TEXT:
+        text = payload.decode("ascii", errors="replace").rstrip("\r\n")
+        print(f"{timestamp:>10} ms | {'TEXT':<12} | {text}")
+        return
+
+    args = struct.unpack("<%dI" % (len(payload) // 4), payload)
+    name, details = format_args(event_id, args)
+    print(f"{timestamp:>10} ms | {name:<12} | {details}")
+
+def main():
+    args = parse_arguments()
+    decoder = TraceDecoder()
+    raw_file = open(args.raw, "wb") if args.raw else None
+
+    try:
+        if args.file:
+            with open(args.file, "rb") as f:
+                for record in decoder.feed(f.read()):
+                    print_record(*record)
+        else:
+            ser = serial.Serial(args.port, BAUDRATE, timeout=TIMEOUT)
+            started = datetime.now().strftime("%H:%M:%S")
+            print(f"Reading trace from {args.port} (started {started})")
+            print("----------------------------------------------------------------")
+
+            while True:
+                data = ser.read(4096)
+                if not data:
+                    continue
+                if raw_file:
+                    raw_file.write(data)
+                for record in decoder.feed(data):
+                    print_record(*record)
+
+    except KeyboardInterrupt:
+        print("\n\nStopped by user.")
+
+    except serial.SerialException as e:
+        print(f"\n\nSerial Error: {e}")
+        print("Check if the port is correct and not open in another program.")
+
+    finally:
+        if 'ser' in locals() and ser.is_open:
+            ser.close()
+            print("Port closed.")
+        if raw_file:
+            raw_file.close()
+        if decoder.resync_bytes:
+            print(f"Skipped {decoder.resync_bytes} bytes while re-synchronizing.")
+
+if __name__ == "__main__":
+    main()